@@ -0,0 +1,518 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DisplayCommon.h"
+#include "JsonWriter.h"
+#include "ProcessMemory.h"
+#include "ReportWriter.h"
+#include "SceneGenerator.h"
+#include "Viewer.h"
+
+namespace fs = std::filesystem;
+
+// 結果のJSONの形を変えたら上げる
+constexpr int benchmark_version = 1;
+
+// soakで1ファイルあたりのヒープ確保を比べるために、operator newの回数を数える。
+// SDK内部の確保はFbxMallocを通るのでここには入らない（常駐メモリの方に現れる）
+static std::atomic<uint64_t> heap_allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " generate <output.fbx> [scene options]" << std::endl;
+    std::cerr << "       " << program << " run [options] [scene options]" << std::endl;
+    std::cerr << "       " << program << " soak [options] [scene options]" << std::endl;
+    std::cerr << "Scene options (run uses a built-in suite unless one is given):" << std::endl;
+    std::cerr << "  --meshes=N            number of meshes (default: 16)" << std::endl;
+    std::cerr << "  --vertices=N          vertices per mesh, rounded up to a square grid (default: 10000)" << std::endl;
+    std::cerr << "  --normals=LAYOUT      control-point, polygon-vertex (default) or polygon-vertex-indexed" << std::endl;
+    std::cerr << "  --materials=N         materials in the scene (default: 4)" << std::endl;
+    std::cerr << "  --depth=N             hierarchy depth of the mesh nodes (default: 1)" << std::endl;
+    std::cerr << "  --ascii               write ASCII FBX instead of binary" << std::endl;
+    std::cerr << "  --mixed-shading       cycle materials through Phong, Lambert and an unknown shading model" << std::endl;
+    std::cerr << "  --uncompressed        write binary arrays without zlib compression" << std::endl;
+    std::cerr << "Run options:" << std::endl;
+    std::cerr << "  --repeat=N            timed repetitions per scene (default: 5)" << std::endl;
+    std::cerr << "  --output=PATH         write JSON results to PATH instead of stdout" << std::endl;
+    std::cerr << "  --work-dir=DIR        where generated scenes are written (default: temp directory)" << std::endl;
+    std::cerr << "Soak options (inspects one scene many times, with and without a reused workspace):" << std::endl;
+    std::cerr << "  --files=N             files inspected per mode (default: 1000)" << std::endl;
+    std::cerr << "  --interval=N          files between samples of allocations and resident memory (default: 100)" << std::endl;
+}
+
+template <typename T> static bool parse_number(std::string_view text, T& value)
+{
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+static bool match_option(std::string_view arg, std::string_view name, int& i, int argc, char** argv, const char*& value)
+{
+    if (!arg.starts_with(name)) return false;
+    if (arg.size() == name.size())
+    {
+        value = i + 1 < argc ? argv[++i] : nullptr;
+        return true;
+    }
+    if (arg[name.size()] != '=') return false;
+    value = arg.data() + name.size() + 1;
+    return true;
+}
+
+// 何も書かないレポート。解析そのものの時間を書式の時間と分けて測るのに使う
+class NullReport : public Report
+{
+public:
+    explicit NullReport(ReportWriter& out) : Report(out) {}
+
+    std::unique_ptr<Report> fork(ReportWriter& part) const override { return std::make_unique<NullReport>(part); }
+    void begin_file(const char*) override {}
+    void end_file() override {}
+    void node(FbxNode*, int, std::string_view) override {}
+    void attribute(FbxNode*, FbxNodeAttribute*) override {}
+    void begin_mesh(FbxNode*, FbxMesh*) override {}
+    void end_mesh() override {}
+    void begin_normals(FbxMesh*, FbxGeometryElementNormal*) override {}
+    void control_point_normal(int, const FbxVector4&) override {}
+    void polygon_vertex_normal(int, int, const FbxVector4&) override {}
+    void end_normals() override {}
+    void normal_validation(FbxMesh*, FbxGeometryElementNormal*, const NormalCheckResult&) override {}
+    void normal_comparison(FbxMesh*, FbxGeometryElementNormal*, const NormalComparison&) override {}
+    void mesh_statistics(FbxMesh*, const MeshStatistics&) override {}
+    void scene_statistics(const MeshStatistics&) override {}
+    void begin_materials(FbxNode*, int) override {}
+    void begin_material(int, FbxSurfaceMaterial*) override {}
+    void material_id(int) override {}
+    void material_reference(int, FbxSurfaceMaterial*, int, FbxSurfaceMaterial*) override {}
+    void implementation(const FbxImplementation*) override {}
+    void binding_entry(const char*) override {}
+    void binding_texture(TextureKind, const char*) override {}
+    void binding_bool(bool) override {}
+    void binding_int(int) override {}
+    void binding_float(double) override {}
+    void binding_double(double) override {}
+    void binding_string(const char*) override {}
+    void binding_vector(const FbxVector4&, int) override {}
+    void binding_matrix(const FbxDouble4x4&) override {}
+    void binding_int64(long long) override {}
+    void binding_time(const FbxTime&) override {}
+    void binding_reference(FbxObject*) override {}
+    void binding_blob(size_t) override {}
+    void binding_distance(double, const char*) override {}
+    void binding_unsupported(const char*) override {}
+    void material_color(const char*, const FbxColor&) override {}
+    void material_scalar(const char*, double) override {}
+    void unknown_material() override {}
+    void end_material(const char*) override {}
+    void end_materials() override {}
+};
+
+struct NamedScene
+{
+    std::string name;
+    SceneParameters parameters;
+};
+
+// 時間のかかり方が違う典型的な形を一通り並べる
+static std::vector<NamedScene> default_suite()
+{
+    std::vector<NamedScene> suite;
+    suite.push_back({"baseline", {}});
+    suite.push_back({"many-small-meshes", {.meshes = 1024, .vertices = 100}});
+    suite.push_back({"few-large-meshes", {.meshes = 4, .vertices = 250000}});
+    suite.push_back({"control-point-normals", {.normals = NormalLayout::ControlPoint}});
+    suite.push_back({"indexed-normals", {.normals = NormalLayout::PolygonVertexIndexed}});
+    suite.push_back({"many-materials", {.meshes = 64, .vertices = 1000, .materials = 512}});
+    suite.push_back({"deep-hierarchy", {.meshes = 64, .vertices = 1000, .depth = 64}});
+    return suite;
+}
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F> static double time_ms(F&& f)
+{
+    auto start = Clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void collect_meshes(FbxNode* node, std::vector<FbxMesh*>& meshes)
+{
+    for (int i = 0; i < node->GetNodeAttributeCount(); ++i)
+    {
+        auto attr = node->GetNodeAttributeByIndex(i);
+        if (attr && attr->GetAttributeType() == FbxNodeAttribute::eMesh) meshes.push_back(static_cast<FbxMesh*>(attr));
+    }
+    for (int i = 0; i < node->GetChildCount(); ++i) collect_meshes(node->GetChild(i), meshes);
+}
+
+// 各段階の計測値。format_*はレポートを書いた時間から解析だけの時間を引いたもの
+struct PhaseTimes
+{
+    const char* name;
+    std::vector<double> samples;
+};
+
+static bool run_scene(const FbxPtr<FbxManager>& manager, const std::string& path, int repeat, std::vector<PhaseTimes>& phases, std::ostream& err)
+{
+    phases = {{"import", {}}, {"traversal", {}}, {"read_normal", {}}, {"display_material", {}}, {"analysis", {}}, {"format_text", {}}, {"format_json", {}}};
+    auto sample = [&](const char* name, double ms) {
+        for (auto& phase : phases)
+        {
+            if (std::string_view(phase.name) == name) phase.samples.push_back(ms);
+        }
+    };
+
+    ReportWriter sink(nullptr);
+    NullReport null(sink);
+    ViewerOptions full;
+    ViewerOptions bare;
+    bare.normals = false;
+    bare.materials = false;
+    auto profile = select_import_profile(full);
+
+    // 1回目はファイルがページキャッシュに載る前なので捨てる
+    for (int r = -1; r < repeat; ++r)
+    {
+        FbxPtr<FbxScene> scene;
+        double import_ms = time_ms([&] { scene = import(manager, path.c_str(), profile, err); });
+        if (scene == nullptr) return false;
+
+        std::vector<FbxMesh*> meshes;
+        collect_meshes(scene->GetRootNode(), meshes);
+
+        double traversal_ms = time_ms([&] { read(scene.get(), null, bare, err); });
+        double normal_ms = time_ms([&] {
+            for (auto mesh : meshes) read_normal(mesh, null);
+        });
+        double material_ms = time_ms([&] {
+            for (auto mesh : meshes) DisplayMaterial(mesh, null);
+        });
+        double analysis_ms = time_ms([&] { read(scene.get(), null, full, err); });
+
+        double format_ms[2];
+        ReportFormat formats[] = {ReportFormat::Text, ReportFormat::Json};
+        for (int f = 0; f < 2; ++f)
+        {
+            sink.clear();
+            auto report = create_report(formats[f], sink);
+            double ms = time_ms([&] {
+                report->begin_file(path.c_str());
+                read(scene.get(), *report, full, err);
+                report->end_file();
+            });
+            format_ms[f] = std::max(0.0, ms - analysis_ms);
+        }
+        sink.clear();
+
+        if (r < 0) continue;
+        sample("import", import_ms);
+        sample("traversal", traversal_ms);
+        sample("read_normal", normal_ms);
+        sample("display_material", material_ms);
+        sample("analysis", analysis_ms);
+        sample("format_text", format_ms[0]);
+        sample("format_json", format_ms[1]);
+    }
+    return true;
+}
+
+static void write_phase(JsonWriter& json, const PhaseTimes& phase)
+{
+    auto samples = phase.samples;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    double median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    json.key(phase.name);
+    json.begin_object();
+    json.field("min_ms", samples.front());
+    json.field("median_ms", median);
+    json.field("mean_ms", std::accumulate(samples.begin(), samples.end(), 0.0) / n);
+    json.field("max_ms", samples.back());
+    json.end_object();
+}
+
+static void write_parameters(JsonWriter& json, const SceneParameters& parameters)
+{
+    json.field("meshes", parameters.meshes);
+    json.field("vertices", parameters.vertices);
+    json.field("normals", normal_layout_name(parameters.normals));
+    json.field("materials", parameters.materials);
+    json.field("depth", parameters.depth);
+    json.field("ascii", parameters.ascii);
+}
+
+static int run(const std::vector<NamedScene>& suite, int repeat, const std::string& output, fs::path work_dir)
+{
+    FbxPtr<FbxManager> manager(FbxManager::Create());
+    if (manager.get() == nullptr)
+    {
+        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+        return 1;
+    }
+
+    std::error_code ec;
+    if (work_dir.empty()) work_dir = fs::temp_directory_path(ec) / "fbx_attr_viewer_bench";
+    fs::create_directories(work_dir, ec);
+
+    std::FILE* file = output.empty() ? stdout : std::fopen(output.c_str(), "wb");
+    if (file == nullptr)
+    {
+        std::cerr << "Error: Unable to open " << output << std::endl;
+        return 1;
+    }
+
+    // 書式の計測で表示用の関数が標準出力に書かないよう、捨てるだけのライタにつないでおく
+    ReportWriter discard(nullptr);
+    SetDisplayWriter(&discard);
+
+    ReportWriter out(file);
+    JsonWriter json(out);
+    json.begin_object();
+    json.field("version", benchmark_version);
+    json.field("fbx_sdk", FbxManager::GetVersion());
+    json.field("repeat", repeat);
+    json.key("scenes");
+    json.begin_array();
+
+    int result = 0;
+    for (const auto& scene : suite)
+    {
+        auto path = (work_dir / (scene.name + ".fbx")).string();
+        std::cerr << "Generating " << scene.name << "..." << std::endl;
+        std::vector<PhaseTimes> phases;
+        if (!generate_scene(manager, path.c_str(), scene.parameters, std::cerr) || !run_scene(manager, path, repeat, phases, std::cerr))
+        {
+            std::cerr << "Failed: " << scene.name << std::endl;
+            result = 1;
+            continue;
+        }
+
+        json.begin_object();
+        json.field("name", scene.name);
+        write_parameters(json, scene.parameters);
+        json.field("file_bytes", static_cast<unsigned long long>(fs::file_size(path, ec)));
+        json.key("phases");
+        json.begin_object();
+        for (const auto& phase : phases) write_phase(json, phase);
+        json.end_object();
+        json.end_object();
+
+        discard.clear();
+        fs::remove(path, ec);
+    }
+
+    json.end_array();
+    json.end_object();
+    out << '\n';
+    out.flush();
+    SetDisplayWriter(nullptr);
+    if (file != stdout) std::fclose(file);
+    return result;
+}
+
+// 同じファイルをfiles回続けて調べ、interval回ごとに確保の回数と常駐メモリを記録する。
+// workspaceならバッチのワーカーと同じく、シーンとアリーナを使い回してファイルごとに巻き戻す
+static bool soak_mode(const FbxPtr<FbxManager>& manager, const std::string& path, int files, int interval, bool workspace, JsonWriter& json, std::ostream& err)
+{
+    ViewerOptions options;
+    Workspace space;
+    if (workspace) options.workspace = &space;
+    ReportWriter out(nullptr, 64 * 1024);
+
+    json.key(workspace ? "workspace" : "fresh");
+    json.begin_array();
+    bool ok = true;
+    uint64_t allocations = heap_allocations.load();
+    auto start = Clock::now();
+    for (int i = 1; i <= files && ok; ++i)
+    {
+        ok = inspect(manager, path.c_str(), options, out, err);
+        out.clear();
+        size_t arena_bytes = space.arena.used_bytes();
+        space.arena.reset();
+        if (i % interval != 0 && i != files) continue;
+
+        int n = i % interval != 0 ? i % interval : interval;
+        uint64_t now = heap_allocations.load();
+        json.begin_object();
+        json.field("files", i);
+        json.field("allocations_per_file", static_cast<double>(now - allocations) / n);
+        json.field("ms_per_file", std::chrono::duration<double, std::milli>(Clock::now() - start).count() / n);
+        json.field("resident_mib", resident_memory() / (1024.0 * 1024.0));
+        json.field("arena_kib", arena_bytes / 1024.0);
+        json.field("arena_blocks", space.arena.block_count());
+        json.end_object();
+        allocations = heap_allocations.load();
+        start = Clock::now();
+    }
+    json.end_array();
+    return ok;
+}
+
+static int soak(const SceneParameters& parameters, int files, int interval, const std::string& output, fs::path work_dir)
+{
+    FbxPtr<FbxManager> manager(FbxManager::Create());
+    if (manager.get() == nullptr)
+    {
+        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+        return 1;
+    }
+
+    std::error_code ec;
+    if (work_dir.empty()) work_dir = fs::temp_directory_path(ec) / "fbx_attr_viewer_bench";
+    fs::create_directories(work_dir, ec);
+    auto path = (work_dir / "soak.fbx").string();
+    std::cerr << "Generating soak scene..." << std::endl;
+    if (!generate_scene(manager, path.c_str(), parameters, std::cerr)) return 1;
+
+    std::FILE* file = output.empty() ? stdout : std::fopen(output.c_str(), "wb");
+    if (file == nullptr)
+    {
+        std::cerr << "Error: Unable to open " << output << std::endl;
+        return 1;
+    }
+
+    ReportWriter discard(nullptr);
+    SetDisplayWriter(&discard);
+
+    ReportWriter out(file);
+    JsonWriter json(out);
+    json.begin_object();
+    json.field("version", benchmark_version);
+    json.field("fbx_sdk", FbxManager::GetVersion());
+    json.key("soak");
+    json.begin_object();
+    write_parameters(json, parameters);
+    json.field("files", files);
+    json.field("interval", interval);
+    // 先に使い回さない方を走らせ、その後の常駐メモリの伸びを比べやすくする
+    bool ok = soak_mode(manager, path, files, interval, false, json, std::cerr);
+    discard.clear();
+    ok = ok && soak_mode(manager, path, files, interval, true, json, std::cerr);
+    json.end_object();
+    json.end_object();
+    out << '\n';
+    out.flush();
+    SetDisplayWriter(nullptr);
+    if (file != stdout) std::fclose(file);
+    fs::remove(path, ec);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string_view command = argv[1];
+    SceneParameters parameters;
+    bool custom = false;
+    int repeat = 5;
+    int files = 1000;
+    int interval = 100;
+    std::string output;
+    std::string work_dir;
+    std::vector<std::string> args;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        const char* value = nullptr;
+        bool valid = true;
+        bool scene_option = true;
+
+        if (match_option(arg, "--meshes", i, argc, argv, value)) valid = value && parse_number(value, parameters.meshes) && parameters.meshes >= 0;
+        else if (match_option(arg, "--vertices", i, argc, argv, value)) valid = value && parse_number(value, parameters.vertices) && parameters.vertices > 0;
+        else if (match_option(arg, "--normals", i, argc, argv, value)) valid = value && parse_normal_layout(value, parameters.normals);
+        else if (match_option(arg, "--materials", i, argc, argv, value)) valid = value && parse_number(value, parameters.materials) && parameters.materials >= 0;
+        else if (match_option(arg, "--depth", i, argc, argv, value)) valid = value && parse_number(value, parameters.depth) && parameters.depth > 0;
+        else if (arg == "--ascii") parameters.ascii = true;
+        else if (arg == "--mixed-shading") parameters.mixed_shading = true;
+        else if (arg == "--uncompressed") parameters.compress_arrays = false;
+        else
+        {
+            scene_option = false;
+            if (match_option(arg, "--repeat", i, argc, argv, value)) valid = value && parse_number(value, repeat) && repeat > 0;
+            else if (match_option(arg, "--files", i, argc, argv, value)) valid = value && parse_number(value, files) && files > 0;
+            else if (match_option(arg, "--interval", i, argc, argv, value)) valid = value && parse_number(value, interval) && interval > 0;
+            else if (match_option(arg, "--output", i, argc, argv, value))
+            {
+                valid = value && *value;
+                if (valid) output = value;
+            } else if (match_option(arg, "--work-dir", i, argc, argv, value))
+            {
+                valid = value && *value;
+                if (valid) work_dir = value;
+            } else if (arg.size() > 1 && arg[0] == '-') valid = false;
+            else args.emplace_back(arg);
+        }
+        custom = custom || scene_option;
+
+        if (!valid)
+        {
+            std::cerr << "Error: Invalid option " << arg << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (command == "generate")
+    {
+        if (args.size() != 1)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        FbxPtr<FbxManager> manager(FbxManager::Create());
+        if (manager.get() == nullptr)
+        {
+            std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+            return 1;
+        }
+        return generate_scene(manager, args[0].c_str(), parameters, std::cerr) ? 0 : 1;
+    }
+
+    if (command == "run" && args.empty())
+    {
+        auto suite = custom ? std::vector<NamedScene>{{"custom", parameters}} : default_suite();
+        return run(suite, repeat, output, work_dir);
+    }
+
+    if (command == "soak" && args.empty()) return soak(parameters, files, interval, output, work_dir);
+
+    usage(argv[0]);
+    return 1;
+}
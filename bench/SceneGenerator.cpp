@@ -0,0 +1,197 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "SceneGenerator.h"
+
+bool parse_normal_layout(std::string_view text, NormalLayout& layout)
+{
+    if (text == "control-point") layout = NormalLayout::ControlPoint;
+    else if (text == "polygon-vertex") layout = NormalLayout::PolygonVertex;
+    else if (text == "polygon-vertex-indexed") layout = NormalLayout::PolygonVertexIndexed;
+    else return false;
+    return true;
+}
+
+const char* normal_layout_name(NormalLayout layout)
+{
+    switch (layout)
+    {
+    case NormalLayout::ControlPoint: return "control-point";
+    case NormalLayout::PolygonVertex: return "polygon-vertex";
+    case NormalLayout::PolygonVertexIndexed: return "polygon-vertex-indexed";
+    }
+    return "unknown";
+}
+
+// 波打った格子。法線が一様にならないよう高さを変えておく
+static double height(double x, double y) { return 0.25 * std::sin(x * 0.7) * std::cos(y * 0.5); }
+
+static FbxVector4 surface_normal(double x, double y)
+{
+    double dx = 0.25 * 0.7 * std::cos(x * 0.7) * std::cos(y * 0.5);
+    double dy = -0.25 * 0.5 * std::sin(x * 0.7) * std::sin(y * 0.5);
+    double length = std::sqrt(dx * dx + dy * dy + 1.0);
+    return FbxVector4(-dx / length, -dy / length, 1.0 / length);
+}
+
+static FbxMesh* create_mesh(FbxScene* scene, const char* name, int side, const SceneParameters& parameters, int material_count)
+{
+    auto mesh = FbxMesh::Create(scene, name);
+    mesh->InitControlPoints(side * side);
+    for (int y = 0; y < side; ++y)
+    {
+        for (int x = 0; x < side; ++x) mesh->SetControlPointAt(FbxVector4(x, y, height(x, y)), y * side + x);
+    }
+
+    // マテリアルはポリゴン単位で縞状に割り当てる
+    if (material_count > 0)
+    {
+        auto element = mesh->CreateElementMaterial();
+        element->SetMappingMode(material_count > 1 ? FbxGeometryElement::eByPolygon : FbxGeometryElement::eAllSame);
+        element->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+    }
+
+    for (int y = 0; y + 1 < side; ++y)
+    {
+        for (int x = 0; x + 1 < side; ++x)
+        {
+            mesh->BeginPolygon(material_count > 1 ? y % material_count : (material_count > 0 ? 0 : -1));
+            mesh->AddPolygon(y * side + x);
+            mesh->AddPolygon(y * side + x + 1);
+            mesh->AddPolygon((y + 1) * side + x + 1);
+            mesh->AddPolygon((y + 1) * side + x);
+            mesh->EndPolygon();
+        }
+    }
+
+    auto normals = mesh->CreateElementNormal();
+    auto& direct = normals->GetDirectArray();
+    if (parameters.normals == NormalLayout::ControlPoint)
+    {
+        normals->SetMappingMode(FbxGeometryElement::eByControlPoint);
+        normals->SetReferenceMode(FbxGeometryElement::eDirect);
+        for (int y = 0; y < side; ++y)
+        {
+            for (int x = 0; x < side; ++x) direct.Add(surface_normal(x, y));
+        }
+        return mesh;
+    }
+
+    normals->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+    bool indexed = parameters.normals == NormalLayout::PolygonVertexIndexed;
+    normals->SetReferenceMode(indexed ? FbxGeometryElement::eIndexToDirect : FbxGeometryElement::eDirect);
+    if (indexed)
+    {
+        // 共有される頂点は同じ法線を指すようにして、インデックス経由の参照を通らせる
+        for (int y = 0; y < side; ++y)
+        {
+            for (int x = 0; x < side; ++x) direct.Add(surface_normal(x, y));
+        }
+    }
+
+    auto& index = normals->GetIndexArray();
+    for (int p = 0; p < mesh->GetPolygonCount(); ++p)
+    {
+        for (int i = 0; i < mesh->GetPolygonSize(p); ++i)
+        {
+            int vi = mesh->GetPolygonVertex(p, i);
+            if (indexed) index.Add(vi);
+            else direct.Add(surface_normal(vi % side, vi / side));
+        }
+    }
+    return mesh;
+}
+
+static std::vector<FbxSurfaceMaterial*> create_materials(FbxScene* scene, int count, bool mixed_shading)
+{
+    std::vector<FbxSurfaceMaterial*> materials;
+    for (int i = 0; i < count; ++i)
+    {
+        std::string name = "Material" + std::to_string(i);
+        int kind = mixed_shading ? i % 3 : 0;
+        if (kind == 2)
+        {
+            // PhongでもLambertでもないシェーディングは、読み込むと汎用のFbxSurfaceMaterialになる
+            auto material = FbxSurfaceMaterial::Create(scene, name.c_str());
+            material->ShadingModel.Set("toon");
+            materials.push_back(material);
+            continue;
+        }
+
+        FbxSurfaceLambert* material;
+        if (kind == 0)
+        {
+            auto phong = FbxSurfacePhong::Create(scene, name.c_str());
+            phong->Shininess.Set(10.0 + i);
+            material = phong;
+        } else
+        {
+            material = FbxSurfaceLambert::Create(scene, name.c_str());
+        }
+        material->Diffuse.Set(FbxDouble3(0.2 + 0.1 * (i % 8), 0.5, 0.8));
+
+        // 半分のマテリアルにはテクスチャも繋いでおく
+        if (i % 2 == 0)
+        {
+            auto texture = FbxFileTexture::Create(scene, (name + "Diffuse").c_str());
+            texture->SetFileName((name + "_diffuse.png").c_str());
+            material->Diffuse.ConnectSrcObject(texture);
+        }
+        materials.push_back(material);
+    }
+    return materials;
+}
+
+bool generate_scene(const FbxPtr<FbxManager>& manager, const char* path, const SceneParameters& parameters, std::ostream& err)
+{
+    FbxPtr<FbxScene> scene(FbxScene::Create(manager.get(), "Benchmark"));
+    auto materials = create_materials(scene.get(), parameters.materials, parameters.mixed_shading);
+
+    int side = std::max(2, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(parameters.vertices)))));
+
+    // 深さの分だけ空のノードを重ね、メッシュは最大4本の枝の末端に順番にぶら下げる
+    std::vector<FbxNode*> parents;
+    int branches = std::clamp(parameters.meshes, 1, 4);
+    for (int b = 0; b < branches; ++b)
+    {
+        auto parent = scene->GetRootNode();
+        for (int d = 1; d < parameters.depth; ++d)
+        {
+            std::string name = "Group" + std::to_string(b) + "_" + std::to_string(d);
+            auto group = FbxNode::Create(scene.get(), name.c_str());
+            parent->AddChild(group);
+            parent = group;
+        }
+        parents.push_back(parent);
+    }
+
+    for (int m = 0; m < parameters.meshes; ++m)
+    {
+        std::string name = "Mesh" + std::to_string(m);
+        int count = std::min(parameters.materials, std::max(1, parameters.materials / std::max(1, parameters.meshes)));
+        auto node = FbxNode::Create(scene.get(), name.c_str());
+        node->SetNodeAttribute(create_mesh(scene.get(), name.c_str(), side, parameters, count));
+        for (int i = 0; i < count; ++i) node->AddMaterial(materials[(m * count + i) % materials.size()]);
+        parents[m % parents.size()]->AddChild(node);
+    }
+
+    auto registry = manager->GetIOPluginRegistry();
+    int format = parameters.ascii ? registry->FindWriterIDByDescription("FBX ascii (*.fbx)") : registry->GetNativeWriterFormat();
+
+    if (manager->GetIOSettings() == nullptr) manager->SetIOSettings(FbxIOSettings::Create(manager.get(), IOSROOT));
+    manager->GetIOSettings()->SetBoolProp(EXP_FBX_COMPRESS_ARRAYS, parameters.compress_arrays);
+    FbxPtr<FbxExporter> exporter(FbxExporter::Create(manager.get(), ""));
+    if (!exporter->Initialize(path, format, manager->GetIOSettings()))
+    {
+        err << "Error: Unable to initialize FBX exporter: " << exporter->GetStatus().GetErrorString() << std::endl;
+        return false;
+    }
+    if (!exporter->Export(scene.get()))
+    {
+        err << "Error: " << exporter->GetStatus().GetErrorString() << std::endl;
+        return false;
+    }
+    return true;
+}
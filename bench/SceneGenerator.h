@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <iosfwd>
+#include <string_view>
+#include "FbxPtr.h"
+
+// 法線レイヤーの持ち方
+enum class NormalLayout
+{
+    ControlPoint,          // eByControlPoint + eDirect
+    PolygonVertex,         // eByPolygonVertex + eDirect
+    PolygonVertexIndexed,  // eByPolygonVertex + eIndexToDirect
+};
+
+bool parse_normal_layout(std::string_view text, NormalLayout& layout);
+const char* normal_layout_name(NormalLayout layout);
+
+// 生成するシーンの大きさ
+struct SceneParameters
+{
+    int meshes = 16;
+    // メッシュごとの頂点数のおおよその値。格子状に並べるので平方数に丸める
+    int vertices = 10000;
+    NormalLayout normals = NormalLayout::PolygonVertex;
+    // シーン全体のマテリアル数。各メッシュに順番に割り当てる
+    int materials = 4;
+    // メッシュのノードまでの階層の深さ。1ならルートの直下
+    int depth = 1;
+    bool ascii = false;
+    // falseならすべてPhong。trueならPhong、Lambert、どちらでもないシェーディングの順に作る
+    bool mixed_shading = false;
+    // falseなら配列をzlibで圧縮せずに書き出す。ASCII形式には関係しない
+    bool compress_arrays = true;
+};
+
+// パラメータどおりのシーンを作り、SDKのエクスポータでpathに書き出す
+bool generate_scene(const FbxPtr<FbxManager>& manager, const char* path, const SceneParameters& parameters, std::ostream& err);
@@ -0,0 +1,97 @@
+﻿#include <cstdint>
+#include <new>
+#include "Arena.h"
+
+// このスレッドの確保先。nullptrならヒープ
+static thread_local Arena* t_arena = nullptr;
+
+void Arena::free_blocks(Block* block)
+{
+    while (block)
+    {
+        Block* next = block->next;
+        ::operator delete(block);
+        block = next;
+    }
+}
+
+Arena::~Arena()
+{
+    free_blocks(head);
+    free_blocks(large);
+}
+
+void Arena::reset()
+{
+    free_blocks(large);
+    large = nullptr;
+    current = nullptr;
+    cursor = limit = nullptr;
+    used = 0;
+    allocations = 0;
+}
+
+void Arena::next_block()
+{
+    // 前のファイルで確保したブロックが残っていればそれを使う
+    Block* candidate = current ? current->next : head;
+    if (candidate == nullptr)
+    {
+        candidate = static_cast<Block*>(::operator new(sizeof(Block) + block_size));
+        candidate->size = block_size;
+        candidate->next = nullptr;
+        if (current) current->next = candidate;
+        else head = candidate;
+        ++blocks;
+        reserved += block_size;
+    }
+    current = candidate;
+    cursor = reinterpret_cast<char*>(current + 1);
+    limit = cursor + current->size;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+    used += bytes;
+    ++allocations;
+
+    auto align = [alignment](char* p) { return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(uintptr_t(alignment) - 1)); };
+    if (bytes + alignment > block_size / 2)
+    {
+        auto block = static_cast<Block*>(::operator new(sizeof(Block) + bytes + alignment));
+        block->size = bytes + alignment;
+        block->next = large;
+        large = block;
+        return align(reinterpret_cast<char*>(block + 1));
+    }
+
+    char* p = cursor ? align(cursor) : nullptr;
+    if (p == nullptr || p + bytes > limit)
+    {
+        next_block();
+        p = align(cursor);
+    }
+    cursor = p + bytes;
+    return p;
+}
+
+std::pmr::memory_resource* analysis_memory()
+{
+    if (t_arena) return t_arena;
+    return std::pmr::new_delete_resource();
+}
+
+Arena* current_arena()
+{
+    return t_arena;
+}
+
+ScopedArena::ScopedArena(Arena* arena) : previous(t_arena)
+{
+    t_arena = arena;
+}
+
+ScopedArena::~ScopedArena()
+{
+    t_arena = previous;
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+// 1ファイル分の解析で使う一時的なメモリをまとめて確保するアリーナ。
+// 解放は何もせず、ファイルが終わったらreset()で先頭に戻すだけなので、確保と解放の時間も
+// 長いバッチでの断片化も避けられる。確保したブロックは次のファイルで使い回す。
+// ブロックの半分を超える大きな確保だけは個別に取り、reset()で返す（一つの巨大なファイルのために
+// 常駐メモリが増えたままにならないように）。1スレッド専用で、スレッドをまたいで使ってはいけない
+class Arena : public std::pmr::memory_resource
+{
+public:
+    static constexpr size_t default_block_size = 1 << 20;
+
+    explicit Arena(size_t block_size = default_block_size) : block_size(block_size) {}
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // これまでの確保を全部なかったことにする。ブロックは手放さないので、大きな確保が無ければO(1)
+    void reset();
+
+    // reset()から今までに確保したバイト数と回数
+    size_t used_bytes() const { return used; }
+    size_t allocation_count() const { return allocations; }
+    // 上流から確保したブロックの数と合計
+    size_t block_count() const { return blocks; }
+    size_t reserved_bytes() const { return reserved; }
+
+private:
+    struct Block
+    {
+        Block* next;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    // currentの次のブロックへ移る。無ければ作る
+    void next_block();
+    static void free_blocks(Block* block);
+
+    size_t block_size;
+    Block* head = nullptr;
+    // 大きな確保。ブロックと同じ形で先頭に持つ
+    Block* large = nullptr;
+    Block* current = nullptr;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t used = 0;
+    size_t allocations = 0;
+    size_t blocks = 0;
+    size_t reserved = 0;
+};
+
+// このスレッドの解析用の一時的な配列の確保先。アリーナが無ければ通常のヒープ
+std::pmr::memory_resource* analysis_memory();
+Arena* current_arena();
+
+// スコープの間だけこのスレッドの確保先をアリーナにする
+class ScopedArena
+{
+public:
+    explicit ScopedArena(Arena* arena);
+    ~ScopedArena();
+
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+
+private:
+    Arena* previous;
+};
@@ -0,0 +1,373 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "Batch.h"
+#include "ReportWriter.h"
+#include "Stats.h"
+#include "Viewer.h"
+
+namespace fs = std::filesystem;
+
+static bool is_fbx(const fs::path& path)
+{
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".fbx";
+}
+
+static bool collect_directory(const fs::path& dir, std::vector<std::string>& inputs, std::ostream& err)
+{
+    std::vector<std::string> found;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (it->is_regular_file(ec) && is_fbx(it->path())) found.push_back(it->path().string());
+    }
+    if (ec)
+    {
+        err << "Error: Unable to walk directory " << dir.string() << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // 走査順はファイルシステム依存なので、出力順が安定するようにソートする
+    std::sort(found.begin(), found.end());
+    inputs.insert(inputs.end(), found.begin(), found.end());
+    return true;
+}
+
+bool collect_inputs(const std::vector<std::string>& args, std::vector<std::string>& inputs, std::ostream& err)
+{
+    bool ok = true;
+    for (const auto& arg : args)
+    {
+        if (arg == "-")
+        {
+            std::string line;
+            while (std::getline(std::cin, line))
+            {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) inputs.push_back(line);
+            }
+            continue;
+        }
+
+        std::error_code ec;
+        if (fs::is_directory(arg, ec))
+        {
+            ok = collect_directory(arg, inputs, err) && ok;
+            continue;
+        }
+
+        // 存在しないファイルもそのまま渡し、import側でエラーとして報告させる
+        inputs.push_back(arg);
+    }
+    return ok;
+}
+
+// バッチでは--dump-normalsをディレクトリとみなし、入力の順番とファイル名からダンプ先を決める。
+// 別のディレクトリに同名のファイルがあっても衝突しないよう番号を付ける
+static std::string dump_path(const std::string& dir, size_t index, const std::string& input)
+{
+    char prefix[32];
+    std::snprintf(prefix, sizeof(prefix), "%06zu-", index);
+    return (fs::path(dir) / (prefix + fs::path(input).stem().string() + ".fbxn")).string();
+}
+
+namespace
+{
+// 先読みしたファイル一つ分。readyになるまで中身に触らない
+struct Prefetched
+{
+    std::string contents;
+    // 読む前に確保した先読みの枠のバイト数。受け取ったときに返す
+    uint64_t reserved = 0;
+    bool ready = false;
+    // falseならワーカーはパスから読み込む
+    bool ok = false;
+};
+
+// 1ファイル分の処理結果
+struct FileReport
+{
+    std::string out;
+    std::string err;
+    bool ok = false;
+    bool done = false;
+    StatTotals stats;
+};
+
+class BatchRunner
+{
+public:
+    BatchRunner(const std::vector<std::string>& inputs, const BatchOptions& options, unsigned jobs) : inputs(inputs), options(options), reports(inputs.size()), jobs(jobs)
+    {
+        // 出力待ちのレポートが溜まりすぎないよう、先行できる件数を制限する
+        window = options.queue_depth != 0 ? options.queue_depth : static_cast<size_t>(jobs) * 4;
+
+        // ストリーミングはパスからファイルをマップするので、先読みしても使わない。
+        // キャッシュは更新日時とサイズだけで当たりを判定できるので、先に中身を全部読むと台無しになる
+        if (options.prefetch > 0 && !options.viewer.stream && !options.viewer.verify_streaming && options.viewer.cache == nullptr)
+        {
+            prefetched.resize(inputs.size());
+            // ネットワーク上のストレージでは待ち時間を重ねて隠せるよう、複数のファイルを同時に読む
+            readers = static_cast<unsigned>(std::min<size_t>(options.prefetch, max_readers));
+        }
+    }
+
+    int run(ReportWriter& out, std::ostream& err)
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < readers; ++i) workers.emplace_back([this] { prefetch(); });
+        for (unsigned i = 0; i < jobs; ++i) workers.emplace_back([this] { work(); });
+
+        // 書き出しの時間は全体の合計にだけ入る
+        Stats output;
+        ScopedStats scoped(options.stats ? &output : nullptr);
+        StatTotals totals;
+
+        size_t failed = 0;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            FileReport report;
+            {
+                std::unique_lock lock(mutex);
+                done_cv.wait(lock, [&] { return reports[i].done; });
+                report = std::move(reports[i]);
+                reports[i] = FileReport();
+                emitted = i + 1;
+            }
+            window_cv.notify_all();
+
+            out << report.out;
+            if (!report.ok || !report.err.empty())
+            {
+                // エラーが直前のレポートより先に出ないよう、標準出力を先に流しておく
+                out.flush();
+                err << report.err;
+                if (!report.ok)
+                {
+                    err << "Failed: " << inputs[i] << std::endl;
+                    ++failed;
+                }
+            }
+            if (options.stats)
+            {
+                out.flush();
+                write_stats(err, inputs[i].c_str(), report.stats);
+                totals.add(report.stats);
+            }
+        }
+        out.flush();
+
+        err << "Inspected " << inputs.size() << " files, " << failed << " failed" << std::endl;
+        if (options.stats)
+        {
+            totals.add(output.totals());
+            write_stats(err, "all files", totals);
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+private:
+    static constexpr size_t max_readers = 4;
+
+    // sizeバイトちょうどを読む。途中でサイズが変わったファイルはfalseを返してパスから読み直させる
+    static bool read_file(const std::string& path, uint64_t size, std::string& contents)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) return false;
+        bool ok = false;
+        try
+        {
+            contents.resize(size);
+            ok = std::fread(contents.data(), 1, size, file) == size && std::fgetc(file) == EOF;
+        } catch (const std::bad_alloc&)
+        {
+            // 読み込みスレッドから例外を出すとterminateになるので、パスからの読み込みに回す
+        }
+        std::fclose(file);
+        if (!ok) std::string().swap(contents);
+        return ok;
+    }
+
+    // 1段目。入力順にファイルを読み、取り込みを待つ中身が数かバイト数の上限に達したら止まる
+    void prefetch()
+    {
+        for (;;)
+        {
+            size_t i;
+            {
+                std::unique_lock lock(prefetch_mutex);
+                read_cv.wait(lock, [&] { return next_read >= inputs.size() || buffered_files < options.prefetch; });
+                if (next_read >= inputs.size()) return;
+                i = next_read++;
+                ++buffered_files;
+            }
+
+            // 上限より大きいファイルと大きさの分からないファイルは先読みせず、パスから読み込ませる
+            std::error_code ec;
+            uint64_t size = fs::file_size(inputs[i], ec);
+            bool fits = !ec && size <= options.prefetch_bytes;
+
+            // 読む前に枠を確保しておく。確保は入力順に行うので、先に確保した分はワーカーが必ず受け取って返す
+            {
+                std::unique_lock lock(prefetch_mutex);
+                read_cv.wait(lock, [&] { return next_reserve == i && (!fits || buffered_bytes + size <= options.prefetch_bytes); });
+                ++next_reserve;
+                if (fits)
+                {
+                    buffered_bytes += size;
+                    prefetched[i].reserved = size;
+                }
+            }
+            read_cv.notify_all();
+
+            std::string contents;
+            bool ok = fits && read_file(inputs[i], size, contents);
+            {
+                std::lock_guard lock(prefetch_mutex);
+                prefetched[i].contents = std::move(contents);
+                prefetched[i].ok = ok;
+                prefetched[i].ready = true;
+            }
+            ready_cv.notify_all();
+        }
+    }
+
+    // 先読みした中身を受け取って枠を空ける。先読みしなかったファイルは空を返し、パスから読み込ませる
+    std::string take_prefetched(size_t i)
+    {
+        if (prefetched.empty()) return {};
+        FBXAV_STATS_SCOPE(Prefetch);
+        std::string contents;
+        bool ok;
+        {
+            std::unique_lock lock(prefetch_mutex);
+            ready_cv.wait(lock, [&] { return prefetched[i].ready; });
+            contents = std::move(prefetched[i].contents);
+            ok = prefetched[i].ok;
+            --buffered_files;
+            buffered_bytes -= prefetched[i].reserved;
+        }
+        read_cv.notify_all();
+        FBXAV_STATS_COUNT(PrefetchBytes, contents.size());
+        if (!ok) contents.clear();
+        return contents;
+    }
+
+    // 2段目。先読みした中身から取り込んで解析し、レポートを出力待ちに置く
+    void work()
+    {
+        // FbxManagerの生成はSDK内部の初期化を伴うので、スレッド間で直列化しておく
+        FbxPtr<FbxManager> manager;
+        {
+            static std::mutex create_mutex;
+            std::lock_guard lock(create_mutex);
+            manager.reset(FbxManager::Create());
+        }
+
+        // シーンとアリーナはファイルをまたいで使い回す。シーンはマネージャより先に破棄する
+        Workspace workspace;
+
+        // レポートはワーカーごとのバッファに書き、ファイルごとに取り出す
+        ReportWriter out(nullptr, 64 * 1024);
+
+        for (;;)
+        {
+            size_t i = next.fetch_add(1);
+            if (i >= inputs.size()) break;
+
+            {
+                std::unique_lock lock(mutex);
+                window_cv.wait(lock, [&] { return i < emitted + window; });
+            }
+
+            std::ostringstream err;
+            bool ok = false;
+            Stats stats;
+            ScopedStats scoped(options.stats ? &stats : nullptr);
+            {
+                FBXAV_STATS_SCOPE(Total);
+                // 取り込めなくても先読みの枠は必ず空ける
+                std::string contents = take_prefetched(i);
+                try
+                {
+                    if (manager == nullptr)
+                    {
+                        err << "Error: Unable to create FBX Manager!" << std::endl;
+                    } else
+                    {
+                        ViewerOptions viewer = options.viewer;
+                        viewer.workspace = &workspace;
+                        viewer.contents = contents;
+                        if (!viewer.dump_normals.empty()) viewer.dump_normals = dump_path(options.viewer.dump_normals, i, inputs[i]);
+                        ok = inspect(manager, inputs[i].c_str(), viewer, out, err);
+                    }
+                } catch (const std::exception& e)
+                {
+                    // 壊れたファイル一つでバッチ全体を止めない
+                    err << "Error: " << e.what() << std::endl;
+                    ok = false;
+                }
+            }
+
+            // 解析の一時的な配列はinspect()の中で全部捨てられているので、まとめて巻き戻す
+            FBXAV_STATS_COUNT(ArenaBytes, workspace.arena.used_bytes());
+            FBXAV_STATS_COUNT(ArenaAllocations, workspace.arena.allocation_count());
+            workspace.arena.reset();
+
+            {
+                std::lock_guard lock(mutex);
+                reports[i].out = out.take();
+                reports[i].err = std::move(err).str();
+                reports[i].ok = ok;
+                if (options.stats) reports[i].stats = stats.totals();
+                reports[i].done = true;
+            }
+            done_cv.notify_all();
+        }
+    }
+
+    const std::vector<std::string>& inputs;
+    const BatchOptions& options;
+    std::vector<FileReport> reports;
+    unsigned jobs;
+    size_t window;
+
+    std::atomic<size_t> next = 0;
+    size_t emitted = 0;
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    std::condition_variable window_cv;
+
+    // 先読みの状態。prefetchedが空なら先読みしない
+    unsigned readers = 0;
+    std::vector<Prefetched> prefetched;
+    size_t next_read = 0;
+    size_t next_reserve = 0;
+    size_t buffered_files = 0;
+    uint64_t buffered_bytes = 0;
+    std::mutex prefetch_mutex;
+    std::condition_variable read_cv;
+    std::condition_variable ready_cv;
+};
+} // namespace
+
+int run_batch(const std::vector<std::string>& inputs, const BatchOptions& options, ReportWriter& out, std::ostream& err)
+{
+    unsigned jobs = options.jobs != 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<size_t>(jobs, std::max<size_t>(inputs.size(), 1)));
+
+    BatchRunner runner(inputs, options, jobs);
+    return runner.run(out, err);
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "Viewer.h"
+
+class ReportWriter;
+
+struct BatchOptions
+{
+    // ワーカースレッド数。0ならハードウェアのスレッド数に合わせる
+    unsigned jobs = 0;
+    // ファイルごとと全体の段階別の時間を標準エラーに出す
+    bool stats = false;
+    // ワーカーが取り込む前のファイルをいくつまでメモリに先読みしておくか。0なら先読みせずパスから読み込む。
+    // キャッシュを使うときも先読みしない
+    size_t prefetch = 8;
+    // 先読みして持っておく中身の合計の上限。読む前にファイルの大きさ分を確保する。
+    // これより大きいファイルは先読みせずパスから読み込む
+    uint64_t prefetch_bytes = uint64_t(512) << 20;
+    // 出力を待つレポートをいくつまで溜めるか。0ならワーカー数の4倍
+    size_t queue_depth = 0;
+    ViewerOptions viewer;
+};
+
+// 引数のパスを入力ファイルの一覧に展開する。
+// ディレクトリは再帰的に.fbxを探し、"-"なら標準入力から改行区切りで読む。
+// 展開できなかった引数があればfalseを返す（見つかった分はinputsに入る）
+bool collect_inputs(const std::vector<std::string>& args, std::vector<std::string>& inputs, std::ostream& err);
+
+// 先読み、ワーカースレッドでの取り込みと解析、入力順の出力の3段で並行に処理する。
+// 各段の間の待ち行列はoptionsの深さで区切り、先の段が追いつかなければ前の段を止める。
+// 失敗したファイルがあれば1を返すが、残りのファイルの処理は続ける。
+// options.viewer.dump_normalsはダンプ先のディレクトリとして扱う
+int run_batch(const std::vector<std::string>& inputs, const BatchOptions& options, ReportWriter& out, std::ostream& err);
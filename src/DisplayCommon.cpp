@@ -6,11 +6,7 @@
    this software in either electronic or hard copy form.
 ****************************************************************************************/
 #include "DisplayCommon.h"
-#if defined(FBXSDK_ENV_MAC)
-    // disable the �format not a string literal and no format arguments� warning since
-    // the FBXSDK_printf calls made here are all valid calls and there is no secuity risk
-    #pragma GCC diagnostic ignored "-Wformat-security"
-#endif
+#include "ReportWriter.h"
 void DisplayMetaDataConnections(FbxObject* pObject)
 {
     int nbMetaData = pObject->GetSrcObjectCount<FbxObjectMetaData>();
@@ -21,145 +17,84 @@ void DisplayMetaDataConnections(FbxObject* pObject)
         DisplayString("        Name: ", (char*)metaData->GetName());
     }
 }
-static void PrintString(FbxString& pString)
+// All Display* output goes through the ReportWriter set for the current thread.
+// Without one, a process-wide writer on stdout is used.
+static thread_local ReportWriter* gDisplayWriter = nullptr;
+ReportWriter* SetDisplayWriter(ReportWriter* pWriter)
 {
-    bool lReplaced = pString.ReplaceAll("%", "%%");
-    FBX_ASSERT(lReplaced == false);
-    FBXSDK_printf(pString);
+    ReportWriter* lPrevious = gDisplayWriter;
+    gDisplayWriter = pWriter;
+    return lPrevious;
+}
+static ReportWriter& GetWriter()
+{
+    if (gDisplayWriter) return *gDisplayWriter;
+    static ReportWriter lStdoutWriter(stdout);
+    return lStdoutWriter;
+}
+static void WriteFloat(ReportWriter& pWriter, double pValue)
+{
+    if (pValue <= -HUGE_VAL) pWriter << "-INFINITY";
+    else if (pValue >= HUGE_VAL) pWriter << "INFINITY";
+    else pWriter << (float)pValue;
 }
 void DisplayString(const char* pHeader, const char* pValue /* = "" */, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    lString = pHeader;
-    lString += pValue;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    GetWriter() << pHeader << pValue << pSuffix << '\n';
 }
 void DisplayBool(const char* pHeader, bool pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    lString = pHeader;
-    lString += pValue ? "true" : "false";
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    GetWriter() << pHeader << (pValue ? "true" : "false") << pSuffix << '\n';
 }
 void DisplayInt(const char* pHeader, int pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    lString = pHeader;
-    lString += pValue;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    GetWriter() << pHeader << pValue << pSuffix << '\n';
 }
 void DisplayDouble(const char* pHeader, double pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    FbxString lFloatValue = (float)pValue;
-    lFloatValue = pValue <= -HUGE_VAL ? "-INFINITY" : lFloatValue.Buffer();
-    lFloatValue = pValue >= HUGE_VAL ? "INFINITY" : lFloatValue.Buffer();
-    lString = pHeader;
-    lString += lFloatValue;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    ReportWriter& lWriter = GetWriter();
+    lWriter << pHeader;
+    WriteFloat(lWriter, pValue);
+    lWriter << pSuffix << '\n';
 }
 void Display2DVector(const char* pHeader, FbxVector2 pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    FbxString lFloatValue1 = (float)pValue[0];
-    FbxString lFloatValue2 = (float)pValue[1];
-    lFloatValue1 = pValue[0] <= -HUGE_VAL ? "-INFINITY" : lFloatValue1.Buffer();
-    lFloatValue1 = pValue[0] >= HUGE_VAL ? "INFINITY" : lFloatValue1.Buffer();
-    lFloatValue2 = pValue[1] <= -HUGE_VAL ? "-INFINITY" : lFloatValue2.Buffer();
-    lFloatValue2 = pValue[1] >= HUGE_VAL ? "INFINITY" : lFloatValue2.Buffer();
-    lString = pHeader;
-    lString += lFloatValue1;
-    lString += ", ";
-    lString += lFloatValue2;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    ReportWriter& lWriter = GetWriter();
+    lWriter << pHeader;
+    WriteFloat(lWriter, pValue[0]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[1]);
+    lWriter << pSuffix << '\n';
 }
 void Display3DVector(const char* pHeader, FbxVector4 pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    FbxString lFloatValue1 = (float)pValue[0];
-    FbxString lFloatValue2 = (float)pValue[1];
-    FbxString lFloatValue3 = (float)pValue[2];
-    lFloatValue1 = pValue[0] <= -HUGE_VAL ? "-INFINITY" : lFloatValue1.Buffer();
-    lFloatValue1 = pValue[0] >= HUGE_VAL ? "INFINITY" : lFloatValue1.Buffer();
-    lFloatValue2 = pValue[1] <= -HUGE_VAL ? "-INFINITY" : lFloatValue2.Buffer();
-    lFloatValue2 = pValue[1] >= HUGE_VAL ? "INFINITY" : lFloatValue2.Buffer();
-    lFloatValue3 = pValue[2] <= -HUGE_VAL ? "-INFINITY" : lFloatValue3.Buffer();
-    lFloatValue3 = pValue[2] >= HUGE_VAL ? "INFINITY" : lFloatValue3.Buffer();
-    lString = pHeader;
-    lString += lFloatValue1;
-    lString += ", ";
-    lString += lFloatValue2;
-    lString += ", ";
-    lString += lFloatValue3;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    ReportWriter& lWriter = GetWriter();
+    lWriter << pHeader;
+    WriteFloat(lWriter, pValue[0]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[1]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[2]);
+    lWriter << pSuffix << '\n';
 }
 void Display4DVector(const char* pHeader, FbxVector4 pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    FbxString lFloatValue1 = (float)pValue[0];
-    FbxString lFloatValue2 = (float)pValue[1];
-    FbxString lFloatValue3 = (float)pValue[2];
-    FbxString lFloatValue4 = (float)pValue[3];
-    lFloatValue1 = pValue[0] <= -HUGE_VAL ? "-INFINITY" : lFloatValue1.Buffer();
-    lFloatValue1 = pValue[0] >= HUGE_VAL ? "INFINITY" : lFloatValue1.Buffer();
-    lFloatValue2 = pValue[1] <= -HUGE_VAL ? "-INFINITY" : lFloatValue2.Buffer();
-    lFloatValue2 = pValue[1] >= HUGE_VAL ? "INFINITY" : lFloatValue2.Buffer();
-    lFloatValue3 = pValue[2] <= -HUGE_VAL ? "-INFINITY" : lFloatValue3.Buffer();
-    lFloatValue3 = pValue[2] >= HUGE_VAL ? "INFINITY" : lFloatValue3.Buffer();
-    lFloatValue4 = pValue[3] <= -HUGE_VAL ? "-INFINITY" : lFloatValue4.Buffer();
-    lFloatValue4 = pValue[3] >= HUGE_VAL ? "INFINITY" : lFloatValue4.Buffer();
-    lString = pHeader;
-    lString += lFloatValue1;
-    lString += ", ";
-    lString += lFloatValue2;
-    lString += ", ";
-    lString += lFloatValue3;
-    lString += ", ";
-    lString += lFloatValue4;
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    ReportWriter& lWriter = GetWriter();
+    lWriter << pHeader;
+    WriteFloat(lWriter, pValue[0]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[1]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[2]);
+    lWriter << ", ";
+    WriteFloat(lWriter, pValue[3]);
+    lWriter << pSuffix << '\n';
 }
 void DisplayColor(const char* pHeader, FbxPropertyT<FbxDouble3> pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    lString = pHeader;
-    // lString += (float) pValue.mRed;
-    // lString += (double)pValue.GetArrayItem(0);
-    lString += " (red), ";
-    // lString += (float) pValue.mGreen;
-    // lString += (double)pValue.GetArrayItem(1);
-    lString += " (green), ";
-    // lString += (float) pValue.mBlue;
-    // lString += (double)pValue.GetArrayItem(2);
-    lString += " (blue)";
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    GetWriter() << pHeader << " (red), " << " (green), " << " (blue)" << pSuffix << '\n';
 }
 void DisplayColor(const char* pHeader, FbxColor pValue, const char* pSuffix /* = "" */)
 {
-    FbxString lString;
-    lString = pHeader;
-    lString += (float)pValue.mRed;
-    lString += " (red), ";
-    lString += (float)pValue.mGreen;
-    lString += " (green), ";
-    lString += (float)pValue.mBlue;
-    lString += " (blue)";
-    lString += pSuffix;
-    lString += "\n";
-    PrintString(lString);
+    GetWriter() << pHeader << (float)pValue.mRed << " (red), " << (float)pValue.mGreen << " (green), " << (float)pValue.mBlue << " (blue)" << pSuffix << '\n';
 }
@@ -8,6 +8,16 @@
 #ifndef _DISPLAY_COMMON_H
 #define _DISPLAY_COMMON_H
 #include <fbxsdk.h>
+class ReportWriter;
+ReportWriter* SetDisplayWriter(ReportWriter* pWriter);
+// 表示用ライタを差し替えて、スコープを抜けたら元に戻す
+struct ScopedDisplayWriter
+{
+    explicit ScopedDisplayWriter(ReportWriter* writer) : previous(SetDisplayWriter(writer)) {}
+    ~ScopedDisplayWriter() { SetDisplayWriter(previous); }
+
+    ReportWriter* previous;
+};
 void DisplayMetaDataConnections(FbxObject* pNode);
 void DisplayString(const char* pHeader, const char* pValue = "", const char* pSuffix = "");
 void DisplayBool(const char* pHeader, bool pValue, const char* pSuffix = "");
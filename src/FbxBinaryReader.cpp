@@ -0,0 +1,396 @@
+﻿#include "FbxBinaryReader.h"
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#if FBXAV_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// ファイルはリトルエンディアンで、読む側も同じ前提
+template <typename T> static T load(const uint8_t* p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+static const char binary_magic[] = "Kaydara FBX Binary  ";
+constexpr uint64_t header_size = 27;
+
+bool FbxBinaryReader::open(const char* path, std::ostream& err)
+{
+    corrupt = false;
+    if (!mapped.open(path, err)) return false;
+    auto data = mapped.data();
+    if (mapped.size() < header_size || std::memcmp(data, binary_magic, sizeof(binary_magic)) != 0)
+    {
+        err << "Error: " << path << " is not a binary FBX file" << std::endl;
+        return false;
+    }
+    file_version = load<uint32_t>(data + 23);
+    return true;
+}
+
+bool FbxBinaryReader::fail()
+{
+    corrupt = true;
+    return false;
+}
+
+bool FbxBinaryReader::read_record(uint64_t offset, uint64_t limit, FbxRecord& record)
+{
+    // 7500からは長さのフィールドが64ビットになる
+    bool wide = file_version >= 7500;
+    uint64_t fields = wide ? 24 : 12;
+    if (offset >= limit) return false;
+    if (limit - offset < fields + 1) return fail();
+
+    auto p = mapped.data() + offset;
+    uint64_t end, count, length;
+    if (wide)
+    {
+        end = load<uint64_t>(p);
+        count = load<uint64_t>(p + 8);
+        length = load<uint64_t>(p + 16);
+    } else
+    {
+        end = load<uint32_t>(p);
+        count = load<uint32_t>(p + 4);
+        length = load<uint32_t>(p + 8);
+    }
+    uint8_t name_length = p[fields];
+
+    // 終端のヌルレコード
+    if (end == 0 && count == 0 && length == 0 && name_length == 0) return false;
+
+    record.offset = offset;
+    record.end = end;
+    record.property_count = count;
+    // offsetはlimit未満なので名前の後ろまでは桁あふれしない。lengthは引き算で比べて回り込みを防ぐ
+    record.properties = offset + fields + 1 + name_length;
+    if (end <= offset || end > limit || record.properties > end || length > end - record.properties) return fail();
+    record.children = record.properties + length;
+    record.name = std::string_view(reinterpret_cast<const char*>(p + fields + 1), name_length);
+    return true;
+}
+
+bool FbxBinaryReader::first(FbxRecord& record)
+{
+    return read_record(header_size, mapped.size(), record);
+}
+
+bool FbxBinaryReader::first_child(const FbxRecord& parent, FbxRecord& child)
+{
+    // 子は親より後ろにしか置けない。前を指していたら同じレコードを辿り直してしまう
+    if (parent.children <= parent.offset || parent.children < parent.properties) return fail();
+    return read_record(parent.children, parent.end, child);
+}
+
+bool FbxBinaryReader::next(const FbxRecord& record, const FbxRecord* parent, FbxRecord& sibling)
+{
+    return read_record(record.end, parent ? parent->end : mapped.size(), sibling);
+}
+
+bool FbxBinaryReader::find(const FbxRecord* parent, std::string_view name, FbxRecord& child)
+{
+    FbxRecord record;
+    for (bool ok = parent ? first_child(*parent, record) : first(record); ok; ok = next(record, parent, record))
+    {
+        if (record.name == name)
+        {
+            child = record;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FbxBinaryReader::read_value(uint64_t offset, uint64_t limit, FbxRecordValue& value)
+{
+    if (offset >= limit) return fail();
+    auto p = mapped.data() + offset;
+    uint64_t available = limit - offset - 1;
+    value.type = static_cast<char>(p[0]);
+    value.data = p + 1;
+    value.count = 0;
+    value.compressed = false;
+    switch (value.type)
+    {
+    case 'Y': value.size = 2; break;
+    case 'C': value.size = 1; break;
+    case 'I':
+    case 'F': value.size = 4; break;
+    case 'D':
+    case 'L': value.size = 8; break;
+    case 'S':
+    case 'R':
+        if (available < 4) return fail();
+        value.size = load<uint32_t>(p + 1);
+        value.data = p + 5;
+        available -= 4;
+        break;
+    case 'f':
+    case 'd':
+    case 'l':
+    case 'i':
+    case 'b':
+        if (available < 12) return fail();
+        value.count = load<uint32_t>(p + 1);
+        value.compressed = load<uint32_t>(p + 5) == 1;
+        value.size = load<uint32_t>(p + 9);
+        value.data = p + 13;
+        available -= 12;
+        break;
+    default: return fail();
+    }
+    if (value.size > available) return fail();
+    // 無圧縮の配列は要素数で直接引くので、中身が要素数に足りなければ壊れているとみなす
+    if (value.is_array() && !value.compressed && static_cast<uint64_t>(value.count) * fbx_element_size(value.type) > value.size) return fail();
+    value.end = static_cast<uint64_t>(value.data - mapped.data()) + value.size;
+    return true;
+}
+
+int FbxBinaryReader::values(const FbxRecord& record, FbxRecordValue* values, int max)
+{
+    int n = 0;
+    uint64_t offset = record.properties;
+    for (; n < max && static_cast<uint64_t>(n) < record.property_count; ++n)
+    {
+        if (!read_value(offset, record.children, values[n])) break;
+        offset = values[n].end;
+    }
+    return n;
+}
+
+int64_t FbxRecordValue::as_int() const
+{
+    switch (type)
+    {
+    case 'Y': return load<int16_t>(data);
+    case 'C': return data[0];
+    case 'I': return load<int32_t>(data);
+    case 'L': return load<int64_t>(data);
+    case 'F': return static_cast<int64_t>(load<float>(data));
+    case 'D': return static_cast<int64_t>(load<double>(data));
+    default: return 0;
+    }
+}
+
+double FbxRecordValue::as_double() const
+{
+    switch (type)
+    {
+    case 'F': return load<float>(data);
+    case 'D': return load<double>(data);
+    default: return static_cast<double>(as_int());
+    }
+}
+
+std::string_view FbxRecordValue::as_string() const
+{
+    if (type != 'S' && type != 'R') return {};
+    return std::string_view(reinterpret_cast<const char*>(data), size);
+}
+
+double FbxRecordValue::double_at(size_t i) const
+{
+    switch (type)
+    {
+    case 'f': return load<float>(data + i * 4);
+    case 'd': return load<double>(data + i * 8);
+    default: return static_cast<double>(int_at(i));
+    }
+}
+
+int FbxRecordValue::int_at(size_t i) const
+{
+    switch (type)
+    {
+    case 'b': return data[i];
+    case 'i': return load<int32_t>(data + i * 4);
+    case 'l': return static_cast<int>(load<int64_t>(data + i * 8));
+    case 'f': return static_cast<int>(load<float>(data + i * 4));
+    case 'd': return static_cast<int>(load<double>(data + i * 8));
+    default: return 0;
+    }
+}
+
+std::string_view fbx_object_name(std::string_view name)
+{
+    auto separator = name.find(std::string_view("\x00\x01", 2));
+    return separator == std::string_view::npos ? name : name.substr(0, separator);
+}
+
+size_t fbx_element_size(char type)
+{
+    switch (type)
+    {
+    case 'b': return 1;
+    case 'f':
+    case 'i': return 4;
+    case 'd':
+    case 'l': return 8;
+    default: return 0;
+    }
+}
+
+bool fbx_inflate_array(const FbxRecordValue& value, uint8_t* out)
+{
+#if FBXAV_HAVE_ZLIB
+    size_t size = static_cast<size_t>(value.count) * fbx_element_size(value.type);
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) return false;
+    stream.next_in = const_cast<Bytef*>(value.data);
+    stream.avail_in = static_cast<uInt>(value.size);
+    stream.next_out = out;
+    stream.avail_out = static_cast<uInt>(size);
+    int result = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END && stream.avail_out == 0;
+#else
+    (void)value;
+    (void)out;
+    return false;
+#endif
+}
+
+#if FBXAV_HAVE_ZLIB
+struct FbxArrayReader::Inflater
+{
+    Inflater() { inflateInit(&stream); }
+    ~Inflater() { inflateEnd(&stream); }
+
+    z_stream stream{};
+};
+#else
+struct FbxArrayReader::Inflater
+{
+};
+#endif
+
+// 一度に展開する量。これより大きな配列も、このバッファを使い回して少しずつ読む
+constexpr size_t staging_bytes = 64 * 1024;
+
+FbxArrayReader::FbxArrayReader() = default;
+FbxArrayReader::~FbxArrayReader() = default;
+
+bool FbxArrayReader::open(const FbxRecordValue& value, std::ostream& err)
+{
+    type = value.type;
+    total = value.count;
+    position = 0;
+    broken = false;
+    raw = value.data;
+    inflater.reset();
+    element_size = fbx_element_size(type);
+    if (element_size == 0)
+    {
+        err << "Error: FBX property is not an array" << std::endl;
+        return false;
+    }
+
+    if (!value.compressed)
+    {
+        if (value.size < static_cast<uint64_t>(total) * element_size)
+        {
+            err << "Error: FBX array is shorter than its element count" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+#if FBXAV_HAVE_ZLIB
+    inflater = std::make_unique<Inflater>();
+    inflater->stream.next_in = const_cast<Bytef*>(value.data);
+    inflater->stream.avail_in = static_cast<uInt>(value.size);
+    staging.resize(staging_bytes);
+    return true;
+#else
+    err << "Error: Compressed FBX arrays need a build with zlib" << std::endl;
+    return false;
+#endif
+}
+
+size_t FbxArrayReader::fetch(size_t n, const uint8_t*& bytes)
+{
+    n = std::min<size_t>(n, remaining());
+    if (n == 0) return 0;
+    if (!inflater)
+    {
+        bytes = raw + static_cast<size_t>(position) * element_size;
+        position += static_cast<uint32_t>(n);
+        return n;
+    }
+
+#if FBXAV_HAVE_ZLIB
+    n = std::min(n, staging.size() / element_size);
+    auto& stream = inflater->stream;
+    stream.next_out = staging.data();
+    stream.avail_out = static_cast<uInt>(n * element_size);
+    while (stream.avail_out > 0)
+    {
+        int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) break;
+        if (result != Z_OK) break;
+    }
+    // 途中で終わっていれば、まるごと展開できた要素までを返す
+    n = (n * element_size - stream.avail_out) / element_size;
+    bytes = staging.data();
+    if (n == 0)
+    {
+        broken = true;
+        position = total;
+    }
+    position += static_cast<uint32_t>(n);
+    return n;
+#else
+    return 0;
+#endif
+}
+
+template <typename T> static void convert(char type, const uint8_t* bytes, size_t n, T* out)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        switch (type)
+        {
+        case 'b': out[i] = static_cast<T>(bytes[i]); break;
+        case 'f': out[i] = static_cast<T>(load<float>(bytes + i * 4)); break;
+        case 'i': out[i] = static_cast<T>(load<int32_t>(bytes + i * 4)); break;
+        case 'd': out[i] = static_cast<T>(load<double>(bytes + i * 8)); break;
+        case 'l': out[i] = static_cast<T>(load<int64_t>(bytes + i * 8)); break;
+        }
+    }
+}
+
+size_t FbxArrayReader::read(double* out, size_t n)
+{
+    const uint8_t* bytes = nullptr;
+    n = fetch(n, bytes);
+    convert(type, bytes, n, out);
+    return n;
+}
+
+size_t FbxArrayReader::read(int* out, size_t n)
+{
+    const uint8_t* bytes = nullptr;
+    n = fetch(n, bytes);
+    convert(type, bytes, n, out);
+    return n;
+}
+
+bool FbxArrayReader::read_all(std::vector<double>& values)
+{
+    size_t begin = values.size();
+    values.resize(begin + remaining());
+    size_t filled = begin;
+    while (filled < values.size())
+    {
+        size_t n = read(values.data() + filled, values.size() - filled);
+        if (n == 0) break;
+        filled += n;
+    }
+    values.resize(filled);
+    return !broken && remaining() == 0;
+}
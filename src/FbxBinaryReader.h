@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+
+// FBXバイナリ形式のノードレコード一つ分。プロパティや子はオフセットだけを持ち、必要になったときに読む
+struct FbxRecord
+{
+    uint64_t offset = 0;
+    // 次の兄弟レコードの位置
+    uint64_t end = 0;
+    uint64_t property_count = 0;
+    uint64_t properties = 0;
+    // 子レコードの先頭。子がなければendと同じ
+    uint64_t children = 0;
+    std::string_view name;
+};
+
+// レコードのプロパティ一つ分。配列は展開せずに生のバイト列を指す
+struct FbxRecordValue
+{
+    // 'Y' 'C' 'I' 'F' 'D' 'L' 'S' 'R' と、配列の 'f' 'd' 'l' 'i' 'b'
+    char type = 0;
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+    // 配列の要素数と、zlibで圧縮されているか
+    uint32_t count = 0;
+    bool compressed = false;
+    uint64_t end = 0;
+
+    bool is_array() const { return type == 'f' || type == 'd' || type == 'l' || type == 'i' || type == 'b'; }
+    int64_t as_int() const;
+    double as_double() const;
+    std::string_view as_string() const;
+    // 無圧縮の配列のi番目の要素。要素数がsizeに収まることはread_valueで確かめてある
+    double double_at(size_t i) const;
+    int int_at(size_t i) const;
+};
+
+// メモリにマップしたFBXバイナリファイルをレコード単位で辿る。
+// 読んだレコードを木として残さないので、使うメモリはファイルの大きさによらない
+class FbxBinaryReader
+{
+public:
+    // ヘッダを確かめる。バイナリ形式でなければfalseを返す
+    bool open(const char* path, std::ostream& err);
+
+    uint32_t version() const { return file_version; }
+    const MappedFile& file() const { return mapped; }
+
+    // トップレベルの最初のレコード
+    bool first(FbxRecord& record);
+    // parentの最初の子
+    bool first_child(const FbxRecord& parent, FbxRecord& child);
+    // recordの次の兄弟。parentがnullptrならトップレベル
+    bool next(const FbxRecord& record, const FbxRecord* parent, FbxRecord& sibling);
+    // parentの子のうち名前が一致する最初のもの。parentがnullptrならトップレベルから探す
+    bool find(const FbxRecord* parent, std::string_view name, FbxRecord& child);
+
+    // レコードのプロパティを先頭から最大max個読む。読めた数を返す
+    int values(const FbxRecord& record, FbxRecordValue* values, int max);
+
+    // 範囲外を指すレコードなどで壊れていると分かったらtrue
+    bool failed() const { return corrupt; }
+
+private:
+    bool read_record(uint64_t offset, uint64_t limit, FbxRecord& record);
+    bool read_value(uint64_t offset, uint64_t limit, FbxRecordValue& value);
+    bool fail();
+
+    MappedFile mapped;
+    uint32_t file_version = 0;
+    bool corrupt = false;
+};
+
+// 配列プロパティを先頭から少しずつ取り出す。
+// 圧縮された配列も一度に展開するのは作業用バッファ分だけなので、要素数によらずメモリは一定
+class FbxArrayReader
+{
+public:
+    FbxArrayReader();
+    ~FbxArrayReader();
+
+    FbxArrayReader(const FbxArrayReader&) = delete;
+    FbxArrayReader& operator=(const FbxArrayReader&) = delete;
+
+    // 配列でない値や展開できない値ならfalseを返す
+    bool open(const FbxRecordValue& value, std::ostream& err);
+
+    uint32_t count() const { return total; }
+    uint32_t remaining() const { return total - position; }
+    // 圧縮された中身が要素数に足りず、途中で読めなくなったらtrue
+    bool truncated() const { return broken; }
+
+    // 次の最大n要素をoutに変換して書く。書いた要素数を返し、0なら終わりか展開の失敗
+    size_t read(double* out, size_t n);
+    size_t read(int* out, size_t n);
+
+    // 残りを全部読む（インデックスで引く配列など、ランダムアクセスが要るもの用）
+    bool read_all(std::vector<double>& values);
+
+private:
+    // 次の最大n要素分の生のバイト列を用意し、実際の要素数を返す
+    size_t fetch(size_t n, const uint8_t*& bytes);
+
+    struct Inflater;
+
+    char type = 0;
+    size_t element_size = 0;
+    uint32_t total = 0;
+    uint32_t position = 0;
+    bool broken = false;
+    const uint8_t* raw = nullptr;
+    std::unique_ptr<Inflater> inflater;
+    std::vector<uint8_t> staging;
+};
+
+// 配列の一要素のバイト数。配列でなければ0
+size_t fbx_element_size(char type);
+// 圧縮された配列をoutへ丸ごと展開する。outには要素数×要素サイズのバイト数が要る
+bool fbx_inflate_array(const FbxRecordValue& value, uint8_t* out);
+
+// "名前\x00\x01クラス"の形のオブジェクト名から名前の部分だけを返す
+std::string_view fbx_object_name(std::string_view name);
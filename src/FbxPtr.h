@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <concepts>
+#include <memory>
+
+// Destroyメソッドを持つクラスかどうかをチェックするコンセプト
+template <typename T>
+concept HasDestroy = requires(T* t) {
+    {
+        t->Destroy()
+    } -> std::same_as<void>;
+};
+
+// カスタムデリータ
+template <typename T> struct FbxDeleter
+{
+    void operator()(T* p) const
+    {
+        if constexpr (HasDestroy<T>)
+        {
+            if (p) p->Destroy();
+        } else
+        {
+            delete p;
+        }
+    }
+};
+
+// スマートポインタの型を定義
+template <typename T> using FbxPtr = std::unique_ptr<T, FbxDeleter<T>>;
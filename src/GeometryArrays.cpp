@@ -0,0 +1,147 @@
+﻿#include "GeometryArrays.h"
+#include "Stats.h"
+
+std::vector<uint8_t> BufferPool::acquire(size_t size)
+{
+    {
+        std::lock_guard lock(mutex);
+        // 足りる中で一番小さいものを使い、大きなバッファを小さな配列で塞がないようにする
+        auto best = free.end();
+        for (auto it = free.begin(); it != free.end(); ++it)
+        {
+            if (it->capacity() >= size && (best == free.end() || it->capacity() < best->capacity())) best = it;
+        }
+        if (best != free.end())
+        {
+            auto buffer = std::move(*best);
+            free.erase(best);
+            buffer.resize(size);
+            return buffer;
+        }
+    }
+    allocated.fetch_add(1, std::memory_order_relaxed);
+    return std::vector<uint8_t>(size);
+}
+
+void BufferPool::release(std::vector<uint8_t> buffer)
+{
+    if (buffer.capacity() == 0) return;
+    std::lock_guard lock(mutex);
+    free.push_back(std::move(buffer));
+}
+
+void find_geometry_arrays(FbxBinaryReader& reader, const FbxRecord& geometry, GeometryArrays& arrays)
+{
+    FbxRecord child;
+    FbxRecordValue value;
+    for (bool ok = reader.first_child(geometry, child); ok; ok = reader.next(child, &geometry, child))
+    {
+        if (child.name == "Vertices")
+        {
+            reader.values(child, &arrays.vertices, 1);
+        } else if (child.name == "PolygonVertexIndex")
+        {
+            reader.values(child, &arrays.polygon_vertices, 1);
+        } else if (child.name == "Edges")
+        {
+            reader.values(child, &arrays.edges, 1);
+        } else if (child.name == "LayerElementNormal" && !arrays.has_normals)
+        {
+            // FbxMesh::GetElementNormal()と同じく最初の要素だけを見る
+            arrays.has_normals = true;
+            FbxRecord field;
+            for (bool found = reader.first_child(child, field); found; found = reader.next(field, &child, field))
+            {
+                if (reader.values(field, &value, 1) < 1) continue;
+                if (field.name == "Name") arrays.normal_name = value.as_string();
+                else if (field.name == "MappingInformationType") arrays.normal_mapping = value.as_string();
+                else if (field.name == "ReferenceInformationType") arrays.normal_reference = value.as_string();
+                else if (field.name == "Normals") arrays.normals = value;
+                else if (field.name == "NormalsIndex") arrays.normal_indices = value;
+            }
+        } else if (child.name == "LayerElementMaterial" && !arrays.has_materials)
+        {
+            arrays.has_materials = true;
+            FbxRecord field;
+            for (bool found = reader.first_child(child, field); found; found = reader.next(field, &child, field))
+            {
+                if (reader.values(field, &value, 1) < 1) continue;
+                if (field.name == "MappingInformationType") arrays.material_mapping = value.as_string();
+                else if (field.name == "Materials") arrays.materials = value;
+            }
+        }
+    }
+}
+
+GeometryLoad::~GeometryLoad()
+{
+    wait();
+    for (auto& buffer : owned) buffers.release(std::move(buffer));
+}
+
+void GeometryLoad::start(GeometryArrays& arrays, unsigned what, TaskPool* pool)
+{
+    this->pool = pool;
+    started = true;
+
+    FbxRecordValue* selected[5];
+    int count = 0;
+    if (what & GeometryVertices) selected[count++] = &arrays.vertices;
+    if (what & GeometryPolygons) selected[count++] = &arrays.polygon_vertices;
+    if (what & GeometryNormals)
+    {
+        selected[count++] = &arrays.normals;
+        selected[count++] = &arrays.normal_indices;
+    }
+    if (what & GeometryMaterials) selected[count++] = &arrays.materials;
+
+    // バッファはタスクを積む前に全部用意して、タスクからownedを触らないようにする
+    std::vector<std::pair<FbxRecordValue*, uint8_t*>> jobs;
+    for (int i = 0; i < count; ++i)
+    {
+        auto value = selected[i];
+        if (!value->is_array() || !value->compressed || value->count == 0) continue;
+        owned.push_back(buffers.acquire(static_cast<size_t>(value->count) * fbx_element_size(value->type)));
+        jobs.emplace_back(value, owned.back().data());
+    }
+
+    auto inflate = [this](FbxRecordValue* value, uint8_t* out) {
+        if (fbx_inflate_array(*value, out))
+        {
+            value->data = out;
+            value->size = static_cast<uint64_t>(value->count) * fbx_element_size(value->type);
+            value->compressed = false;
+        } else
+        {
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    if (pool == nullptr || jobs.size() < 2)
+    {
+        FBXAV_STATS_SCOPE(Import);
+        for (auto [value, out] : jobs) inflate(value, out);
+        slot.finish();
+        return;
+    }
+
+    pending.store(static_cast<int>(jobs.size()), std::memory_order_relaxed);
+    for (auto [value, out] : jobs)
+    {
+        pool->submit([this, inflate, value, out, stats = current_stats()] {
+            ScopedStats scoped(stats);
+            {
+                FBXAV_STATS_SCOPE(Import);
+                inflate(value, out);
+            }
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) slot.finish();
+        });
+    }
+}
+
+bool GeometryLoad::wait()
+{
+    if (!started) return true;
+    if (pool) slot.wait(*pool);
+    return !failed.load(std::memory_order_relaxed);
+}
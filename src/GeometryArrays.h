@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "FbxBinaryReader.h"
+#include "TaskPool.h"
+
+// 配列を展開するバッファの置き場。メッシュやファイルをまたいで使い回し、確保し直す回数を減らす。
+// 複数のスレッドから同時に使ってよい
+class BufferPool
+{
+public:
+    // 少なくともsizeバイトのバッファを返す。足りるものが空いていなければ新しく確保する
+    std::vector<uint8_t> acquire(size_t size);
+    void release(std::vector<uint8_t> buffer);
+
+    // 新しく確保したり大きくしたりした回数
+    size_t allocations() const { return allocated.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex;
+    std::vector<std::vector<uint8_t>> free;
+    std::atomic<size_t> allocated = 0;
+};
+
+// ジオメトリのレコードにある、ビューアが読む配列
+struct GeometryArrays
+{
+    FbxRecordValue vertices;
+    FbxRecordValue polygon_vertices;
+    FbxRecordValue edges;
+
+    // 最初の法線要素
+    bool has_normals = false;
+    std::string_view normal_name;
+    std::string_view normal_mapping;
+    std::string_view normal_reference;
+    FbxRecordValue normals;
+    FbxRecordValue normal_indices;
+
+    // 最初のマテリアル要素
+    bool has_materials = false;
+    std::string_view material_mapping;
+    FbxRecordValue materials;
+};
+
+// 展開する配列の選び方
+enum GeometryArray : unsigned
+{
+    GeometryVertices = 1 << 0,
+    GeometryPolygons = 1 << 1,
+    GeometryNormals = 1 << 2,
+    GeometryMaterials = 1 << 3,
+};
+
+// geometryの子を辿って配列の場所を調べる。中身には触れない
+void find_geometry_arrays(FbxBinaryReader& reader, const FbxRecord& geometry, GeometryArrays& arrays);
+
+// 圧縮された配列をプールのバッファへ丸ごと展開する。配列ごとに別のタスクにして並列に展開する。
+// 展開し終わると元のFbxRecordValueが無圧縮のバッファを指すように書き換わるので、
+// 読む側は圧縮の有無を気にせず、もう一度コピーすることもなくそのまま使える
+class GeometryLoad
+{
+public:
+    explicit GeometryLoad(BufferPool& buffers) : buffers(buffers) {}
+    // 展開中なら待ってから、バッファをプールへ返す
+    ~GeometryLoad();
+
+    GeometryLoad(const GeometryLoad&) = delete;
+    GeometryLoad& operator=(const GeometryLoad&) = delete;
+
+    // whatで選んだ配列の展開を始める。poolがnullptrならその場で展開する
+    void start(GeometryArrays& arrays, unsigned what, TaskPool* pool);
+    // 全部展開し終わるまで待つ。展開できなかった配列があればfalse
+    bool wait();
+
+private:
+    BufferPool& buffers;
+    TaskPool* pool = nullptr;
+    std::vector<std::vector<uint8_t>> owned;
+    std::atomic<int> pending = 0;
+    std::atomic<bool> failed = false;
+    TaskSlot slot;
+    bool started = false;
+};
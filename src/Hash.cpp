@@ -0,0 +1,129 @@
+﻿#include <bit>
+#include <cstring>
+#include "Hash.h"
+
+static constexpr uint64_t prime1 = 11400714785074694791ULL;
+static constexpr uint64_t prime2 = 14029467366897019727ULL;
+static constexpr uint64_t prime3 = 1609587929392839161ULL;
+static constexpr uint64_t prime4 = 9650029242287828579ULL;
+static constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+// 仕様はリトルエンディアンで読む前提。対象のプラットフォームはすべてリトルエンディアン
+static uint64_t read64(const unsigned char* p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t mix(uint64_t acc, uint64_t input)
+{
+    acc += input * prime2;
+    acc = std::rotl(acc, 31);
+    return acc * prime1;
+}
+
+static uint64_t merge(uint64_t hash, uint64_t acc)
+{
+    hash ^= mix(0, acc);
+    return hash * prime1 + prime4;
+}
+
+static void consume(uint64_t (&acc)[4], const unsigned char* p)
+{
+    acc[0] = mix(acc[0], read64(p));
+    acc[1] = mix(acc[1], read64(p + 8));
+    acc[2] = mix(acc[2], read64(p + 16));
+    acc[3] = mix(acc[3], read64(p + 24));
+}
+
+Xxh64::Xxh64(uint64_t seed) : seed(seed)
+{
+    acc[0] = seed + prime1 + prime2;
+    acc[1] = seed + prime2;
+    acc[2] = seed;
+    acc[3] = seed - prime1;
+}
+
+void Xxh64::update(const void* data, size_t size)
+{
+    auto p = static_cast<const unsigned char*>(data);
+    total += size;
+
+    // 前回の端数と合わせて32バイトになるまでは溜めておく
+    if (buffered + size < sizeof(buffer))
+    {
+        std::memcpy(buffer + buffered, p, size);
+        buffered += size;
+        return;
+    }
+    if (buffered > 0)
+    {
+        size_t fill = sizeof(buffer) - buffered;
+        std::memcpy(buffer + buffered, p, fill);
+        consume(acc, buffer);
+        p += fill;
+        size -= fill;
+        buffered = 0;
+    }
+
+    for (; size >= sizeof(buffer); p += sizeof(buffer), size -= sizeof(buffer)) consume(acc, p);
+
+    std::memcpy(buffer, p, size);
+    buffered = size;
+}
+
+uint64_t Xxh64::digest() const
+{
+    uint64_t hash;
+    if (total >= sizeof(buffer))
+    {
+        hash = std::rotl(acc[0], 1) + std::rotl(acc[1], 7) + std::rotl(acc[2], 12) + std::rotl(acc[3], 18);
+        for (auto a : acc) hash = merge(hash, a);
+    } else
+    {
+        hash = seed + prime5;
+    }
+    hash += total;
+
+    const unsigned char* p = buffer;
+    size_t size = buffered;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        hash ^= mix(0, read64(p));
+        hash = std::rotl(hash, 27) * prime1 + prime4;
+    }
+    if (size >= 4)
+    {
+        hash ^= read32(p) * prime1;
+        hash = std::rotl(hash, 23) * prime2 + prime3;
+        p += 4;
+        size -= 4;
+    }
+    for (; size > 0; ++p, --size)
+    {
+        hash ^= *p * prime5;
+        hash = std::rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t xxh64(const void* data, size_t size, uint64_t seed)
+{
+    Xxh64 hash(seed);
+    hash.update(data, size);
+    return hash.digest();
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// XXH64。暗号用ではないがGB/s単位で回るので、ファイル内容の同一性を見るのに使う。
+// 少しずつupdateしても一度に渡しても同じ値になる
+class Xxh64
+{
+public:
+    explicit Xxh64(uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    void update(std::string_view text) { update(text.data(), text.size()); }
+    template <typename T> void update_value(const T& value) { update(&value, sizeof(value)); }
+
+    uint64_t digest() const;
+
+private:
+    uint64_t seed;
+    uint64_t acc[4];
+    unsigned char buffer[32];
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0);
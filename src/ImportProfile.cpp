@@ -0,0 +1,252 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <ostream>
+#include "ImportProfile.h"
+#include "ReportWriter.h"
+#include "Viewer.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+bool parse_import_profile(std::string_view text, ImportProfile& profile)
+{
+    if (text == "auto") profile = ImportProfile::Auto;
+    else if (text == "full") profile = ImportProfile::Full;
+    else if (text == "materials") profile = ImportProfile::Materials;
+    else if (text == "normals") profile = ImportProfile::Normals;
+    else return false;
+    return true;
+}
+
+const char* import_profile_name(ImportProfile profile)
+{
+    switch (profile)
+    {
+    case ImportProfile::Auto: return "auto";
+    case ImportProfile::Full: return "full";
+    case ImportProfile::Materials: return "materials";
+    case ImportProfile::Normals: return "normals";
+    }
+    return "unknown";
+}
+
+void apply_import_profile(FbxIOSettings* ios, ImportProfile profile)
+{
+    bool full = profile == ImportProfile::Full || profile == ImportProfile::Auto;
+    bool materials = full || profile == ImportProfile::Materials;
+
+    // ノードとメッシュ、グローバル設定はどのレポートでも使う
+    ios->SetBoolProp(IMP_FBX_MODEL, true);
+    ios->SetBoolProp(IMP_FBX_GLOBAL_SETTINGS, true);
+
+    ios->SetBoolProp(IMP_FBX_MATERIAL, materials);
+    ios->SetBoolProp(IMP_FBX_TEXTURE, materials);
+
+    // 以下はレポートが一切見ないもの
+    ios->SetBoolProp(IMP_FBX_ANIMATION, full);
+    ios->SetBoolProp(IMP_FBX_EXTRACT_EMBEDDED_DATA, full);
+    ios->SetBoolProp(IMP_FBX_LINK, full);
+    ios->SetBoolProp(IMP_FBX_SHAPE, full);
+    ios->SetBoolProp(IMP_FBX_GOBO, full);
+    ios->SetBoolProp(IMP_FBX_CHARACTER, full);
+    ios->SetBoolProp(IMP_FBX_CHARACTERPOSE, full);
+    ios->SetBoolProp(IMP_FBX_CONSTRAINT, full);
+    ios->SetBoolProp(IMP_FBX_AUDIO, full);
+}
+
+namespace
+{
+struct ImportCost
+{
+    double milliseconds = 0;
+    // 読み込み中にSDKのアロケータから確保していた量の最大値。読み込み前からあった分は含まない
+    long long bytes = 0;
+};
+
+// SDKのmalloc/freeハンドラを差し替えて、確保中のバイト数とその最大値を数える。
+// 常駐サイズと違ってページキャッシュや前の読み込みで解放済みのヒープに左右されない。
+// 元のハンドラはCランタイムのmallocなので、大きさはブロックそのものから取る
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+        malloc_handler = FbxGetMallocHandler();
+        calloc_handler = FbxGetCallocHandler();
+        realloc_handler = FbxGetReallocHandler();
+        free_handler = FbxGetFreeHandler();
+        FbxSetMallocHandler(counted_malloc);
+        FbxSetCallocHandler(counted_calloc);
+        FbxSetReallocHandler(counted_realloc);
+        FbxSetFreeHandler(counted_free);
+    }
+
+    ~AllocationCounter()
+    {
+        FbxSetMallocHandler(malloc_handler);
+        FbxSetCallocHandler(calloc_handler);
+        FbxSetReallocHandler(realloc_handler);
+        FbxSetFreeHandler(free_handler);
+    }
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    // 最大値を今の量から測り直す
+    static long long reset_peak()
+    {
+        long long now = current.load();
+        peak.store(now);
+        return now;
+    }
+
+    static long long peak_bytes() { return peak.load(); }
+
+private:
+    static size_t block_size(void* block)
+    {
+#if defined(_WIN32)
+        return _msize(block);
+#elif defined(__APPLE__)
+        return malloc_size(block);
+#else
+        return malloc_usable_size(block);
+#endif
+    }
+
+    // 差し替える前に確保されたブロックの解放も引くので、currentは負になることがある
+    static void add(long long bytes)
+    {
+        long long now = current.fetch_add(bytes) + bytes;
+        long long high = peak.load();
+        while (now > high && !peak.compare_exchange_weak(high, now)) {}
+    }
+
+    static void* counted_malloc(size_t size)
+    {
+        void* block = malloc_handler(size);
+        if (block) add(static_cast<long long>(block_size(block)));
+        return block;
+    }
+
+    static void* counted_calloc(size_t count, size_t size)
+    {
+        void* block = calloc_handler(count, size);
+        if (block) add(static_cast<long long>(block_size(block)));
+        return block;
+    }
+
+    static void* counted_realloc(void* block, size_t size)
+    {
+        long long old_size = block ? static_cast<long long>(block_size(block)) : 0;
+        void* resized = realloc_handler(block, size);
+        // 失敗したときは元のブロックが残る
+        if (resized) add(static_cast<long long>(block_size(resized)) - old_size);
+        else if (size == 0) add(-old_size);
+        return resized;
+    }
+
+    static void counted_free(void* block)
+    {
+        if (block) add(-static_cast<long long>(block_size(block)));
+        free_handler(block);
+    }
+
+    static inline FbxMallocProc malloc_handler = nullptr;
+    static inline FbxCallocProc calloc_handler = nullptr;
+    static inline FbxReallocProc realloc_handler = nullptr;
+    static inline FbxFreeProc free_handler = nullptr;
+    static inline std::atomic<long long> current{0};
+    static inline std::atomic<long long> peak{0};
+};
+} // namespace
+
+static bool measure_import(const FbxPtr<FbxManager>& manager, const char* path, ImportProfile profile, ImportCost& cost, std::ostream& err)
+{
+    long long before = AllocationCounter::reset_peak();
+    auto start = std::chrono::steady_clock::now();
+
+    auto scene = import(manager, path, profile, err);
+    if (scene == nullptr) return false;
+
+    auto end = std::chrono::steady_clock::now();
+    cost.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    cost.bytes = std::max(AllocationCounter::peak_bytes() - before, 0LL);
+    return true;
+}
+
+static void write_cost(ReportWriter& out, ImportProfile profile, const ImportCost& cost, const ImportCost* baseline)
+{
+    char line[160];
+    int length = std::snprintf(line, sizeof(line), "    %-10s %10.1f ms %10.1f MiB peak", import_profile_name(profile), cost.milliseconds, cost.bytes / (1024.0 * 1024.0));
+    if (baseline && baseline->milliseconds > 0)
+    {
+        double saved = 100.0 * (baseline->milliseconds - cost.milliseconds) / baseline->milliseconds;
+        length += std::snprintf(line + length, sizeof(line) - length, "  (saves %.1f%% time, %.1f MiB)", saved, (baseline->bytes - cost.bytes) / (1024.0 * 1024.0));
+    }
+    out << std::string_view(line, length) << '\n';
+}
+
+bool compare_import_profiles(const std::vector<std::string>& inputs, ReportWriter& out, std::ostream& err)
+{
+    constexpr ImportProfile profiles[] = {ImportProfile::Full, ImportProfile::Materials, ImportProfile::Normals};
+    constexpr size_t profile_count = std::size(profiles);
+
+    // マネージャ自身の確保も数えられるよう、作る前に差し替えて、壊した後で戻す
+    AllocationCounter counter;
+    FbxPtr<FbxManager> manager(FbxManager::Create());
+    ImportCost totals[profile_count];
+    size_t compared = 0;
+    bool ok = true;
+
+    for (const auto& input : inputs)
+    {
+        // 最初の一回は時間がページキャッシュに載っているかどうかで大きくぶれるので捨てる
+        ImportCost warmup;
+        if (!measure_import(manager, input.c_str(), ImportProfile::Full, warmup, err))
+        {
+            err << "Failed: " << input << std::endl;
+            ok = false;
+            continue;
+        }
+
+        ImportCost costs[profile_count];
+        bool measured = true;
+        for (size_t i = 0; i < profile_count && measured; ++i) measured = measure_import(manager, input.c_str(), profiles[i], costs[i], err);
+        if (!measured)
+        {
+            err << "Failed: " << input << std::endl;
+            ok = false;
+            continue;
+        }
+
+        out << "Import profiles: " << input << '\n';
+        for (size_t i = 0; i < profile_count; ++i)
+        {
+            write_cost(out, profiles[i], costs[i], i == 0 ? nullptr : &costs[0]);
+            totals[i].milliseconds += costs[i].milliseconds;
+            totals[i].bytes += costs[i].bytes;
+        }
+        out << '\n';
+        out.flush();
+        ++compared;
+    }
+
+    if (compared > 1)
+    {
+        out << "Import profiles: total of " << compared << " files" << '\n';
+        for (size_t i = 0; i < profile_count; ++i) write_cost(out, profiles[i], totals[i], i == 0 ? nullptr : &totals[0]);
+        out.flush();
+    }
+
+    return ok;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ReportWriter;
+
+// 読み込み時にSDKへ渡すIOSettingsの組み合わせ。
+// このビューアはアニメーションや埋め込みメディア、コンストレイントなどを読まないので、
+// レポートに要る部分だけを読み込めば時間もメモリも節約できる
+enum class ImportProfile
+{
+    Auto,      // レポートの内容から選ぶ
+    Full,      // SDKの既定どおり全部読む
+    Materials, // メッシュとマテリアル・テクスチャ
+    Normals,   // メッシュだけ。マテリアルとテクスチャも読まない
+};
+
+bool parse_import_profile(std::string_view text, ImportProfile& profile);
+const char* import_profile_name(ImportProfile profile);
+
+// IOSettingsの読み込みフラグをプロファイルに合わせて設定する。
+// マネージャを使い回すときに前の設定が残らないよう、関係するフラグは全部書き直す
+void apply_import_profile(FbxIOSettings* ios, ImportProfile profile);
+
+// 各入力を全プロファイルで読み込み、読み込み時間とSDKが読み込み中に確保したメモリの最大値を比べて出力する。
+// 確保量はSDK全体のハンドラで数えるので、1ファイルずつ順に読み込む
+bool compare_import_profiles(const std::vector<std::string>& inputs, ReportWriter& out, std::ostream& err);
@@ -0,0 +1,457 @@
+﻿#include <cstdio>
+#include "JsonReport.h"
+#include "ReportWriter.h"
+
+void JsonReport::begin_record(const char* type)
+{
+    // JSONでは先頭のfileレコードの後ろに必ずカンマ区切りで続ける
+    if (!ndjson) out << ",\n";
+    json.reset();
+    json.begin_object();
+    json.field("type", type);
+}
+
+void JsonReport::end_record()
+{
+    json.end_object();
+    if (ndjson) out << '\n';
+}
+
+void JsonReport::write_vector(const FbxVector4& value, int size)
+{
+    json.begin_array();
+    for (int i = 0; i < size; ++i) json.value(value[i]);
+    json.end_array();
+}
+
+void JsonReport::begin_file(const char* path)
+{
+    if (!ndjson) out << "[\n";
+    json.reset();
+    json.begin_object();
+    json.field("type", "file");
+    json.field("path", path);
+    end_record();
+}
+
+void JsonReport::end_file()
+{
+    if (!ndjson) out << "\n]\n";
+}
+
+void JsonReport::node(FbxNode* node, int depth, std::string_view path)
+{
+    node_name = node->GetName();
+    begin_record("node");
+    json.field("name", node_name);
+    json.field("path", path);
+    json.field("depth", depth);
+    end_record();
+}
+
+void JsonReport::attribute(FbxNode* node, FbxNodeAttribute* attr)
+{
+    begin_record("attribute");
+    json.field("node", node->GetName());
+    json.field("attribute_type", attribute_type_name(attr->GetAttributeType()));
+    end_record();
+}
+
+void JsonReport::begin_mesh(FbxNode* node, FbxMesh* mesh)
+{
+    node_name = node->GetName();
+    mesh_name = mesh->GetName();
+    begin_record("mesh");
+    json.field("node", node_name);
+    json.field("name", mesh_name);
+    json.field("control_points", mesh->GetControlPointsCount());
+    json.field("polygons", mesh->GetPolygonCount());
+    json.field("polygon_vertices", mesh->GetPolygonVertexCount());
+    end_record();
+}
+
+void JsonReport::begin_normals(FbxMesh*, FbxGeometryElementNormal* element)
+{
+    begin_record("normals");
+    json.field("node", node_name);
+    json.field("mesh", mesh_name);
+    json.field("element", element->GetName());
+    json.field("mapping", mapping_mode_name(element->GetMappingMode()));
+    json.field("reference", reference_mode_name(element->GetReferenceMode()));
+    json.key("values");
+    json.begin_array();
+}
+
+void JsonReport::control_point_normal(int, const FbxVector4& normal)
+{
+    write_vector(normal, 3);
+}
+
+void JsonReport::polygon_vertex_normal(int, int, const FbxVector4& normal)
+{
+    write_vector(normal, 3);
+}
+
+void JsonReport::end_normals()
+{
+    json.end_array();
+    end_record();
+}
+
+void JsonReport::normal_validation(FbxMesh*, FbxGeometryElementNormal* element, const NormalCheckResult& result)
+{
+    static const char* const keys[normal_issue_count] = {"non_finite", "zero_length", "non_unit", "facing_away"};
+
+    begin_record("normal_validation");
+    json.field("node", node_name);
+    json.field("mesh", mesh_name);
+    json.field("element", element->GetName());
+    json.field("checked", result.checked);
+    json.field("facing_checked", result.facing_checked);
+    for (int i = 0; i < normal_issue_count; ++i)
+    {
+        json.key(keys[i]);
+        json.begin_object();
+        json.field("count", result.counts[i]);
+        json.key("first");
+        json.begin_array();
+        for (int index : result.offenders[i]) json.value(index);
+        json.end_array();
+        json.end_object();
+    }
+    end_record();
+}
+
+void JsonReport::normal_comparison(FbxMesh*, FbxGeometryElementNormal* element, const NormalComparison& comparison)
+{
+    begin_record("normal_comparison");
+    json.field("node", node_name);
+    json.field("mesh", mesh_name);
+    json.field("element", element->GetName());
+    json.field("weighting", normal_weighting_name(comparison.weighting));
+    json.field("domain", mapping_mode_name(comparison.domain));
+    json.field("compared", comparison.compared);
+    json.field("skipped", comparison.skipped);
+    json.field("mean_degrees", comparison.mean_degrees);
+    json.field("max_degrees", comparison.max_degrees);
+
+    // 区間の上限（度）をキーにする
+    json.key("histogram");
+    json.begin_object();
+    for (int i = 0; i < normal_deviation_buckets; ++i)
+    {
+        char name[16];
+        std::snprintf(name, sizeof(name), "%g", normal_deviation_limits[i]);
+        json.field(name, comparison.histogram[i]);
+    }
+    json.end_object();
+
+    json.key("worst");
+    json.begin_array();
+    for (const auto& worst : comparison.worst)
+    {
+        json.begin_object();
+        json.field("index", worst.index);
+        json.field("control_point", worst.control_point);
+        json.field("degrees", worst.degrees);
+        json.end_object();
+    }
+    json.end_array();
+    end_record();
+}
+
+void JsonReport::write_statistics(const MeshStatistics& statistics)
+{
+    json.field("control_points", statistics.control_points);
+    json.field("polygons", statistics.polygons);
+    json.field("polygon_vertices", statistics.polygon_vertices);
+    json.field("triangles", statistics.triangles);
+
+    // 頂点数をキーにする。最後の区間は"16+"のように書く
+    json.key("polygon_sizes");
+    json.begin_object();
+    for (int size = 0; size <= polygon_size_limit; ++size)
+    {
+        if (statistics.polygon_sizes[size] == 0) continue;
+        char name[16];
+        std::snprintf(name, sizeof(name), size == polygon_size_limit ? "%d+" : "%d", size);
+        json.field(name, statistics.polygon_sizes[size]);
+    }
+    json.end_object();
+
+    json.key("bounds");
+    if (statistics.has_bounds)
+    {
+        json.begin_object();
+        json.key("min");
+        json.begin_array();
+        for (double v : statistics.min) json.value(v);
+        json.end_array();
+        json.key("max");
+        json.begin_array();
+        for (double v : statistics.max) json.value(v);
+        json.end_array();
+        json.end_object();
+    } else
+    {
+        json.null();
+    }
+    json.field("surface_area", statistics.area);
+
+    json.key("material_faces");
+    json.begin_array();
+    for (int64_t faces : statistics.material_faces) json.value(faces);
+    json.end_array();
+    json.field("unassigned_faces", statistics.unassigned_faces);
+}
+
+void JsonReport::mesh_statistics(FbxMesh*, const MeshStatistics& statistics)
+{
+    begin_record("mesh_statistics");
+    json.field("node", node_name);
+    json.field("mesh", mesh_name);
+    write_statistics(statistics);
+    end_record();
+}
+
+void JsonReport::scene_statistics(const MeshStatistics& statistics)
+{
+    begin_record("scene_statistics");
+    json.field("meshes", statistics.meshes);
+    write_statistics(statistics);
+    end_record();
+}
+
+void JsonReport::begin_materials(FbxNode* node, int)
+{
+    node_name = node ? node->GetName() : "";
+}
+
+void JsonReport::begin_material(int index, FbxSurfaceMaterial* material)
+{
+    this->material = material;
+    begin_record("material");
+    json.field("node", node_name);
+    json.field("index", index);
+    json.field("name", material->GetName());
+}
+
+void JsonReport::material_id(int id)
+{
+    json.field("id", id);
+}
+
+void JsonReport::material_reference(int index, FbxSurfaceMaterial* material, int id, FbxSurfaceMaterial* original)
+{
+    begin_record("material");
+    json.field("node", node_name);
+    json.field("index", index);
+    json.field("name", material->GetName());
+    json.field("same_as", id);
+    json.field("same_as_name", original->GetName());
+    end_record();
+}
+
+void JsonReport::implementation(const FbxImplementation* implementation)
+{
+    json.field("class", "hardware_shader");
+    json.key("implementation");
+    json.begin_object();
+    json.field("language", implementation->Language.Get().Buffer());
+    json.field("language_version", implementation->LanguageVersion.Get().Buffer());
+    json.field("render_name", implementation->RenderName.Buffer());
+    json.field("render_api", implementation->RenderAPI.Get().Buffer());
+    json.field("render_api_version", implementation->RenderAPIVersion.Get().Buffer());
+    json.key("bindings");
+    json.begin_array();
+    in_bindings = true;
+}
+
+void JsonReport::close_binding()
+{
+    if (in_textures)
+    {
+        json.end_array();
+        in_textures = false;
+    }
+    if (in_binding)
+    {
+        json.end_object();
+        in_binding = false;
+    }
+}
+
+void JsonReport::binding_entry(const char* source)
+{
+    close_binding();
+    json.begin_object();
+    json.field("entry", source);
+    in_binding = true;
+}
+
+void JsonReport::binding_texture(TextureKind kind, const char* name)
+{
+    if (!in_textures)
+    {
+        json.key("textures");
+        json.begin_array();
+        in_textures = true;
+    }
+    json.begin_object();
+    switch (kind)
+    {
+    case TextureKind::File: json.field("kind", "file"); break;
+    case TextureKind::Layered: json.field("kind", "layered"); break;
+    case TextureKind::Procedural: json.field("kind", "procedural"); break;
+    }
+    json.field("name", name);
+    json.end_object();
+}
+
+void JsonReport::begin_binding_value(const char* type)
+{
+    json.field("value_type", type);
+    json.key("value");
+}
+
+void JsonReport::binding_bool(bool value)
+{
+    begin_binding_value("bool");
+    json.value(value);
+}
+
+void JsonReport::binding_int(int value)
+{
+    begin_binding_value("int");
+    json.value(value);
+}
+
+void JsonReport::binding_float(double value)
+{
+    begin_binding_value("float");
+    json.value(value);
+}
+
+void JsonReport::binding_double(double value)
+{
+    begin_binding_value("double");
+    json.value(value);
+}
+
+void JsonReport::binding_string(const char* value)
+{
+    begin_binding_value("string");
+    json.value(value);
+}
+
+void JsonReport::binding_vector(const FbxVector4& value, int size)
+{
+    begin_binding_value(size == 2 ? "double2" : size == 3 ? "double3" : "double4");
+    write_vector(value, size);
+}
+
+void JsonReport::binding_matrix(const FbxDouble4x4& value)
+{
+    begin_binding_value("double4x4");
+    json.begin_array();
+    for (int j = 0; j < 4; ++j)
+    {
+        json.begin_array();
+        for (int k = 0; k < 4; ++k) json.value(value[j][k]);
+        json.end_array();
+    }
+    json.end_array();
+}
+
+void JsonReport::binding_int64(long long value)
+{
+    begin_binding_value("int64");
+    json.value(value);
+}
+
+void JsonReport::binding_time(const FbxTime& value)
+{
+    begin_binding_value("time");
+    json.value(value.GetSecondDouble());
+}
+
+void JsonReport::binding_reference(FbxObject* object)
+{
+    begin_binding_value("reference");
+    if (object) json.value(object->GetName());
+    else json.null();
+}
+
+void JsonReport::binding_blob(size_t size)
+{
+    begin_binding_value("blob");
+    json.value(size);
+}
+
+void JsonReport::binding_distance(double value, const char* unit)
+{
+    begin_binding_value("distance");
+    json.value(value);
+    json.field("unit", unit);
+}
+
+void JsonReport::binding_unsupported(const char* type_name)
+{
+    json.field("value_type", "unsupported");
+    json.field("type_name", type_name);
+}
+
+void JsonReport::open_properties()
+{
+    if (in_properties) return;
+    json.field("class", material->GetClassId().Is(FbxSurfacePhong::ClassId) ? "phong" : "lambert");
+    json.key("properties");
+    json.begin_object();
+    in_properties = true;
+}
+
+void JsonReport::close_properties()
+{
+    if (in_bindings)
+    {
+        close_binding();
+        json.end_array();
+        json.end_object();
+        in_bindings = false;
+    }
+    if (in_properties)
+    {
+        json.end_object();
+        in_properties = false;
+    }
+}
+
+void JsonReport::material_color(const char* name, const FbxColor& value)
+{
+    open_properties();
+    json.key(name);
+    json.begin_array();
+    json.value(value.mRed);
+    json.value(value.mGreen);
+    json.value(value.mBlue);
+    json.end_array();
+}
+
+void JsonReport::material_scalar(const char* name, double value)
+{
+    open_properties();
+    json.field(name, value);
+}
+
+void JsonReport::unknown_material()
+{
+    json.field("class", "unknown");
+}
+
+void JsonReport::end_material(const char* shading_model)
+{
+    close_properties();
+    json.field("shading_model", shading_model);
+    end_record();
+    material = nullptr;
+}
@@ -0,0 +1,122 @@
+﻿#include <cmath>
+#include "JsonWriter.h"
+#include "ReportWriter.h"
+
+void JsonWriter::separate()
+{
+    if (after_key)
+    {
+        after_key = false;
+        return;
+    }
+    if (depth > 0 && !first[depth]) out << ',';
+    first[depth] = false;
+}
+
+void JsonWriter::begin_object()
+{
+    separate();
+    out << '{';
+    first[++depth] = true;
+}
+
+void JsonWriter::end_object()
+{
+    --depth;
+    out << '}';
+}
+
+void JsonWriter::begin_array()
+{
+    separate();
+    out << '[';
+    first[++depth] = true;
+}
+
+void JsonWriter::end_array()
+{
+    --depth;
+    out << ']';
+}
+
+void JsonWriter::key(std::string_view name)
+{
+    separate();
+    write_string(name);
+    out << ':';
+    after_key = true;
+}
+
+void JsonWriter::value(std::string_view text)
+{
+    separate();
+    write_string(text);
+}
+
+void JsonWriter::value(bool b)
+{
+    separate();
+    out << (b ? "true" : "false");
+}
+
+void JsonWriter::value(long long n)
+{
+    separate();
+    out.write_int(n);
+}
+
+void JsonWriter::value(unsigned long long n)
+{
+    separate();
+    out.write_uint(n);
+}
+
+void JsonWriter::value(double d)
+{
+    separate();
+    // JSONにはNaN/Infの表現がないので、文字列にして値を残す
+    if (std::isnan(d)) out << "\"NaN\"";
+    else if (std::isinf(d)) out << (d > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+    else out.write_shortest(d);
+}
+
+void JsonWriter::null()
+{
+    separate();
+    out << "null";
+}
+
+void JsonWriter::raw(std::string_view text)
+{
+    out << text;
+}
+
+void JsonWriter::write_string(std::string_view text)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    out << '"';
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        // エスケープ不要な区間はまとめて書く
+        out << text.substr(run, i - run);
+        run = i + 1;
+        switch (c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+            break;
+        }
+    }
+    out << text.substr(run);
+    out << '"';
+}
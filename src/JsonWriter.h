@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <cstdint>
+#include <string_view>
+
+class ReportWriter;
+
+// ReportWriterへ直接書き込むストリーミングJSONライタ。
+// DOMを作らず、カンマの要否だけを入れ子の深さごとに覚えておく。
+class JsonWriter
+{
+public:
+    static constexpr int max_depth = 64;
+
+    explicit JsonWriter(ReportWriter& out) : out(out) {}
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    void key(std::string_view name);
+
+    void value(std::string_view text);
+    void value(const char* text) { value(std::string_view(text ? text : "")); }
+    void value(bool b);
+    void value(int n) { value(static_cast<long long>(n)); }
+    void value(unsigned n) { value(static_cast<unsigned long long>(n)); }
+    void value(long n) { value(static_cast<long long>(n)); }
+    void value(unsigned long n) { value(static_cast<unsigned long long>(n)); }
+    void value(long long n);
+    void value(unsigned long long n);
+    void value(double d);
+    void null();
+
+    // 値の後ろに何も挟まずに書く（NDJSONの改行など）
+    void raw(std::string_view text);
+
+    template <typename T> void field(std::string_view name, const T& v)
+    {
+        key(name);
+        value(v);
+    }
+
+    // トップレベルに戻す。次の値はカンマなしで始まる
+    void reset()
+    {
+        depth = 0;
+        after_key = false;
+        first[0] = true;
+    }
+
+    int get_depth() const { return depth; }
+
+private:
+    void separate();
+    void write_string(std::string_view text);
+
+    ReportWriter& out;
+    int depth = 0;
+    bool after_key = false;
+    bool first[max_depth] = {true};
+};
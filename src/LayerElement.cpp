@@ -0,0 +1,59 @@
+﻿#include "LayerElement.h"
+
+int mapping_domain_size(const FbxMesh* mesh, FbxGeometryElement::EMappingMode mapping)
+{
+    switch (mapping)
+    {
+    case FbxGeometryElement::eByControlPoint: return mesh->GetControlPointsCount();
+    case FbxGeometryElement::eByPolygonVertex: return mesh->GetPolygonVertexCount();
+    case FbxGeometryElement::eByPolygon: return mesh->GetPolygonCount();
+    case FbxGeometryElement::eByEdge: return mesh->GetMeshEdgeCount();
+    case FbxGeometryElement::eAllSame: return 1;
+    default: return 0;
+    }
+}
+
+void polygon_starts(const FbxMesh* mesh, std::pmr::vector<int>& starts)
+{
+    int polygon_count = mesh->GetPolygonCount();
+    starts.resize(polygon_count + 1);
+    for (int pi = 0; pi < polygon_count; ++pi) starts[pi] = mesh->GetPolygonVertexIndex(pi);
+    starts[polygon_count] = mesh->GetPolygonVertexCount();
+}
+
+void resolve_material_indices(const FbxMesh* mesh, const FbxGeometryElementMaterial* element, ResolvedElement<int>& resolved)
+{
+    resolved.mapping = element->GetMappingMode();
+    resolved.reference = element->GetReferenceMode();
+    resolved.invalid_indices = 0;
+
+    int count = mapping_domain_size(mesh, resolved.mapping);
+    LockedArray<int> index(element->GetIndexArray());
+    if (index.size() < count)
+    {
+        resolved.invalid_indices = count - index.size();
+        count = index.size();
+    }
+    resolved.values.resize(count);
+    if (index.get())
+    {
+        std::copy_n(index.get(), count, resolved.values.begin());
+    } else
+    {
+        for (int i = 0; i < count; ++i) resolved.values[i] = element->GetIndexArray().GetAt(i);
+    }
+}
+
+void split_vectors(const std::pmr::vector<FbxVector4>& values, SoaVectors& soa)
+{
+    size_t count = values.size();
+    soa.x.resize(count);
+    soa.y.resize(count);
+    soa.z.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        soa.x[i] = static_cast<float>(values[i][0]);
+        soa.y[i] = static_cast<float>(values[i][1]);
+        soa.z[i] = static_cast<float>(values[i][2]);
+    }
+}
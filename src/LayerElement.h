@@ -0,0 +1,147 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+#include "Arena.h"
+
+// レイヤ要素の配列を読み取りロックしたまま生のポインタで参照する。
+// 要素ごとのGetAt()を避けて、配列を一度だけ取り出すために使う
+template <typename T> class LockedArray
+{
+public:
+    explicit LockedArray(FbxLayerElementArrayTemplate<T>& array) : array(array), count(array.GetCount())
+    {
+        data = array.GetLocked(FbxLayerElementArray::eReadLock);
+    }
+    ~LockedArray()
+    {
+        if (data) array.Release(&data);
+    }
+
+    LockedArray(const LockedArray&) = delete;
+    LockedArray& operator=(const LockedArray&) = delete;
+
+    // ロックが取れなかった場合はnullptr（呼び出し側でGetAt()に切り替える）
+    const T* get() const { return data; }
+    int size() const { return count; }
+
+private:
+    FbxLayerElementArrayTemplate<T>& array;
+    T* data = nullptr;
+    int count;
+};
+
+// マッピングの単位（制御点・ポリゴン頂点・ポリゴン・エッジ）ごとに展開済みの要素
+template <typename T> struct ResolvedElement
+{
+    FbxGeometryElement::EMappingMode mapping = FbxGeometryElement::eNone;
+    FbxGeometryElement::EReferenceMode reference = FbxGeometryElement::eDirect;
+    std::pmr::vector<T> values = std::pmr::vector<T>(analysis_memory());
+    // 範囲外を指していたインデックスの数。該当する値はT()で埋める
+    int invalid_indices = 0;
+};
+
+// マッピングの単位の数。対応していないマッピングなら0
+int mapping_domain_size(const FbxMesh* mesh, FbxGeometryElement::EMappingMode mapping);
+
+// 各ポリゴンの先頭のポリゴン頂点番号。末尾に総数を足してpolygon_count + 1個にする
+void polygon_starts(const FbxMesh* mesh, std::pmr::vector<int>& starts);
+
+// 直接配列とインデックス配列を一度ずつロックし、1パスで参照を解決する
+template <typename T> void resolve_element(const FbxMesh* mesh, const FbxLayerElementTemplate<T>* element, ResolvedElement<T>& resolved)
+{
+    resolved.mapping = element->GetMappingMode();
+    resolved.reference = element->GetReferenceMode();
+    resolved.invalid_indices = 0;
+
+    int count = mapping_domain_size(mesh, resolved.mapping);
+    resolved.values.resize(count);
+    T* out = resolved.values.data();
+
+    LockedArray<T> direct(element->GetDirectArray());
+    const T* values = direct.get();
+    int value_count = direct.size();
+
+    if (resolved.reference == FbxGeometryElement::eDirect)
+    {
+        if (value_count < count)
+        {
+            resolved.invalid_indices = count - value_count;
+            count = value_count;
+        }
+        if (values)
+        {
+            for (int i = 0; i < count; ++i) out[i] = values[i];
+        } else
+        {
+            for (int i = 0; i < count; ++i) out[i] = element->GetDirectArray().GetAt(i);
+        }
+        return;
+    }
+
+    // eIndexとeIndexToDirectはどちらもインデックス配列を経由して引く
+    LockedArray<int> index(element->GetIndexArray());
+    const int* indices = index.get();
+    if (index.size() < count)
+    {
+        resolved.invalid_indices = count - index.size();
+        count = index.size();
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        int ni = indices ? indices[i] : element->GetIndexArray().GetAt(i);
+        if (ni < 0 || ni >= value_count)
+        {
+            ++resolved.invalid_indices;
+            continue;
+        }
+        out[i] = values ? values[ni] : element->GetDirectArray().GetAt(ni);
+    }
+}
+
+// マテリアル要素はインデックス配列だけが意味を持つので、マテリアル番号として解決する
+void resolve_material_indices(const FbxMesh* mesh, const FbxGeometryElementMaterial* element, ResolvedElement<int>& resolved);
+
+// 解決済みの要素をポリゴン頂点の単位に並べ直す。エッジ単位には対応しない
+template <typename T> bool expand_to_polygon_vertex(const FbxMesh* mesh, const ResolvedElement<T>& resolved, std::pmr::vector<T>& values)
+{
+    int count = mesh->GetPolygonVertexCount();
+    values.resize(count);
+    switch (resolved.mapping)
+    {
+    case FbxGeometryElement::eByPolygonVertex:
+        std::copy_n(resolved.values.begin(), std::min<size_t>(count, resolved.values.size()), values.begin());
+        return true;
+    case FbxGeometryElement::eByControlPoint:
+    {
+        const int* vertices = mesh->GetPolygonVertices();
+        int point_count = static_cast<int>(resolved.values.size());
+        for (int i = 0; i < count; ++i) values[i] = vertices[i] >= 0 && vertices[i] < point_count ? resolved.values[vertices[i]] : T();
+        return true;
+    }
+    case FbxGeometryElement::eByPolygon:
+    {
+        std::pmr::vector<int> starts(analysis_memory());
+        polygon_starts(mesh, starts);
+        for (size_t pi = 0; pi + 1 < starts.size() && pi < resolved.values.size(); ++pi) std::fill(values.begin() + starts[pi], values.begin() + starts[pi + 1], resolved.values[pi]);
+        return true;
+    }
+    case FbxGeometryElement::eAllSame:
+        std::fill(values.begin(), values.end(), resolved.values.empty() ? T() : resolved.values[0]);
+        return true;
+    default: return false;
+    }
+}
+
+// x/y/z成分を別々に持つfloat配列（ベクトル化した検査やダンプ用）
+struct SoaVectors
+{
+    std::pmr::vector<float> x = std::pmr::vector<float>(analysis_memory());
+    std::pmr::vector<float> y = std::pmr::vector<float>(analysis_memory());
+    std::pmr::vector<float> z = std::pmr::vector<float>(analysis_memory());
+
+    size_t size() const { return x.size(); }
+};
+
+void split_vectors(const std::pmr::vector<FbxVector4>& values, SoaVectors& soa);
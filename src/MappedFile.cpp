@@ -0,0 +1,108 @@
+﻿#include "MappedFile.h"
+#include <ostream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path, std::ostream& err)
+{
+    close();
+#if defined(_WIN32)
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        err << "Error: Unable to open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        err << "Error: Unable to get the size of " << path << std::endl;
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    // 空のファイルはマップできないので、長さ0のまま成功にする
+    if (length == 0) return true;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        err << "Error: Unable to open " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        err << "Error: Unable to get the size of " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped != MAP_FAILED)
+    {
+        bytes = static_cast<const uint8_t*>(mapped);
+        madvise(mapped, length, MADV_SEQUENTIAL);
+    }
+#endif
+    if (bytes == nullptr)
+    {
+        err << "Error: Unable to map " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+void MappedFile::release(size_t offset, size_t count) const
+{
+    if (bytes == nullptr || offset >= length) return;
+    if (count > length - offset) count = length - offset;
+#if defined(_WIN32)
+    // ファイルに裏付けられたページなので、作業セットから外すだけで内容は失われない
+    VirtualUnlock(const_cast<uint8_t*>(bytes + offset), count);
+#else
+    // ページ境界の内側だけを返す
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = (offset + count) / page * page;
+    if (end > begin) madvise(const_cast<uint8_t*>(bytes + begin), end - begin, MADV_DONTNEED);
+#endif
+}
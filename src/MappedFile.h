@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// 読み取り専用でメモリにマップしたファイル。
+// ページはOSが必要になったときに読み込むので、ファイル全体を確保せずに大きなファイルを辿れる
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path, std::ostream& err);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // 読み終えた範囲のページを手放して、常駐メモリが読んだ量に比例して増えないようにする
+    void release(size_t offset, size_t count) const;
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
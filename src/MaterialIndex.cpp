@@ -0,0 +1,343 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <set>
+#include "Arena.h"
+#include "Hash.h"
+#include "JsonWriter.h"
+#include "MaterialIndex.h"
+#include "Query.h"
+#include "ReportWriter.h"
+#include "Viewer.h"
+
+namespace
+{
+// read_material()が流すイベントをそのままハッシュに混ぜるレポート。
+// レポートに出る内容が同じなら指紋も同じになる
+class FingerprintReport : public Report
+{
+public:
+    explicit FingerprintReport(ReportWriter& out) : Report(out) {}
+
+    uint64_t digest() const { return hash.digest(); }
+
+    std::unique_ptr<Report> fork(ReportWriter& part) const override { return std::make_unique<FingerprintReport>(part); }
+    void begin_file(const char*) override {}
+    void end_file() override {}
+    void node(FbxNode*, int, std::string_view) override {}
+    void attribute(FbxNode*, FbxNodeAttribute*) override {}
+    void begin_mesh(FbxNode*, FbxMesh*) override {}
+    void end_mesh() override {}
+    void begin_normals(FbxMesh*, FbxGeometryElementNormal*) override {}
+    void control_point_normal(int, const FbxVector4&) override {}
+    void polygon_vertex_normal(int, int, const FbxVector4&) override {}
+    void end_normals() override {}
+    void normal_validation(FbxMesh*, FbxGeometryElementNormal*, const NormalCheckResult&) override {}
+    void normal_comparison(FbxMesh*, FbxGeometryElementNormal*, const NormalComparison&) override {}
+    void mesh_statistics(FbxMesh*, const MeshStatistics&) override {}
+    void scene_statistics(const MeshStatistics&) override {}
+    void begin_materials(FbxNode*, int) override {}
+    void begin_material(int, FbxSurfaceMaterial*) override {}
+    void material_id(int) override {}
+    void material_reference(int, FbxSurfaceMaterial*, int, FbxSurfaceMaterial*) override {}
+
+    void implementation(const FbxImplementation* implementation) override
+    {
+        tag('I');
+        text(implementation->Language.Get().Buffer());
+        text(implementation->LanguageVersion.Get().Buffer());
+        text(implementation->RenderName.Buffer());
+        text(implementation->RenderAPI.Get().Buffer());
+        text(implementation->RenderAPIVersion.Get().Buffer());
+    }
+    void binding_entry(const char* source) override
+    {
+        tag('E');
+        text(source);
+    }
+    void binding_texture(TextureKind kind, const char* name) override
+    {
+        tag('T');
+        hash.update_value(kind);
+        text(name);
+    }
+    void binding_bool(bool value) override { value_of('b', value); }
+    void binding_int(int value) override { value_of('i', value); }
+    void binding_float(double value) override { value_of('f', value); }
+    void binding_double(double value) override { value_of('d', value); }
+    void binding_string(const char* value) override
+    {
+        tag('s');
+        text(value);
+    }
+    void binding_vector(const FbxVector4& value, int size) override
+    {
+        tag('v');
+        hash.update(value.mData, sizeof(double) * size);
+    }
+    void binding_matrix(const FbxDouble4x4& value) override
+    {
+        tag('m');
+        for (int j = 0; j < 4; ++j) hash.update(&value[j][0], sizeof(double) * 4);
+    }
+    void binding_int64(long long value) override { value_of('l', value); }
+    void binding_time(const FbxTime& value) override { value_of('t', value.Get()); }
+    void binding_reference(FbxObject* object) override
+    {
+        tag('r');
+        text(object ? object->GetName() : nullptr);
+    }
+    void binding_blob(size_t size) override { value_of('B', size); }
+    void binding_distance(double value, const char* unit) override
+    {
+        value_of('D', value);
+        text(unit);
+    }
+    void binding_unsupported(const char* type_name) override
+    {
+        tag('X');
+        text(type_name);
+    }
+    void material_color(const char* name, const FbxColor& value) override
+    {
+        tag('C');
+        text(name);
+        double rgb[] = {value.mRed, value.mGreen, value.mBlue};
+        hash.update(rgb, sizeof(rgb));
+    }
+    void material_scalar(const char* name, double value) override
+    {
+        tag('S');
+        text(name);
+        hash.update_value(value);
+    }
+    void unknown_material() override { tag('U'); }
+    void end_material(const char* shading_model) override
+    {
+        tag('M');
+        text(shading_model);
+    }
+    void end_materials() override {}
+
+    // レポートには出ないが、プロパティに直接繋がったテクスチャも区別に使う
+    void texture(const char* file_name)
+    {
+        tag('F');
+        text(file_name);
+    }
+
+private:
+    void tag(char c) { hash.update_value(c); }
+    // 区切りが曖昧にならないよう長さも混ぜる
+    void text(const char* value)
+    {
+        std::string_view view = value ? value : "";
+        hash.update_value(view.size());
+        hash.update(view);
+    }
+    template <typename T> void value_of(char c, T value)
+    {
+        tag(c);
+        hash.update_value(value);
+    }
+
+    Xxh64 hash;
+};
+} // namespace
+
+// マテリアルのプロパティに繋がったファイルテクスチャの名前を集める
+static void collect_textures(FbxSurfaceMaterial* material, std::pmr::vector<std::pmr::string>& names)
+{
+    for (auto property = material->GetFirstProperty(); property.IsValid(); property = material->GetNextProperty(property))
+    {
+        int count = property.GetSrcObjectCount<FbxFileTexture>();
+        for (int i = 0; i < count; ++i)
+        {
+            auto texture = property.GetSrcObject<FbxFileTexture>(i);
+            if (texture && texture->GetFileName()) names.emplace_back(texture->GetFileName());
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+MaterialIndex::MaterialIndex()
+    : mesh_uses(analysis_memory()), material_ids(analysis_memory()), fingerprint_ids(analysis_memory()), originals(analysis_memory()), report_ids(analysis_memory()),
+      reported(analysis_memory()), textures(analysis_memory())
+{
+}
+
+uint64_t material_fingerprint(FbxSurfaceMaterial* material, std::pmr::vector<std::pmr::string>& textures)
+{
+    collect_textures(material, textures);
+
+    ReportWriter unused(nullptr, 16);
+    FingerprintReport fingerprint(unused);
+    read_material(material, fingerprint);
+    for (const auto& name : textures) fingerprint.texture(name.c_str());
+    return fingerprint.digest();
+}
+
+int MaterialIndex::identify(FbxSurfaceMaterial* material)
+{
+    auto found = material_ids.find(material);
+    if (found != material_ids.end()) return found->second;
+
+    std::pmr::vector<std::pmr::string> names(textures.get_allocator());
+    uint64_t digest = material_fingerprint(material, names);
+
+    auto [it, inserted] = fingerprint_ids.try_emplace(digest, static_cast<int>(originals.size()));
+    if (inserted)
+    {
+        originals.push_back(material);
+        report_ids.push_back(-1);
+        textures.push_back(std::move(names));
+    }
+    material_ids.emplace(material, it->second);
+    return it->second;
+}
+
+void MaterialIndex::add_mesh(FbxMesh* mesh, const Query* query, const QueryItem* item)
+{
+    auto node = mesh->GetNode();
+    if (node == nullptr || mesh_uses.count(mesh)) return;
+
+    // 空のスロットがあるメッシュは索引に入れず、従来どおり全部詳しく出す
+    int count = node->GetMaterialCount();
+    for (int i = 0; i < count; ++i)
+    {
+        if (node->GetMaterial(i) == nullptr) return;
+    }
+
+    // collect()で落ちるメッシュは解析されないが、テクスチャの集計には含めるので指紋だけ取る
+    if (item == nullptr)
+    {
+        for (int i = 0; i < count; ++i) identify(node->GetMaterial(i));
+        return;
+    }
+
+    // DisplayMaterial()と同じくマテリアルごとに--whereを見直し、落ちるスロットには番号を付けない
+    bool filter = query && query->uses(QueryField::Materials);
+    auto& uses = mesh_uses[mesh];
+    for (int i = 0; i < count; ++i)
+    {
+        auto material = node->GetMaterial(i);
+        int fingerprint = identify(material);
+        if (filter)
+        {
+            QueryItem slot = *item;
+            slot.material = material;
+            if (!query->matches(slot))
+            {
+                uses.push_back({-1, false, nullptr});
+                continue;
+            }
+        }
+
+        int& id = report_ids[fingerprint];
+        bool first = id < 0;
+        if (first)
+        {
+            id = static_cast<int>(reported.size());
+            reported.push_back(material);
+        }
+        uses.push_back({id, first, reported[id]});
+    }
+}
+
+void MaterialIndex::visit(FbxNode* node, int depth, std::string& path, const Query* query)
+{
+    for (int i = 0; i < node->GetChildCount(); ++i)
+    {
+        auto child = node->GetChild(i);
+        if (child == nullptr) continue;
+
+        size_t length = path.size();
+        path += '/';
+        path += child->GetName();
+        for (int a = 0; a < child->GetNodeAttributeCount(); ++a)
+        {
+            auto attr = child->GetNodeAttributeByIndex(a);
+            if (attr == nullptr || attr->GetAttributeType() != FbxNodeAttribute::eMesh) continue;
+            QueryItem item{child, attr, path, depth};
+            bool matched = query == nullptr || query->matches(item);
+            add_mesh(static_cast<FbxMesh*>(attr), query, matched ? &item : nullptr);
+        }
+        visit(child, depth + 1, path, query);
+        path.resize(length);
+    }
+}
+
+void MaterialIndex::build(FbxScene* scene, const Query* query)
+{
+    // read()のcollect()と同じ順に辿るので、最初に詳しく出る場所はレポートの中でも最初になる
+    auto root = scene->GetRootNode();
+    if (root == nullptr) return;
+    std::string path;
+    visit(root, 0, path, query);
+}
+
+const MaterialUse* MaterialIndex::uses(FbxGeometry* geometry) const
+{
+    auto found = mesh_uses.find(geometry);
+    if (found == mesh_uses.end() || found->second.empty()) return nullptr;
+    return found->second.data();
+}
+
+void TextureUsage::add(const MaterialIndex& index)
+{
+    // ファイル内では同じテクスチャを何度使っていても1ファイルと数える
+    std::pmr::map<std::pmr::string, size_t> materials(analysis_memory());
+    for (int id = 0; id < index.unique_count(); ++id)
+    {
+        for (const auto& name : index.textures_of(id)) ++materials[name];
+    }
+
+    std::lock_guard lock(mutex);
+    ++files;
+    for (const auto& [name, count] : materials)
+    {
+        auto& entry = entries[std::string(name)];
+        ++entry.files;
+        entry.materials += count;
+    }
+}
+
+void TextureUsage::write(ReportFormat format, ReportWriter& out) const
+{
+    std::lock_guard lock(mutex);
+    std::vector<std::pair<const std::string*, Entry>> sorted;
+    for (const auto& [name, entry] : entries) sorted.emplace_back(&name, entry);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.files > b.second.files; });
+
+    if (format == ReportFormat::Text)
+    {
+        out << "Texture usage: " << sorted.size() << " textures in " << files << " files" << '\n';
+        out << "     files  materials  path" << '\n';
+        char line[32];
+        for (const auto& [name, entry] : sorted)
+        {
+            std::snprintf(line, sizeof(line), "    %6zu %10zu  ", entry.files, entry.materials);
+            out << line << *name << '\n';
+        }
+        return;
+    }
+
+    // --format=jsonとは組み合わせられないので、ndjsonの1レコードとして後ろに付ける
+    JsonWriter json(out);
+    json.begin_object();
+    json.field("type", "texture_usage");
+    json.field("files", files);
+    json.key("textures");
+    json.begin_array();
+    for (const auto& [name, entry] : sorted)
+    {
+        json.begin_object();
+        json.field("path", *name);
+        json.field("files", entry.files);
+        json.field("materials", entry.materials);
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    out << '\n';
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Report.h"
+
+class Query;
+class ReportWriter;
+struct QueryItem;
+
+// メッシュのマテリアルスロット一つが指すマテリアル
+struct MaterialUse
+{
+    // 内容が同じマテリアルには同じ番号が付く。レポートに出るものの中で階層順に最初に使われた順。
+    // --whereで落ちるスロットは-1
+    int id;
+    // この番号がレポートの中で最初に現れた場所ならtrue
+    bool first;
+    // この番号でレポートに最初に現れたマテリアル
+    FbxSurfaceMaterial* original;
+};
+
+// レポートに出る内容とプロパティに繋がったテクスチャのファイル名から作る、名前を含まない指紋。
+// texturesにはそのファイル名を重複なしで並べて返す
+uint64_t material_fingerprint(FbxSurfaceMaterial* material, std::pmr::vector<std::pmr::string>& textures);
+
+// シーン中のマテリアルを一度ずつ指紋に変えて、内容の同じものをまとめる索引。
+// 指紋はレポートに出る内容(プロパティ、実装とバインディング、シェーディングモデル)と
+// プロパティに繋がったテクスチャのファイル名から作る。名前は含めない
+class MaterialIndex
+{
+public:
+    // 中身は作った時点のanalysis_memory()に置く
+    MaterialIndex();
+
+    // メッシュを階層順に辿って索引を作る。queryがあればread()で残るメッシュとマテリアルだけに番号を付ける
+    void build(FbxScene* scene, const Query* query = nullptr);
+
+    // geometryのノードのマテリアルスロットごとの割り当て。索引に無ければnullptr
+    const MaterialUse* uses(FbxGeometry* geometry) const;
+
+    int unique_count() const { return static_cast<int>(originals.size()); }
+    // 番号ごとのテクスチャのファイル名(重複なし)
+    const std::pmr::vector<std::pmr::string>& textures_of(int id) const { return textures[id]; }
+
+private:
+    void visit(FbxNode* node, int depth, std::string& path, const Query* query);
+    void add_mesh(FbxMesh* mesh, const Query* query, const QueryItem* item);
+    int identify(FbxSurfaceMaterial* material);
+
+    std::pmr::unordered_map<FbxGeometry*, std::pmr::vector<MaterialUse>> mesh_uses;
+    std::pmr::unordered_map<FbxSurfaceMaterial*, int> material_ids;
+    std::pmr::unordered_map<uint64_t, int> fingerprint_ids;
+    std::pmr::vector<FbxSurfaceMaterial*> originals;
+    // 指紋ごとのレポート上の番号。まだ出ていなければ-1
+    std::pmr::vector<int> report_ids;
+    // レポート上の番号ごとに最初に出たマテリアル
+    std::pmr::vector<FbxSurfaceMaterial*> reported;
+    std::pmr::vector<std::pmr::vector<std::pmr::string>> textures;
+};
+
+// バッチ全体でどのテクスチャがいくつのファイル・マテリアルから使われているかの表。
+// 複数のワーカースレッドから同時にadd()してよい
+class TextureUsage
+{
+public:
+    void add(const MaterialIndex& index);
+
+    // 使っているファイルの多い順に書く
+    void write(ReportFormat format, ReportWriter& out) const;
+
+private:
+    struct Entry
+    {
+        size_t files = 0;
+        size_t materials = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    size_t files = 0;
+};
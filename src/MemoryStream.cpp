@@ -0,0 +1,46 @@
+﻿#include <algorithm>
+#include <cstring>
+#include "MemoryStream.h"
+
+bool MemoryStream::Open(void*)
+{
+    opened = true;
+    position = 0;
+    error = 0;
+    return true;
+}
+
+bool MemoryStream::Close()
+{
+    opened = false;
+    return true;
+}
+
+size_t MemoryStream::Write(const void*, FbxUInt64)
+{
+    error = 1;
+    return 0;
+}
+
+size_t MemoryStream::Read(void* buffer, FbxUInt64 size) const
+{
+    size_t count = static_cast<size_t>(std::min<FbxUInt64>(size, data.size() - position));
+    std::memcpy(buffer, data.data() + position, count);
+    position += count;
+    return count;
+}
+
+void MemoryStream::Seek(const FbxInt64& offset, const FbxFile::ESeekPos& origin)
+{
+    FbxInt64 base = 0;
+    if (origin == FbxFile::eCurrent) base = static_cast<FbxInt64>(position);
+    else if (origin == FbxFile::eEnd) base = static_cast<FbxInt64>(data.size());
+    SetPosition(base + offset);
+}
+
+void MemoryStream::SetPosition(FbxInt64 target)
+{
+    // 範囲外は端に寄せてエラーにする
+    if (target < 0 || target > static_cast<FbxInt64>(data.size())) error = 1;
+    position = static_cast<size_t>(std::clamp<FbxInt64>(target, 0, static_cast<FbxInt64>(data.size())));
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <string_view>
+
+// メモリに読み込み済みのファイルの中身をインポーターに渡すための読み取り専用ストリーム。
+// 中身はインポートが終わるまで呼び出し側が持っておくこと
+class MemoryStream : public FbxStream
+{
+public:
+    // reader_idはFbxIOPluginRegistryのリーダーの番号
+    MemoryStream(std::string_view data, int reader_id) : data(data), reader_id(reader_id) {}
+
+    EState GetState() override { return opened ? eOpen : eClosed; }
+    bool Open(void* stream_data) override;
+    bool Close() override;
+    bool Flush() override { return true; }
+    size_t Write(const void* buffer, FbxUInt64 size) override;
+    size_t Read(void* buffer, FbxUInt64 size) const override;
+    int GetReaderID() const override { return reader_id; }
+    int GetWriterID() const override { return -1; }
+    void Seek(const FbxInt64& offset, const FbxFile::ESeekPos& origin) override;
+    FbxInt64 GetPosition() const override { return static_cast<FbxInt64>(position); }
+    void SetPosition(FbxInt64 position) override;
+    int GetError() const override { return error; }
+    void ClearError() override { error = 0; }
+
+private:
+    std::string_view data;
+    int reader_id;
+    // Read()がconstなので、読んだ位置はmutableにする
+    mutable size_t position = 0;
+    bool opened = false;
+    int error = 0;
+};
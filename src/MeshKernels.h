@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <cmath>
+#include <cstddef>
+
+// メッシュ統計のカーネルの実装間で共有する定義。
+// スカラー版とAVX2版は同じ演算順序で計算し、結果が一致するようにする
+namespace mesh_kernels
+{
+// 面積はこの数の三角形ごとにまとめて計算する
+constexpr size_t triangle_batch = 1024;
+
+// 扇形に分割した三角形の頂点番号
+struct Triangles
+{
+    int a[triangle_batch];
+    int b[triangle_batch];
+    int c[triangle_batch];
+    size_t count = 0;
+};
+
+// 以下の補助関数はAVX2版では-mavx2付きでコンパイルされるので、内部リンケージにしておく
+namespace
+{
+// pointsはFbxVector4の配列をdoubleの並び(x, y, z, w)として見たもの。wは無視する
+inline double triangle_area(const double* points, int a, int b, int c)
+{
+    const double* p = points + static_cast<size_t>(a) * 4;
+    const double* q = points + static_cast<size_t>(b) * 4;
+    const double* r = points + static_cast<size_t>(c) * 4;
+    double ux = q[0] - p[0], uy = q[1] - p[1], uz = q[2] - p[2];
+    double vx = r[0] - p[0], vy = r[1] - p[1], vz = r[2] - p[2];
+    double cx = uy * vz - uz * vy;
+    double cy = uz * vx - ux * vz;
+    double cz = ux * vy - uy * vx;
+    return std::sqrt((cx * cx + cy * cy) + cz * cz) * 0.5;
+}
+
+// AVX2版と同じく、4つの部分和に振り分けてから足す
+inline double area_tail(const double* points, const Triangles& triangles, size_t i, const double lanes[4])
+{
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < triangles.count; ++i) sum += triangle_area(points, triangles.a[i], triangles.b[i], triangles.c[i]);
+    return sum;
+}
+} // namespace
+
+// minとmaxはx, y, z, wの4要素。比較はv < min ? v : minの形で、_mm256_min_pdと同じ結果にする
+void bounds_scalar(const double* points, size_t count, double min[4], double max[4]);
+double area_scalar(const double* points, const Triangles& triangles);
+
+#if FBXAV_HAVE_AVX2
+void bounds_avx2(const double* points, size_t count, double min[4], double max[4]);
+double area_avx2(const double* points, const Triangles& triangles);
+#endif
+} // namespace mesh_kernels
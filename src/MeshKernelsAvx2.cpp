@@ -0,0 +1,58 @@
+﻿#include "MeshKernels.h"
+
+#if FBXAV_HAVE_AVX2
+    #include <immintrin.h>
+
+namespace mesh_kernels
+{
+void bounds_avx2(const double* points, size_t count, double min[4], double max[4])
+{
+    // FbxVector4一つがそのまま1レジスタに載る
+    __m256d lo = _mm256_loadu_pd(min);
+    __m256d hi = _mm256_loadu_pd(max);
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m256d p = _mm256_loadu_pd(points + i * 4);
+        lo = _mm256_min_pd(p, lo);
+        hi = _mm256_max_pd(p, hi);
+    }
+    _mm256_storeu_pd(min, lo);
+    _mm256_storeu_pd(max, hi);
+}
+
+double area_avx2(const double* points, const Triangles& triangles)
+{
+    __m256d sum = _mm256_setzero_pd();
+    const __m256d half = _mm256_set1_pd(0.5);
+
+    size_t i = 0;
+    for (; i + 4 <= triangles.count; i += 4)
+    {
+        // 頂点番号をdouble 4つ分の間隔に直して、x/y/zを別々に集める
+        __m128i a = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(triangles.a + i)), 2);
+        __m128i b = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(triangles.b + i)), 2);
+        __m128i c = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(triangles.c + i)), 2);
+        __m256d px = _mm256_i32gather_pd(points, a, 8);
+        __m256d py = _mm256_i32gather_pd(points + 1, a, 8);
+        __m256d pz = _mm256_i32gather_pd(points + 2, a, 8);
+        __m256d ux = _mm256_sub_pd(_mm256_i32gather_pd(points, b, 8), px);
+        __m256d uy = _mm256_sub_pd(_mm256_i32gather_pd(points + 1, b, 8), py);
+        __m256d uz = _mm256_sub_pd(_mm256_i32gather_pd(points + 2, b, 8), pz);
+        __m256d vx = _mm256_sub_pd(_mm256_i32gather_pd(points, c, 8), px);
+        __m256d vy = _mm256_sub_pd(_mm256_i32gather_pd(points + 1, c, 8), py);
+        __m256d vz = _mm256_sub_pd(_mm256_i32gather_pd(points + 2, c, 8), pz);
+
+        __m256d cx = _mm256_sub_pd(_mm256_mul_pd(uy, vz), _mm256_mul_pd(uz, vy));
+        __m256d cy = _mm256_sub_pd(_mm256_mul_pd(uz, vx), _mm256_mul_pd(ux, vz));
+        __m256d cz = _mm256_sub_pd(_mm256_mul_pd(ux, vy), _mm256_mul_pd(uy, vx));
+        // スカラー版と同じく (cx*cx + cy*cy) + cz*cz の順で足す
+        __m256d len2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(cx, cx), _mm256_mul_pd(cy, cy)), _mm256_mul_pd(cz, cz));
+        sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_sqrt_pd(len2), half));
+    }
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, sum);
+    return area_tail(points, triangles, i, lanes);
+}
+} // namespace mesh_kernels
+#endif
@@ -0,0 +1,175 @@
+﻿#include <algorithm>
+#include <cassert>
+#include <limits>
+#include "LayerElement.h"
+#include "MeshKernels.h"
+#include "MeshStatistics.h"
+#include "NormalValidation.h"
+
+namespace mesh_kernels
+{
+void bounds_scalar(const double* points, size_t count, double min[4], double max[4])
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            double v = points[i * 4 + k];
+            min[k] = v < min[k] ? v : min[k];
+            max[k] = v > max[k] ? v : max[k];
+        }
+    }
+}
+
+double area_scalar(const double* points, const Triangles& triangles)
+{
+    double lanes[4] = {};
+    size_t i = 0;
+    for (; i + 4 <= triangles.count; i += 4)
+    {
+        for (int k = 0; k < 4; ++k) lanes[k] += triangle_area(points, triangles.a[i + k], triangles.b[i + k], triangles.c[i + k]);
+    }
+    return area_tail(points, triangles, i, lanes);
+}
+} // namespace mesh_kernels
+
+// AVX2版はgatherの添字をint32で持つので、それに収まる制御点の数のときだけ使う
+static bool use_avx2(size_t point_count)
+{
+#if FBXAV_HAVE_AVX2
+    return get_simd_level() == SimdLevel::Avx2 && point_count < (size_t(1) << 29);
+#else
+    (void)point_count;
+    return false;
+#endif
+}
+
+static void bounds(const double* points, size_t count, double min[4], double max[4])
+{
+#if FBXAV_HAVE_AVX2
+    if (use_avx2(count))
+    {
+    #ifndef NDEBUG
+        double expected_min[4] = {min[0], min[1], min[2], min[3]};
+        double expected_max[4] = {max[0], max[1], max[2], max[3]};
+        mesh_kernels::bounds_scalar(points, count, expected_min, expected_max);
+    #endif
+        mesh_kernels::bounds_avx2(points, count, min, max);
+    #ifndef NDEBUG
+        assert(std::equal(min, min + 3, expected_min) && std::equal(max, max + 3, expected_max));
+    #endif
+        return;
+    }
+#endif
+    mesh_kernels::bounds_scalar(points, count, min, max);
+}
+
+static double area(const double* points, size_t point_count, const mesh_kernels::Triangles& triangles)
+{
+#if FBXAV_HAVE_AVX2
+    if (use_avx2(point_count))
+    {
+        double sum = mesh_kernels::area_avx2(points, triangles);
+        assert(sum == mesh_kernels::area_scalar(points, triangles) || sum != sum);
+        return sum;
+    }
+#endif
+    (void)point_count;
+    return mesh_kernels::area_scalar(points, triangles);
+}
+
+void MeshStatistics::add(const MeshStatistics& other)
+{
+    meshes += other.meshes;
+    control_points += other.control_points;
+    polygons += other.polygons;
+    polygon_vertices += other.polygon_vertices;
+    triangles += other.triangles;
+    for (int i = 0; i <= polygon_size_limit; ++i) polygon_sizes[i] += other.polygon_sizes[i];
+    if (other.has_bounds)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            min[k] = has_bounds ? std::min(min[k], other.min[k]) : other.min[k];
+            max[k] = has_bounds ? std::max(max[k], other.max[k]) : other.max[k];
+        }
+        has_bounds = true;
+    }
+    area += other.area;
+    if (material_faces.size() < other.material_faces.size()) material_faces.resize(other.material_faces.size());
+    for (size_t i = 0; i < other.material_faces.size(); ++i) material_faces[i] += other.material_faces[i];
+    unassigned_faces += other.unassigned_faces;
+}
+
+void compute_mesh_statistics(FbxMesh* mesh, MeshStatistics& statistics)
+{
+    statistics = MeshStatistics();
+    statistics.meshes = 1;
+    int point_count = mesh->GetControlPointsCount();
+    statistics.control_points = point_count;
+    statistics.polygons = mesh->GetPolygonCount();
+    statistics.polygon_vertices = mesh->GetPolygonVertexCount();
+
+    const FbxVector4* control_points = mesh->GetControlPoints();
+    const double* points = control_points ? &control_points[0][0] : nullptr;
+    if (points && point_count > 0)
+    {
+        constexpr double inf = std::numeric_limits<double>::infinity();
+        double min[4] = {inf, inf, inf, inf};
+        double max[4] = {-inf, -inf, -inf, -inf};
+        bounds(points, point_count, min, max);
+        std::copy_n(min, 3, statistics.min);
+        std::copy_n(max, 3, statistics.max);
+        statistics.has_bounds = true;
+    }
+
+    // マテリアル番号はポリゴン単位か全体で一つのどちらか
+    auto node = mesh->GetNode();
+    int material_count = node ? node->GetMaterialCount() : 0;
+    statistics.material_faces.assign(material_count, 0);
+    ResolvedElement<int> materials;
+    if (auto element = mesh->GetElementMaterial()) resolve_material_indices(mesh, element, materials);
+    auto material_of = [&](size_t pi) {
+        if (materials.mapping == FbxGeometryElement::eByPolygon) return pi < materials.values.size() ? materials.values[pi] : -1;
+        if (materials.mapping == FbxGeometryElement::eAllSame) return materials.values.empty() ? -1 : materials.values[0];
+        return -1;
+    };
+
+    std::pmr::vector<int> starts(analysis_memory());
+    polygon_starts(mesh, starts);
+    const int* vertices = mesh->GetPolygonVertices();
+
+    // ポリゴンを順に一度だけ見て、頂点数とマテリアルを数えながら三角形を溜める
+    mesh_kernels::Triangles triangles;
+    for (size_t pi = 0; pi + 1 < starts.size(); ++pi)
+    {
+        int begin = starts[pi];
+        int end = starts[pi + 1];
+        int size = end - begin;
+        ++statistics.polygon_sizes[std::min(size, polygon_size_limit)];
+        if (size >= 3) statistics.triangles += size - 2;
+
+        int material = material_of(pi);
+        if (material >= 0 && material < material_count) ++statistics.material_faces[material];
+        else ++statistics.unassigned_faces;
+
+        if (points == nullptr || vertices == nullptr) continue;
+        int a = vertices[begin];
+        if (a < 0 || a >= point_count) continue;
+        for (int k = begin + 1; k + 1 < end; ++k)
+        {
+            int b = vertices[k];
+            int c = vertices[k + 1];
+            if (b < 0 || b >= point_count || c < 0 || c >= point_count) continue;
+            triangles.a[triangles.count] = a;
+            triangles.b[triangles.count] = b;
+            triangles.c[triangles.count] = c;
+            if (++triangles.count == mesh_kernels::triangle_batch)
+            {
+                statistics.area += area(points, point_count, triangles);
+                triangles.count = 0;
+            }
+        }
+    }
+    if (triangles.count > 0) statistics.area += area(points, point_count, triangles);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <cstdint>
+#include <vector>
+
+// 頂点数がこれ以上のポリゴンはヒストグラムの最後の区間にまとめる
+constexpr int polygon_size_limit = 16;
+
+// --stats-meshの集計。メッシュ一つ分、またはシーン全体の合計
+struct MeshStatistics
+{
+    int64_t meshes = 0;
+    int64_t control_points = 0;
+    int64_t polygons = 0;
+    int64_t polygon_vertices = 0;
+    // 扇形に三角形分割したときの三角形の数
+    int64_t triangles = 0;
+    // 頂点数ごとのポリゴンの数。[polygon_size_limit]はそれ以上をまとめたもの
+    int64_t polygon_sizes[polygon_size_limit + 1] = {};
+    // 制御点の軸平行な範囲。制御点が無ければhas_boundsがfalse
+    bool has_bounds = false;
+    double min[3] = {};
+    double max[3] = {};
+    // 扇形に分割した三角形の面積の合計
+    double area = 0;
+    // マテリアルスロットごとの面の数。マテリアル要素が無いか範囲外の面はunassigned_faces
+    std::vector<int64_t> material_faces;
+    int64_t unassigned_faces = 0;
+
+    // シーン全体の合計に足す。マテリアルはスロット番号ごとに足す
+    void add(const MeshStatistics& other);
+};
+
+// 制御点とポリゴン頂点の配列を一度ずつ読んで集計する
+void compute_mesh_statistics(FbxMesh* mesh, MeshStatistics& statistics);
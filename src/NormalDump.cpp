@@ -0,0 +1,172 @@
+﻿#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "LayerElement.h"
+#include "NormalDump.h"
+
+namespace
+{
+// 書き込んだバイト数を数えながら、配列をアラインして書き出すファイル
+class DumpFile
+{
+public:
+    ~DumpFile()
+    {
+        if (file) std::fclose(file);
+    }
+
+    bool open(const char* path)
+    {
+        file = std::fopen(path, "wb");
+        return file != nullptr;
+    }
+
+    bool close()
+    {
+        bool ok = file && std::fclose(file) == 0 && !failed;
+        file = nullptr;
+        return ok;
+    }
+
+    void write(const void* data, size_t bytes)
+    {
+        if (bytes == 0) return;
+        if (std::fwrite(data, 1, bytes, file) != bytes) failed = true;
+        offset += bytes;
+    }
+
+    void align()
+    {
+        static const char zeros[normal_dump_alignment] = {};
+        size_t pad = (normal_dump_alignment - offset % normal_dump_alignment) % normal_dump_alignment;
+        write(zeros, pad);
+    }
+
+    // 配列をアラインした位置に書き、そのオフセットを返す
+    template <typename T, typename Allocator> uint64_t write_array(const std::vector<T, Allocator>& values)
+    {
+        if (values.empty()) return 0;
+        align();
+        uint64_t start = offset;
+        write(values.data(), values.size() * sizeof(T));
+        return start;
+    }
+
+    // ヘッダを書き戻す
+    void patch(const NormalDumpHeader& header)
+    {
+        if (std::fseek(file, 0, SEEK_SET) != 0) failed = true;
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) failed = true;
+    }
+
+    uint64_t get_offset() const { return offset; }
+    bool good() const { return !failed; }
+
+private:
+    std::FILE* file = nullptr;
+    uint64_t offset = 0;
+    bool failed = false;
+};
+} // namespace
+
+static void collect_meshes(FbxNode* node, std::vector<FbxMesh*>& meshes)
+{
+    for (int i = 0; i < node->GetNodeAttributeCount(); ++i)
+    {
+        auto attr = node->GetNodeAttributeByIndex(i);
+        if (attr && attr->GetAttributeType() == FbxNodeAttribute::eMesh) meshes.push_back(static_cast<FbxMesh*>(attr));
+    }
+    for (int i = 0; i < node->GetChildCount(); ++i) collect_meshes(node->GetChild(i), meshes);
+}
+
+bool dump_normals(FbxScene* scene, const char* path, const NormalDumpOptions& options, std::ostream& err)
+{
+    std::vector<FbxMesh*> meshes;
+    if (scene->GetRootNode()) collect_meshes(scene->GetRootNode(), meshes);
+
+    DumpFile file;
+    if (!file.open(path))
+    {
+        err << "Error: Unable to open normal dump file " << path << std::endl;
+        return false;
+    }
+
+    NormalDumpHeader header = {};
+    std::memcpy(header.magic, normal_dump_magic, sizeof(header.magic));
+    header.version = normal_dump_version;
+    header.header_size = sizeof(NormalDumpHeader);
+    header.flags = (options.points ? normal_dump_points : 0) | (options.indices ? normal_dump_indices : 0);
+    header.mesh_count = static_cast<uint32_t>(meshes.size());
+    file.write(&header, sizeof(header));
+
+    std::vector<NormalDumpMesh> directory(meshes.size());
+    ResolvedElement<FbxVector4> normals;
+    SoaVectors soa;
+    std::pmr::vector<float> x(analysis_memory());
+    std::pmr::vector<int32_t> indices(analysis_memory());
+    for (size_t m = 0; m < meshes.size(); ++m)
+    {
+        FbxMesh* mesh = meshes[m];
+        NormalDumpMesh& entry = directory[m];
+        entry.mapping = FbxGeometryElement::eNone;
+        entry.control_point_count = mesh->GetControlPointsCount();
+        entry.polygon_count = mesh->GetPolygonCount();
+        entry.polygon_vertex_count = mesh->GetPolygonVertexCount();
+
+        if (auto elnrm = mesh->GetElementNormal())
+        {
+            resolve_element(mesh, elnrm, normals);
+            split_vectors(normals.values, soa);
+            entry.mapping = normals.mapping;
+            entry.reference = normals.reference;
+            entry.normal_count = static_cast<uint32_t>(soa.size());
+            entry.normal_x = file.write_array(soa.x);
+            entry.normal_y = file.write_array(soa.y);
+            entry.normal_z = file.write_array(soa.z);
+        }
+
+        if (options.points)
+        {
+            const FbxVector4* points = mesh->GetControlPoints();
+            int count = mesh->GetControlPointsCount();
+            for (int c = 0; c < 3; ++c)
+            {
+                x.resize(count);
+                for (int i = 0; i < count; ++i) x[i] = static_cast<float>(points[i][c]);
+                (c == 0 ? entry.point_x : c == 1 ? entry.point_y : entry.point_z) = file.write_array(x);
+            }
+        }
+
+        if (options.indices)
+        {
+            const int* vertices = mesh->GetPolygonVertices();
+            indices.assign(vertices, vertices + mesh->GetPolygonVertexCount());
+            entry.polygon_vertices = file.write_array(indices);
+
+            polygon_starts(mesh, indices);
+            entry.polygon_starts = file.write_array(indices);
+        }
+    }
+
+    // 名前はまとめて文字列テーブルに置く
+    for (size_t m = 0; m < meshes.size(); ++m)
+    {
+        FbxNode* node = meshes[m]->GetNode();
+        const char* name = node ? node->GetName() : meshes[m]->GetName();
+        directory[m].name_offset = file.get_offset();
+        directory[m].name_length = static_cast<uint32_t>(std::strlen(name));
+        file.write(name, directory[m].name_length);
+    }
+
+    header.directory_offset = file.write_array(directory);
+    file.patch(header);
+
+    if (!file.close())
+    {
+        err << "Error: Unable to write normal dump file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <cstdint>
+#include <iosfwd>
+
+// 法線のバイナリダンプ形式（リトルエンディアン）。
+//
+//   NormalDumpHeader
+//   各メッシュの配列データ（すべてnormal_dump_alignmentバイト境界に揃える）
+//   メッシュ名の文字列テーブル
+//   NormalDumpMesh[mesh_count]（directory_offsetから）
+//
+// 法線と制御点はx/y/zを別々のfloat配列（SoA）で持つので、
+// mmapしたままベクトル化したチェックをかけられる。
+// オフセットはすべてファイル先頭からのバイト数で、0は「その配列は無い」を表す。
+
+constexpr char normal_dump_magic[8] = {'F', 'B', 'X', 'N', 'R', 'M', 'L', 'S'};
+constexpr uint32_t normal_dump_version = 1;
+constexpr uint32_t normal_dump_alignment = 64;
+
+enum NormalDumpFlags : uint32_t
+{
+    normal_dump_points = 1 << 0,  // 制御点の座標を含む
+    normal_dump_indices = 1 << 1, // ポリゴン頂点のインデックスを含む
+};
+
+struct NormalDumpHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t flags;
+    uint32_t mesh_count;
+    uint64_t directory_offset;
+    uint8_t reserved[32];
+};
+static_assert(sizeof(NormalDumpHeader) == 64);
+
+struct NormalDumpMesh
+{
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t mapping;   // FbxGeometryElement::EMappingMode。法線が無ければeNone
+    uint32_t reference; // 元データのFbxGeometryElement::EReferenceMode（ダンプ時に展開済み）
+    uint32_t normal_count;
+    uint32_t control_point_count;
+    uint32_t polygon_count;
+    uint32_t polygon_vertex_count;
+    uint32_t reserved0;
+    uint64_t normal_x;
+    uint64_t normal_y;
+    uint64_t normal_z;
+    uint64_t point_x;
+    uint64_t point_y;
+    uint64_t point_z;
+    uint64_t polygon_vertices; // int32[polygon_vertex_count] 制御点インデックス
+    uint64_t polygon_starts;   // int32[polygon_count + 1] 各ポリゴンの先頭位置
+    uint8_t reserved[24];
+};
+static_assert(sizeof(NormalDumpMesh) == 128);
+
+struct NormalDumpOptions
+{
+    bool points = false;
+    bool indices = false;
+};
+
+// シーン内の全メッシュの法線をpathに書き出す
+bool dump_normals(FbxScene* scene, const char* path, const NormalDumpOptions& options, std::ostream& err);
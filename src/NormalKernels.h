@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <bit>
+#include "NormalValidation.h"
+
+// 法線検査カーネルの実装間で共有する定義。
+// スカラー版とAVX2版は同じ演算順序で計算し、結果が一致するようにする
+namespace normal_kernels
+{
+struct Thresholds
+{
+    float zero2; // 長さの2乗がこれ以下なら0とみなす
+    float lo2;   // 長さの2乗の許容範囲
+    float hi2;
+    int max_offenders;
+};
+
+// 違反のインデックスを追加する。std::vectorの確保処理が-mavx2付きの翻訳単位で
+// 実体化されないよう、スカラー版の翻訳単位に置く
+void add_offender(NormalCheckResult& result, int issue, size_t index);
+
+// 以下の補助関数はAVX2版では-mavx2付きでコンパイルされる。
+// 翻訳単位をまたいで同じ定義が共有されないよう、内部リンケージにしておく
+namespace
+{
+inline Thresholds make_thresholds(const NormalCheckOptions& options)
+{
+    float lo = 1.0f - options.tolerance;
+    float hi = 1.0f + options.tolerance;
+    return {options.zero_length * options.zero_length, lo > 0 ? lo * lo : 0.0f, hi * hi, options.max_offenders};
+}
+
+inline void record(NormalCheckResult& result, NormalIssue issue, size_t index, int max_offenders)
+{
+    auto i = static_cast<int>(issue);
+    ++result.counts[i];
+    if (static_cast<int>(result.offenders[i].size()) < max_offenders) add_offender(result, i, index);
+}
+
+// 8レーン分のビットマスクを記録する
+inline void record_mask(NormalCheckResult& result, NormalIssue issue, unsigned mask, size_t base, int max_offenders)
+{
+    for (; mask != 0; mask &= mask - 1) record(result, issue, base + std::countr_zero(mask), max_offenders);
+}
+
+// 1要素分のスカラー検査。ベクトル版の端数処理にも使う
+inline void check_one(float x, float y, float z, size_t index, const Thresholds& t, NormalCheckResult& result)
+{
+    float len2 = x * x + y * y + z * z;
+    float inf_or_nan = x * 0.0f + y * 0.0f + z * 0.0f;
+    if (inf_or_nan != inf_or_nan) record(result, NormalIssue::NonFinite, index, t.max_offenders);
+    else if (len2 <= t.zero2) record(result, NormalIssue::ZeroLength, index, t.max_offenders);
+    else if (len2 < t.lo2 || len2 > t.hi2) record(result, NormalIssue::NonUnit, index, t.max_offenders);
+}
+
+inline void facing_one(float x, float y, float z, float fx, float fy, float fz, size_t index, const Thresholds& t, NormalCheckResult& result)
+{
+    float dot = x * fx + y * fy + z * fz;
+    if (dot < 0.0f) record(result, NormalIssue::FacingAway, index, t.max_offenders);
+}
+} // namespace
+
+void check_scalar(const NormalArrays& normals, const Thresholds& t, NormalCheckResult& result);
+void facing_scalar(const NormalArrays& normals, const NormalArrays& faces, const Thresholds& t, NormalCheckResult& result);
+
+#if FBXAV_HAVE_AVX2
+void check_avx2(const NormalArrays& normals, const Thresholds& t, NormalCheckResult& result);
+void facing_avx2(const NormalArrays& normals, const NormalArrays& faces, const Thresholds& t, NormalCheckResult& result);
+#endif
+} // namespace normal_kernels
@@ -0,0 +1,59 @@
+﻿#include "NormalKernels.h"
+
+#if FBXAV_HAVE_AVX2
+    #include <immintrin.h>
+
+namespace normal_kernels
+{
+void check_avx2(const NormalArrays& normals, const Thresholds& t, NormalCheckResult& result)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 zero2 = _mm256_set1_ps(t.zero2);
+    const __m256 lo2 = _mm256_set1_ps(t.lo2);
+    const __m256 hi2 = _mm256_set1_ps(t.hi2);
+
+    size_t i = 0;
+    for (; i + 8 <= normals.count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(normals.x + i);
+        __m256 y = _mm256_loadu_ps(normals.y + i);
+        __m256 z = _mm256_loadu_ps(normals.z + i);
+
+        // スカラー版と同じく (x*x + y*y) + z*z の順で足す
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        // 有限値に0を掛けると0、InfやNaNならNaNになる
+        __m256 inf_or_nan = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, zero), _mm256_mul_ps(y, zero)), _mm256_mul_ps(z, zero));
+
+        unsigned non_finite = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(inf_or_nan, inf_or_nan, _CMP_UNORD_Q)));
+        unsigned zero_length = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(len2, zero2, _CMP_LE_OQ))) & ~non_finite;
+        __m256 outside = _mm256_or_ps(_mm256_cmp_ps(len2, lo2, _CMP_LT_OQ), _mm256_cmp_ps(len2, hi2, _CMP_GT_OQ));
+        unsigned non_unit = static_cast<unsigned>(_mm256_movemask_ps(outside)) & ~non_finite & ~zero_length;
+
+        // 大半のブロックは異常なしなので、ここで抜ける
+        if ((non_finite | zero_length | non_unit) == 0) continue;
+        record_mask(result, NormalIssue::NonFinite, non_finite, i, t.max_offenders);
+        record_mask(result, NormalIssue::ZeroLength, zero_length, i, t.max_offenders);
+        record_mask(result, NormalIssue::NonUnit, non_unit, i, t.max_offenders);
+    }
+    for (; i < normals.count; ++i) check_one(normals.x[i], normals.y[i], normals.z[i], i, t, result);
+}
+
+void facing_avx2(const NormalArrays& normals, const NormalArrays& faces, const Thresholds& t, NormalCheckResult& result)
+{
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= normals.count; i += 8)
+    {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(normals.x + i), _mm256_loadu_ps(faces.x + i));
+        __m256 y = _mm256_mul_ps(_mm256_loadu_ps(normals.y + i), _mm256_loadu_ps(faces.y + i));
+        __m256 z = _mm256_mul_ps(_mm256_loadu_ps(normals.z + i), _mm256_loadu_ps(faces.z + i));
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(x, y), z);
+
+        unsigned away = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(dot, zero, _CMP_LT_OQ)));
+        if (away != 0) record_mask(result, NormalIssue::FacingAway, away, i, t.max_offenders);
+    }
+    for (; i < normals.count; ++i) facing_one(normals.x[i], normals.y[i], normals.z[i], faces.x[i], faces.y[i], faces.z[i], i, t, result);
+}
+} // namespace normal_kernels
+#endif
@@ -0,0 +1,289 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include "LayerElement.h"
+#include "NormalRecompute.h"
+#include "TaskPool.h"
+
+bool parse_normal_weighting(std::string_view text, NormalWeighting& weighting)
+{
+    if (text == "area") weighting = NormalWeighting::Area;
+    else if (text == "angle") weighting = NormalWeighting::Angle;
+    else return false;
+    return true;
+}
+
+const char* normal_weighting_name(NormalWeighting weighting)
+{
+    return weighting == NormalWeighting::Angle ? "angle" : "area";
+}
+
+namespace
+{
+// 並列に処理する一かたまりのポリゴン数と、比べる単位の数
+constexpr size_t polygon_chunk = 1 << 14;
+constexpr size_t compare_chunk = 1 << 16;
+
+// かたまり一つ分の、ポリゴン頂点ごとの重み付き面法線
+struct CornerWeights
+{
+    std::pmr::vector<float> x = std::pmr::vector<float>(analysis_memory());
+    std::pmr::vector<float> y = std::pmr::vector<float>(analysis_memory());
+    std::pmr::vector<float> z = std::pmr::vector<float>(analysis_memory());
+};
+
+// かたまり一つ分の比較結果。かたまりの順に合わせる
+struct ChunkResult
+{
+    size_t compared = 0;
+    size_t skipped = 0;
+    double sum = 0;
+    double max = 0;
+    size_t histogram[normal_deviation_buckets] = {};
+    std::vector<NormalDeviation> worst;
+};
+
+bool worse(const NormalDeviation& a, const NormalDeviation& b)
+{
+    return a.degrees != b.degrees ? a.degrees > b.degrees : a.index < b.index;
+}
+} // namespace
+
+// [0, count)の各かたまりをプールで並列に処理する。確保は呼び出し側で済ませておくこと。
+// かたまりが例外を投げたら、全部終わるのを待ってから最初の例外を投げ直す
+template <typename F> static void parallel_chunks(TaskPool* pool, size_t count, F&& f)
+{
+    if (pool == nullptr || count <= 1)
+    {
+        for (size_t c = 0; c < count; ++c) f(c);
+        return;
+    }
+    auto slots = std::make_unique<TaskSlot[]>(count);
+    size_t submitted = 0;
+    try
+    {
+        for (; submitted < count; ++submitted)
+        {
+            pool->submit([&f, &slots, c = submitted] { slots[c].run([&] { f(c); }); });
+        }
+    } catch (...)
+    {
+        for (size_t c = 0; c < submitted; ++c) slots[c].wait(*pool);
+        throw;
+    }
+    for (size_t c = 0; c < count; ++c) slots[c].wait(*pool);
+    for (size_t c = 0; c < count; ++c) slots[c].rethrow();
+}
+
+// ポリゴン[first, last)の頂点ごとに、その制御点へ足す重み付きの面法線を求める。
+// 面積の重みはNewellベクトルそのもの（長さが面積の2倍）、角度の重みは単位面法線に内角を掛けたもの
+static void corner_weights(const FbxVector4* points, int point_count, const int* vertices, const int* starts, size_t first, size_t last, NormalWeighting weighting,
+                           CornerWeights& weights)
+{
+    int base = starts[first];
+    for (size_t pi = first; pi < last; ++pi)
+    {
+        int begin = starts[pi];
+        int end = starts[pi + 1];
+        double nx = 0, ny = 0, nz = 0;
+        bool valid = end - begin >= 3;
+        for (int k = begin; k < end && valid; ++k)
+        {
+            int a = vertices[k];
+            int b = vertices[k + 1 < end ? k + 1 : begin];
+            if (a < 0 || a >= point_count || b < 0 || b >= point_count)
+            {
+                valid = false;
+                break;
+            }
+            const FbxVector4& p = points[a];
+            const FbxVector4& q = points[b];
+            nx += (p[1] - q[1]) * (p[2] + q[2]);
+            ny += (p[2] - q[2]) * (p[0] + q[0]);
+            nz += (p[0] - q[0]) * (p[1] + q[1]);
+        }
+        double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        // 壊れたポリゴンと面積0のポリゴンは何も足さない
+        if (!valid || !(length > 0))
+        {
+            std::fill(weights.x.begin() + (begin - base), weights.x.begin() + (end - base), 0.0f);
+            std::fill(weights.y.begin() + (begin - base), weights.y.begin() + (end - base), 0.0f);
+            std::fill(weights.z.begin() + (begin - base), weights.z.begin() + (end - base), 0.0f);
+            continue;
+        }
+
+        if (weighting == NormalWeighting::Area)
+        {
+            std::fill(weights.x.begin() + (begin - base), weights.x.begin() + (end - base), static_cast<float>(nx));
+            std::fill(weights.y.begin() + (begin - base), weights.y.begin() + (end - base), static_cast<float>(ny));
+            std::fill(weights.z.begin() + (begin - base), weights.z.begin() + (end - base), static_cast<float>(nz));
+            continue;
+        }
+
+        nx /= length;
+        ny /= length;
+        nz /= length;
+        for (int k = begin; k < end; ++k)
+        {
+            const FbxVector4& p = points[vertices[k]];
+            const FbxVector4& next = points[vertices[k + 1 < end ? k + 1 : begin]];
+            const FbxVector4& prev = points[vertices[k > begin ? k - 1 : end - 1]];
+            double ax = next[0] - p[0], ay = next[1] - p[1], az = next[2] - p[2];
+            double bx = prev[0] - p[0], by = prev[1] - p[1], bz = prev[2] - p[2];
+            // 面法線の向きで符号を付け、凹んだ頂点では180度を超える内角にする
+            double sine = (ay * bz - az * by) * nx + (az * bx - ax * bz) * ny + (ax * by - ay * bx) * nz;
+            double angle = std::atan2(sine, ax * bx + ay * by + az * bz);
+            if (angle < 0) angle += 2 * std::numbers::pi;
+            weights.x[k - base] = static_cast<float>(nx * angle);
+            weights.y[k - base] = static_cast<float>(ny * angle);
+            weights.z[k - base] = static_cast<float>(nz * angle);
+        }
+    }
+}
+
+// 保存された法線sと再計算した単位法線rのなす角（度）。測れなければ負を返す
+static double deviation(const FbxVector4& s, double rx, double ry, double rz)
+{
+    double length = std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    if (!(length > 0) || !std::isfinite(length) || (rx == 0 && ry == 0 && rz == 0)) return -1;
+    // 小さな角度でも精度が落ちないよう、acosではなくatan2で測る
+    double cx = s[1] * rz - s[2] * ry;
+    double cy = s[2] * rx - s[0] * rz;
+    double cz = s[0] * ry - s[1] * rx;
+    double sine = std::sqrt(cx * cx + cy * cy + cz * cz);
+    double cosine = s[0] * rx + s[1] * ry + s[2] * rz;
+    return std::atan2(sine, cosine) * (180 / std::numbers::pi);
+}
+
+bool compare_mesh_normals(FbxMesh* mesh, NormalWeighting weighting, int max_offenders, TaskPool* pool, NormalComparison& result)
+{
+    result = NormalComparison();
+    result.weighting = weighting;
+
+    auto element = mesh->GetElementNormal();
+    if (element == nullptr) return false;
+    ResolvedElement<FbxVector4> stored;
+    resolve_element(mesh, element, stored);
+
+    std::pmr::vector<FbxVector4> expanded(analysis_memory());
+    bool per_point = stored.mapping == FbxGeometryElement::eByControlPoint;
+    if (!per_point && !expand_to_polygon_vertex(mesh, stored, expanded)) return false;
+    const auto& values = per_point ? stored.values : expanded;
+    result.domain = per_point ? FbxGeometryElement::eByControlPoint : FbxGeometryElement::eByPolygonVertex;
+
+    const FbxVector4* points = mesh->GetControlPoints();
+    const int* vertices = mesh->GetPolygonVertices();
+    int point_count = mesh->GetControlPointsCount();
+    std::pmr::vector<int> starts(analysis_memory());
+    polygon_starts(mesh, starts);
+    size_t polygon_count = starts.size() - 1;
+
+    // 制御点ごとの和。重みはかたまりごとに並列に求め、足し込みだけを決まった順で行う
+    std::pmr::vector<double> sx(point_count, 0.0, analysis_memory());
+    std::pmr::vector<double> sy(point_count, 0.0, analysis_memory());
+    std::pmr::vector<double> sz(point_count, 0.0, analysis_memory());
+    if (points && vertices)
+    {
+        // 一度に抱える重みをスレッド数に比例する分だけにして、メモリがメッシュの大きさで増えないようにする
+        size_t chunks = (polygon_count + polygon_chunk - 1) / polygon_chunk;
+        size_t wave = pool ? 2 * (pool->thread_count() + 1) : 1;
+        std::vector<CornerWeights> weights(std::min(wave, chunks));
+        for (size_t first = 0; first < chunks; first += wave)
+        {
+            size_t count = std::min(wave, chunks - first);
+            for (size_t c = 0; c < count; ++c)
+            {
+                size_t begin = (first + c) * polygon_chunk;
+                size_t end = std::min(begin + polygon_chunk, polygon_count);
+                size_t corners = starts[end] - starts[begin];
+                weights[c].x.resize(corners);
+                weights[c].y.resize(corners);
+                weights[c].z.resize(corners);
+            }
+            parallel_chunks(pool, count, [&](size_t c) {
+                size_t begin = (first + c) * polygon_chunk;
+                corner_weights(points, point_count, vertices, starts.data(), begin, std::min(begin + polygon_chunk, polygon_count), weighting, weights[c]);
+            });
+            for (size_t c = 0; c < count; ++c)
+            {
+                int base = starts[(first + c) * polygon_chunk];
+                for (size_t i = 0; i < weights[c].x.size(); ++i)
+                {
+                    int v = vertices[base + i];
+                    if (v < 0 || v >= point_count) continue;
+                    sx[v] += weights[c].x[i];
+                    sy[v] += weights[c].y[i];
+                    sz[v] += weights[c].z[i];
+                }
+            }
+        }
+    }
+
+    size_t point_chunks = (static_cast<size_t>(point_count) + compare_chunk - 1) / compare_chunk;
+    parallel_chunks(pool, point_chunks, [&](size_t c) {
+        size_t end = std::min((c + 1) * compare_chunk, static_cast<size_t>(point_count));
+        for (size_t v = c * compare_chunk; v < end; ++v)
+        {
+            double length = std::sqrt(sx[v] * sx[v] + sy[v] * sy[v] + sz[v] * sz[v]);
+            double scale = length > 0 ? 1 / length : 0;
+            sx[v] *= scale;
+            sy[v] *= scale;
+            sz[v] *= scale;
+        }
+    });
+
+    // 使われていない制御点やポリゴン頂点の番号が壊れたものは、再計算した法線が0なので測れない側に数える
+    size_t compare_count = per_point ? std::min(values.size(), static_cast<size_t>(point_count)) : values.size();
+    std::vector<ChunkResult> chunks((compare_count + compare_chunk - 1) / compare_chunk);
+    parallel_chunks(pool, chunks.size(), [&](size_t c) {
+        auto& chunk = chunks[c];
+        size_t end = std::min((c + 1) * compare_chunk, compare_count);
+        for (size_t i = c * compare_chunk; i < end; ++i)
+        {
+            int v = per_point ? static_cast<int>(i) : (vertices ? vertices[i] : -1);
+            double degrees = v >= 0 && v < point_count ? deviation(values[i], sx[v], sy[v], sz[v]) : -1;
+            if (degrees < 0)
+            {
+                ++chunk.skipped;
+                continue;
+            }
+            ++chunk.compared;
+            chunk.sum += degrees;
+            chunk.max = std::max(chunk.max, degrees);
+            int bucket = 0;
+            while (bucket + 1 < normal_deviation_buckets && !(degrees < normal_deviation_limits[bucket])) ++bucket;
+            ++chunk.histogram[bucket];
+
+            // かたまりごとに上位max_offenders個だけを最小ヒープで持つ
+            if (max_offenders <= 0) continue;
+            NormalDeviation entry{static_cast<int>(i), v, degrees};
+            if (static_cast<int>(chunk.worst.size()) < max_offenders)
+            {
+                chunk.worst.push_back(entry);
+                std::push_heap(chunk.worst.begin(), chunk.worst.end(), worse);
+            } else if (worse(entry, chunk.worst.front()))
+            {
+                std::pop_heap(chunk.worst.begin(), chunk.worst.end(), worse);
+                chunk.worst.back() = entry;
+                std::push_heap(chunk.worst.begin(), chunk.worst.end(), worse);
+            }
+        }
+    });
+
+    double sum = 0;
+    for (const auto& chunk : chunks)
+    {
+        result.compared += chunk.compared;
+        result.skipped += chunk.skipped;
+        sum += chunk.sum;
+        result.max_degrees = std::max(result.max_degrees, chunk.max);
+        for (int b = 0; b < normal_deviation_buckets; ++b) result.histogram[b] += chunk.histogram[b];
+        result.worst.insert(result.worst.end(), chunk.worst.begin(), chunk.worst.end());
+    }
+    result.skipped += values.size() - compare_count;
+    if (result.compared > 0) result.mean_degrees = sum / result.compared;
+    std::sort(result.worst.begin(), result.worst.end(), worse);
+    if (static_cast<int>(result.worst.size()) > max_offenders) result.worst.resize(std::max(max_offenders, 0));
+    return true;
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+class TaskPool;
+
+// 再計算するスムーズ法線で、制御点に集まるポリゴンの面法線をどう重み付けするか
+enum class NormalWeighting
+{
+    Area,  // ポリゴンの面積
+    Angle, // 制御点でのポリゴンの内角
+};
+
+bool parse_normal_weighting(std::string_view text, NormalWeighting& weighting);
+const char* normal_weighting_name(NormalWeighting weighting);
+
+// ずれの角度のヒストグラムの各区間の上限（度）
+constexpr int normal_deviation_buckets = 6;
+constexpr double normal_deviation_limits[normal_deviation_buckets] = {1, 5, 15, 45, 90, 180};
+
+struct NormalDeviation
+{
+    // 比べた単位（制御点かポリゴン頂点）の番号
+    int index;
+    int control_point;
+    double degrees;
+};
+
+struct NormalComparison
+{
+    NormalWeighting weighting = NormalWeighting::Area;
+    // 制御点単位の要素は制御点ごと、それ以外はポリゴン頂点ごとに比べる
+    FbxGeometryElement::EMappingMode domain = FbxGeometryElement::eByPolygonVertex;
+    size_t compared = 0;
+    // 保存された法線か再計算した法線が0ベクトルやNaNで、角度を測れなかった数
+    size_t skipped = 0;
+    double mean_degrees = 0;
+    double max_degrees = 0;
+    size_t histogram[normal_deviation_buckets] = {};
+    // ずれの大きい順に最大max_offenders個
+    std::vector<NormalDeviation> worst;
+};
+
+// 制御点とポリゴンからスムーズ法線を計算し直し、メッシュの最初の法線要素と角度で比べる。
+// poolがあればポリゴンと比べる単位を一定の大きさに分けて並列に計算する。
+// 分け方はスレッド数によらないので、結果は常に同じになる。法線が無いか、エッジ単位ならfalse
+bool compare_mesh_normals(FbxMesh* mesh, NormalWeighting weighting, int max_offenders, TaskPool* pool, NormalComparison& result);
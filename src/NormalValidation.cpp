@@ -0,0 +1,221 @@
+﻿#include <atomic>
+#include <cassert>
+#include "LayerElement.h"
+#include "NormalKernels.h"
+#include "NormalValidation.h"
+
+#if FBXAV_HAVE_AVX2 && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace normal_kernels
+{
+void add_offender(NormalCheckResult& result, int issue, size_t index)
+{
+    result.offenders[issue].push_back(static_cast<int>(index));
+}
+
+void check_scalar(const NormalArrays& normals, const Thresholds& t, NormalCheckResult& result)
+{
+    for (size_t i = 0; i < normals.count; ++i) check_one(normals.x[i], normals.y[i], normals.z[i], i, t, result);
+}
+
+void facing_scalar(const NormalArrays& normals, const NormalArrays& faces, const Thresholds& t, NormalCheckResult& result)
+{
+    for (size_t i = 0; i < normals.count; ++i) facing_one(normals.x[i], normals.y[i], normals.z[i], faces.x[i], faces.y[i], faces.z[i], i, t, result);
+}
+} // namespace normal_kernels
+
+const char* normal_issue_name(NormalIssue issue)
+{
+    switch (issue)
+    {
+    case NormalIssue::NonFinite: return "non-finite";
+    case NormalIssue::ZeroLength: return "zero-length";
+    case NormalIssue::NonUnit: return "non-unit";
+    case NormalIssue::FacingAway: return "facing away";
+    case NormalIssue::Count: break;
+    }
+    return "";
+}
+
+static bool cpu_has_avx2()
+{
+#if FBXAV_HAVE_AVX2
+    #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // OSがYMMレジスタを退避してくれるかも確認する
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+    #else
+    return __builtin_cpu_supports("avx2");
+    #endif
+#else
+    return false;
+#endif
+}
+
+SimdLevel detect_simd_level()
+{
+    static const SimdLevel level = cpu_has_avx2() ? SimdLevel::Avx2 : SimdLevel::Scalar;
+    return level;
+}
+
+static std::atomic<SimdLevel> g_simd_level = detect_simd_level();
+
+bool set_simd_level(SimdLevel level)
+{
+    if (level == SimdLevel::Avx2 && detect_simd_level() != SimdLevel::Avx2) return false;
+    g_simd_level = level;
+    return true;
+}
+
+SimdLevel get_simd_level()
+{
+    return g_simd_level;
+}
+
+bool parse_simd_level(std::string_view text, SimdLevel& level)
+{
+    if (text == "auto") level = detect_simd_level();
+    else if (text == "scalar") level = SimdLevel::Scalar;
+    else if (text == "avx2") level = SimdLevel::Avx2;
+    else return false;
+    return true;
+}
+
+#ifndef NDEBUG
+// デバッグビルドではAVX2版の結果をスカラー版と突き合わせる
+static void assert_same(const NormalCheckResult& a, const NormalCheckResult& b)
+{
+    for (int i = 0; i < normal_issue_count; ++i)
+    {
+        assert(a.counts[i] == b.counts[i]);
+        assert(a.offenders[i] == b.offenders[i]);
+    }
+}
+#endif
+
+void check_normals(const NormalArrays& normals, const NormalCheckOptions& options, NormalCheckResult& result)
+{
+    auto t = normal_kernels::make_thresholds(options);
+    result.checked += normals.count;
+#if FBXAV_HAVE_AVX2
+    if (get_simd_level() == SimdLevel::Avx2)
+    {
+    #ifndef NDEBUG
+        NormalCheckResult expected = result;
+        normal_kernels::check_scalar(normals, t, expected);
+    #endif
+        normal_kernels::check_avx2(normals, t, result);
+    #ifndef NDEBUG
+        assert_same(expected, result);
+    #endif
+        return;
+    }
+#endif
+    normal_kernels::check_scalar(normals, t, result);
+}
+
+void check_facing(const NormalArrays& normals, const NormalArrays& faces, const NormalCheckOptions& options, NormalCheckResult& result)
+{
+    auto t = normal_kernels::make_thresholds(options);
+    result.facing_checked += normals.count;
+#if FBXAV_HAVE_AVX2
+    if (get_simd_level() == SimdLevel::Avx2)
+    {
+    #ifndef NDEBUG
+        NormalCheckResult expected = result;
+        normal_kernels::facing_scalar(normals, faces, t, expected);
+    #endif
+        normal_kernels::facing_avx2(normals, faces, t, result);
+    #ifndef NDEBUG
+        assert_same(expected, result);
+    #endif
+        return;
+    }
+#endif
+    normal_kernels::facing_scalar(normals, faces, t, result);
+}
+
+static NormalArrays arrays_of(const SoaVectors& soa)
+{
+    return {soa.x.data(), soa.y.data(), soa.z.data(), soa.size()};
+}
+
+// 各ポリゴンの幾何法線をNewellの方法で求め、そのポリゴンの頂点ごとに並べる
+static void face_normals(FbxMesh* mesh, SoaVectors& faces)
+{
+    std::pmr::vector<int> starts(analysis_memory());
+    polygon_starts(mesh, starts);
+    const FbxVector4* points = mesh->GetControlPoints();
+    const int* vertices = mesh->GetPolygonVertices();
+    int point_count = mesh->GetControlPointsCount();
+
+    size_t count = mesh->GetPolygonVertexCount();
+    faces.x.assign(count, 0.0f);
+    faces.y.assign(count, 0.0f);
+    faces.z.assign(count, 0.0f);
+    for (size_t pi = 0; pi + 1 < starts.size(); ++pi)
+    {
+        int begin = starts[pi];
+        int end = starts[pi + 1];
+        double nx = 0, ny = 0, nz = 0;
+        bool valid = true;
+        for (int k = begin; k < end; ++k)
+        {
+            int a = vertices[k];
+            int b = vertices[k + 1 < end ? k + 1 : begin];
+            if (a < 0 || a >= point_count || b < 0 || b >= point_count)
+            {
+                valid = false;
+                break;
+            }
+            const FbxVector4& p = points[a];
+            const FbxVector4& q = points[b];
+            nx += (p[1] - q[1]) * (p[2] + q[2]);
+            ny += (p[2] - q[2]) * (p[0] + q[0]);
+            nz += (p[0] - q[0]) * (p[1] + q[1]);
+        }
+        // 頂点番号が壊れたポリゴンは0ベクトルのままにして、向きの検査から外す
+        if (!valid) continue;
+        std::fill(faces.x.begin() + begin, faces.x.begin() + end, static_cast<float>(nx));
+        std::fill(faces.y.begin() + begin, faces.y.begin() + end, static_cast<float>(ny));
+        std::fill(faces.z.begin() + begin, faces.z.begin() + end, static_cast<float>(nz));
+    }
+}
+
+bool validate_mesh_normals(FbxMesh* mesh, const NormalCheckOptions& options, NormalCheckResult& result)
+{
+    auto elnrm = mesh->GetElementNormal();
+    if (elnrm == nullptr) return false;
+
+    ResolvedElement<FbxVector4> normals;
+    resolve_element(mesh, elnrm, normals);
+
+    SoaVectors soa;
+    split_vectors(normals.values, soa);
+    check_normals(arrays_of(soa), options, result);
+
+    if (mesh->GetControlPoints() == nullptr) return true;
+
+    // 向きはポリゴン頂点の単位で比べる
+    if (normals.mapping != FbxGeometryElement::eByPolygonVertex)
+    {
+        std::pmr::vector<FbxVector4> expanded(analysis_memory());
+        if (!expand_to_polygon_vertex(mesh, normals, expanded)) return true;
+        split_vectors(expanded, soa);
+    }
+
+    SoaVectors faces;
+    face_normals(mesh, faces);
+    if (faces.size() != soa.size()) return true;
+    check_facing(arrays_of(soa), arrays_of(faces), options, result);
+    return true;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// 法線の異常の種類
+enum class NormalIssue
+{
+    NonFinite,  // NaNやInfを含む
+    ZeroLength, // 長さがほぼ0
+    NonUnit,    // 長さが1から許容誤差以上ずれている
+    FacingAway, // ポリゴンの幾何法線と逆を向いている
+    Count,
+};
+
+constexpr int normal_issue_count = static_cast<int>(NormalIssue::Count);
+
+const char* normal_issue_name(NormalIssue issue);
+
+struct NormalCheckOptions
+{
+    // 長さの許容誤差 |len - 1|
+    float tolerance = 1e-3f;
+    // これ以下の長さは0とみなす
+    float zero_length = 1e-6f;
+    // 種類ごとに記録する違反インデックスの数
+    int max_offenders = 16;
+};
+
+struct NormalCheckResult
+{
+    size_t checked = 0;
+    size_t facing_checked = 0;
+    size_t counts[normal_issue_count] = {};
+    // 種類ごとに最初に見つかった違反のインデックス（最大max_offenders個）
+    std::vector<int> offenders[normal_issue_count];
+};
+
+// x/y/zを別々に持つfloat配列
+struct NormalArrays
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    size_t count;
+};
+
+// 長さとNaN/Infの検査。インデックスはnormalsの並び
+void check_normals(const NormalArrays& normals, const NormalCheckOptions& options, NormalCheckResult& result);
+// 向きの検査。normalsとfacesはポリゴン頂点ごとに並んだ同じ長さの配列
+void check_facing(const NormalArrays& normals, const NormalArrays& faces, const NormalCheckOptions& options, NormalCheckResult& result);
+
+enum class SimdLevel
+{
+    Scalar,
+    Avx2,
+};
+
+// 実行中のCPUとビルドで使える一番速い実装
+SimdLevel detect_simd_level();
+// カーネルの実装を固定する（比較用）。使えない実装を指定したらfalse
+bool set_simd_level(SimdLevel level);
+SimdLevel get_simd_level();
+bool parse_simd_level(std::string_view text, SimdLevel& level);
+
+// メッシュの最初の法線要素を検査する。法線が無ければfalse。
+// 長さの検査は要素のマッピング単位、向きの検査はポリゴン頂点単位で数える
+bool validate_mesh_normals(FbxMesh* mesh, const NormalCheckOptions& options, NormalCheckResult& result);
@@ -0,0 +1,7 @@
+﻿#pragma once
+#include <cstddef>
+
+// プロセスが今使っている物理メモリ(常駐サイズ)をバイト数で返す。取得できなければ0
+size_t resident_memory();
+// 起動してからの常駐サイズの最大値をバイト数で返す。取得できなければ0
+size_t peak_resident_memory();
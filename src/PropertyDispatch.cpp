@@ -0,0 +1,164 @@
+﻿#include <cstring>
+#include <mutex>
+#include "PropertyDispatch.h"
+
+static const FbxImplementation* LookForImplementation(FbxSurfaceMaterial* pMaterial)
+{
+    const FbxImplementation* lImplementation = nullptr;
+    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_CGFX);
+    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_HLSL);
+    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_SFX);
+    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_OGS);
+    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_SSSL);
+    return lImplementation;
+}
+
+template <typename T> static void integer_handler(const FbxProperty& property, Report& report)
+{
+    report.binding_int64(static_cast<long long>(property.Get<T>()));
+}
+
+static void bool_handler(const FbxProperty& property, Report& report) { report.binding_bool(property.Get<FbxBool>()); }
+static void int_handler(const FbxProperty& property, Report& report) { report.binding_int(property.Get<FbxInt>()); }
+static void float_handler(const FbxProperty& property, Report& report) { report.binding_float(property.Get<FbxFloat>()); }
+static void double_handler(const FbxProperty& property, Report& report) { report.binding_double(property.Get<FbxDouble>()); }
+static void string_handler(const FbxProperty& property, Report& report) { report.binding_string(property.Get<FbxString>().Buffer()); }
+
+static void half_float_handler(const FbxProperty& property, Report& report)
+{
+    // 半精度はSDKがfloatへの変換を持っているので、floatとして読む
+    report.binding_float(property.Get<FbxFloat>());
+}
+
+static void double2_handler(const FbxProperty& property, Report& report)
+{
+    FbxDouble2 lDouble2 = property.Get<FbxDouble2>();
+    report.binding_vector(FbxVector4(lDouble2[0], lDouble2[1], 0.0), 2);
+}
+
+static void double3_handler(const FbxProperty& property, Report& report)
+{
+    FbxDouble3 lDouble3 = property.Get<FbxDouble3>();
+    report.binding_vector(FbxVector4(lDouble3[0], lDouble3[1], lDouble3[2]), 3);
+}
+
+static void double4_handler(const FbxProperty& property, Report& report)
+{
+    FbxDouble4 lDouble4 = property.Get<FbxDouble4>();
+    report.binding_vector(FbxVector4(lDouble4[0], lDouble4[1], lDouble4[2], lDouble4[3]), 4);
+}
+
+static void matrix_handler(const FbxProperty& property, Report& report) { report.binding_matrix(property.Get<FbxDouble4x4>()); }
+static void time_handler(const FbxProperty& property, Report& report) { report.binding_time(property.Get<FbxTime>()); }
+
+static void reference_handler(const FbxProperty& property, Report& report)
+{
+    // 参照型の値は接続そのもの。繋がった先のオブジェクトを出す
+    report.binding_reference(property.GetSrcObjectCount() > 0 ? property.GetSrcObject(0) : nullptr);
+}
+
+static void blob_handler(const FbxProperty& property, Report& report) { report.binding_blob(property.Get<FbxBlob>().Size()); }
+
+static void distance_handler(const FbxProperty& property, Report& report)
+{
+    FbxDistance lDistance = property.Get<FbxDistance>();
+    report.binding_distance(lDistance.value(), lDistance.unitName().Buffer());
+}
+
+static void date_time_handler(const FbxProperty& property, Report& report) { report.binding_string(property.Get<FbxDateTime>().toString().Buffer()); }
+
+// 表に無い型も黙って捨てず、型名だけは出す
+static void unsupported_handler(const FbxProperty& property, Report& report) { report.binding_unsupported(property.GetPropertyDataType().GetName()); }
+
+PropertyHandler property_handler(EFbxType type)
+{
+    static const auto table = [] {
+        std::vector<PropertyHandler> handlers(eFbxTypeCount, unsupported_handler);
+        handlers[eFbxChar] = integer_handler<FbxChar>;
+        handlers[eFbxUChar] = integer_handler<FbxUChar>;
+        handlers[eFbxShort] = integer_handler<FbxShort>;
+        handlers[eFbxUShort] = integer_handler<FbxUShort>;
+        handlers[eFbxUInt] = integer_handler<FbxUInt>;
+        handlers[eFbxLongLong] = integer_handler<FbxLongLong>;
+        handlers[eFbxULongLong] = integer_handler<FbxULongLong>;
+        handlers[eFbxHalfFloat] = half_float_handler;
+        handlers[eFbxBool] = bool_handler;
+        handlers[eFbxInt] = int_handler;
+        handlers[eFbxFloat] = float_handler;
+        handlers[eFbxDouble] = double_handler;
+        handlers[eFbxDouble2] = double2_handler;
+        handlers[eFbxDouble3] = double3_handler;
+        handlers[eFbxDouble4] = double4_handler;
+        handlers[eFbxDouble4x4] = matrix_handler;
+        handlers[eFbxEnum] = int_handler;
+        handlers[eFbxEnumM] = int_handler;
+        // FbxUrlDTやFbxXRefUrlDTも中身は文字列
+        handlers[eFbxString] = string_handler;
+        handlers[eFbxTime] = time_handler;
+        handlers[eFbxReference] = reference_handler;
+        handlers[eFbxBlob] = blob_handler;
+        handlers[eFbxDistance] = distance_handler;
+        handlers[eFbxDateTime] = date_time_handler;
+        return handlers;
+    }();
+    return type >= 0 && type < eFbxTypeCount ? table[type] : unsupported_handler;
+}
+
+// エントリの種類は静的な文字列なので、まずポインタで比べる
+static bool same_entry_type(const char* type, const char* expected) { return type == expected || (type && std::strcmp(type, expected) == 0); }
+
+static void resolve_binding(FbxSurfaceMaterial* material, const FbxImplementation* implementation, const FbxBindingTableEntry& entry, ResolvedBinding& binding)
+{
+    binding.source = entry.GetSource();
+
+    const char* type = entry.GetEntryType(true);
+    FbxProperty property;
+    if (same_entry_type(type, FbxPropertyEntryView::sEntryType))
+    {
+        property = material->FindPropertyHierarchical(entry.GetSource());
+        if (!property.IsValid()) property = material->RootProperty.FindHierarchical(entry.GetSource());
+    } else if (same_entry_type(type, FbxConstantEntryView::sEntryType))
+    {
+        property = implementation->GetConstants().FindHierarchical(entry.GetSource());
+    }
+    if (!property.IsValid()) return;
+    binding.property = property;
+
+    if (property.GetSrcObjectCount<FbxTexture>() > 0)
+    {
+        for (int j = 0; j < property.GetSrcObjectCount<FbxFileTexture>(); ++j) binding.textures.emplace_back(TextureKind::File, property.GetSrcObject<FbxFileTexture>(j)->GetFileName());
+        for (int j = 0; j < property.GetSrcObjectCount<FbxLayeredTexture>(); ++j) binding.textures.emplace_back(TextureKind::Layered, property.GetSrcObject<FbxLayeredTexture>(j)->GetName());
+        for (int j = 0; j < property.GetSrcObjectCount<FbxProceduralTexture>(); ++j)
+            binding.textures.emplace_back(TextureKind::Procedural, property.GetSrcObject<FbxProceduralTexture>(j)->GetName());
+        return;
+    }
+    binding.handler = property_handler(property.GetPropertyDataType().GetType());
+}
+
+void resolve_material(FbxSurfaceMaterial* material, ResolvedMaterial& resolved)
+{
+    resolved.implementation = LookForImplementation(material);
+    if (resolved.implementation == nullptr) return;
+
+    const FbxBindingTable* table = resolved.implementation->GetRootTable();
+    size_t count = table->GetEntryCount();
+    resolved.bindings.resize(count);
+    for (size_t i = 0; i < count; ++i) resolve_binding(material, resolved.implementation, table->GetEntry(i), resolved.bindings[i]);
+}
+
+const ResolvedMaterial& BindingCache::resolve(FbxSurfaceMaterial* material)
+{
+    {
+        std::shared_lock lock(mutex);
+        auto found = materials.find(material);
+        if (found != materials.end()) return *found->second;
+    }
+
+    // 解決は重いのでロックの外で行い、先に入れたスレッドがいればそちらを使う
+    auto resolved = std::make_unique<ResolvedMaterial>();
+    resolve_material(material, *resolved);
+
+    std::unique_lock lock(mutex);
+    auto [it, inserted] = materials.try_emplace(material, std::move(resolved));
+    return *it->second;
+}
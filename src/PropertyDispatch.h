@@ -0,0 +1,47 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Report.h"
+
+// プロパティの値をレポートに流す関数。データ型ごとに一つ
+using PropertyHandler = void (*)(const FbxProperty& property, Report& report);
+
+// EFbxTypeで引く表から取り出す。表は最初の呼び出しで一度だけ作る
+PropertyHandler property_handler(EFbxType type);
+
+// バインディングテーブルのエントリ一つを解決した結果
+struct ResolvedBinding
+{
+    FbxString source;
+    FbxProperty property;
+    // テクスチャが繋がっていればそちらを出し、値は出さない
+    std::vector<std::pair<TextureKind, const char*>> textures;
+    // プロパティが見つからなければnullptr
+    PropertyHandler handler = nullptr;
+};
+
+// マテリアル一つ分の解決結果。実装が無ければbindingsは空
+struct ResolvedMaterial
+{
+    const FbxImplementation* implementation = nullptr;
+    std::vector<ResolvedBinding> bindings;
+};
+
+// マテリアルごとに実装の検索とバインディングのプロパティ検索を一度で済ませるキャッシュ。
+// シーンを読む間だけ使う。メッシュを並列に解析するスレッドから同時に引いてよい
+class BindingCache
+{
+public:
+    const ResolvedMaterial& resolve(FbxSurfaceMaterial* material);
+
+private:
+    std::shared_mutex mutex;
+    std::unordered_map<FbxSurfaceMaterial*, std::unique_ptr<ResolvedMaterial>> materials;
+};
+
+// キャッシュを通さずにマテリアルを解決する
+void resolve_material(FbxSurfaceMaterial* material, ResolvedMaterial& resolved);
@@ -0,0 +1,355 @@
+﻿#include <cctype>
+#include <charconv>
+#include "Query.h"
+#include "Report.h"
+
+namespace
+{
+struct FieldName
+{
+    std::string_view name;
+    QueryField field;
+    bool numeric;
+};
+
+constexpr FieldName field_names[] = {
+    {"name", QueryField::Name, false},
+    {"path", QueryField::Path, false},
+    {"depth", QueryField::Depth, true},
+    {"type", QueryField::Type, false},
+    {"control_points", QueryField::ControlPoints, true},
+    {"polygons", QueryField::Polygons, true},
+    {"polygon_vertices", QueryField::PolygonVertices, true},
+    {"normals.mapping", QueryField::NormalsMapping, false},
+    {"normals.reference", QueryField::NormalsReference, false},
+    {"materials", QueryField::Materials, false},
+    {"materials.count", QueryField::MaterialCount, true},
+};
+
+const FieldName* find_field(std::string_view name)
+{
+    for (const auto& entry : field_names)
+    {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+// *を任意の文字列として扱う一致判定
+bool glob_match(std::string_view pattern, std::string_view text)
+{
+    size_t p = 0, t = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            resume = t;
+        } else if (p < pattern.size() && pattern[p] == text[t])
+        {
+            ++p;
+            ++t;
+        } else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            t = ++resume;
+        } else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+FbxMesh* mesh_of(const QueryItem& item)
+{
+    if (item.attr == nullptr || item.attr->GetAttributeType() != FbxNodeAttribute::eMesh) return nullptr;
+    return static_cast<FbxMesh*>(item.attr);
+}
+} // namespace
+
+// 再帰下降で式の木を作る
+class Query::Parser
+{
+public:
+    Parser(Query& query, std::string_view text) : query(query), text(text) {}
+
+    bool parse(std::string& error)
+    {
+        query.root = parse_or();
+        skip_space();
+        if (query.root >= 0 && pos < text.size()) fail("unexpected '" + std::string(text.substr(pos, 1)) + "'");
+        if (!message.empty())
+        {
+            error = message + " at offset " + std::to_string(failed_at);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // 括弧と!の入れ子の上限。構文解析も評価も再帰するので、スタックを使い切らないよう制限する
+    static constexpr int max_nesting = 64;
+    // 項の数の上限。&&や||の連鎖も評価では左に深い木になる
+    static constexpr size_t max_terms = 1024;
+
+    int parse_or()
+    {
+        int left = parse_and();
+        while (left >= 0 && accept("||"))
+        {
+            int right = parse_and();
+            if (right < 0) return -1;
+            left = add({Op::Or, left, right});
+        }
+        return left;
+    }
+
+    int parse_and()
+    {
+        int left = parse_unary();
+        while (left >= 0 && accept("&&"))
+        {
+            int right = parse_unary();
+            if (right < 0) return -1;
+            left = add({Op::And, left, right});
+        }
+        return left;
+    }
+
+    int parse_unary()
+    {
+        skip_space();
+        bool negate = pos < text.size() && text[pos] == '!' && !(pos + 1 < text.size() && text[pos + 1] == '=');
+        if (negate || accept("("))
+        {
+            if (nesting == max_nesting)
+            {
+                // 位置は入れ子を開いた文字を指す
+                if (!negate) --pos;
+                return fail("expression is nested too deeply");
+            }
+            ++nesting;
+            int result = negate ? parse_negation() : parse_group();
+            --nesting;
+            return result;
+        }
+        return parse_comparison();
+    }
+
+    int parse_negation()
+    {
+        ++pos;
+        int operand = parse_unary();
+        if (operand < 0) return -1;
+        return add({Op::Not, operand});
+    }
+
+    int parse_group()
+    {
+        int inner = parse_or();
+        if (inner < 0) return -1;
+        if (!accept(")")) return fail("expected ')'");
+        return inner;
+    }
+
+    int parse_comparison()
+    {
+        skip_space();
+        size_t start = pos;
+        auto name = word();
+        auto field = find_field(name);
+        if (field == nullptr)
+        {
+            pos = start;
+            return fail(name.empty() ? "expected a field name" : "unknown field '" + std::string(name) + "'");
+        }
+
+        Term term{Op::Equal};
+        if (accept("==")) term.op = Op::Equal;
+        else if (accept("!=")) term.op = Op::NotEqual;
+        else if (accept("<=")) term.op = Op::LessEqual;
+        else if (accept(">=")) term.op = Op::GreaterEqual;
+        else if (accept("<")) term.op = Op::Less;
+        else if (accept(">")) term.op = Op::Greater;
+        else return fail("expected a comparison operator");
+
+        if (!value(term.value)) return -1;
+        term.field = field->field;
+        if (field->numeric)
+        {
+            auto [ptr, ec] = std::from_chars(term.value.data(), term.value.data() + term.value.size(), term.number);
+            if (ec != std::errc() || ptr != term.value.data() + term.value.size()) return fail(std::string(name) + " needs a number");
+        } else if (term.op != Op::Equal && term.op != Op::NotEqual)
+        {
+            return fail(std::string(name) + " only supports == and !=");
+        }
+        query.used |= 1u << static_cast<int>(field->field);
+        return add(std::move(term));
+    }
+
+    // 引用符で囲んだ文字列か、区切り文字までの語
+    bool value(std::string& out)
+    {
+        skip_space();
+        if (pos < text.size() && (text[pos] == '"' || text[pos] == '\''))
+        {
+            char quote = text[pos];
+            size_t end = text.find(quote, pos + 1);
+            if (end == std::string_view::npos)
+            {
+                fail("unterminated string");
+                return false;
+            }
+            out = text.substr(pos + 1, end - pos - 1);
+            pos = end + 1;
+            return true;
+        }
+        out = word();
+        if (out.empty())
+        {
+            fail("expected a value");
+            return false;
+        }
+        return true;
+    }
+
+    std::string_view word()
+    {
+        size_t start = pos;
+        while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos])) && std::string_view("()&|!=<>\"'").find(text[pos]) == std::string_view::npos) ++pos;
+        return text.substr(start, pos - start);
+    }
+
+    bool accept(std::string_view token)
+    {
+        skip_space();
+        if (text.substr(pos, token.size()) != token) return false;
+        pos += token.size();
+        return true;
+    }
+
+    void skip_space()
+    {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    }
+
+    int add(Term term)
+    {
+        if (query.terms.size() == max_terms) return fail("expression has too many terms");
+        query.terms.push_back(std::move(term));
+        return static_cast<int>(query.terms.size()) - 1;
+    }
+
+    int fail(std::string text)
+    {
+        if (message.empty())
+        {
+            message = std::move(text);
+            failed_at = pos;
+        }
+        return -1;
+    }
+
+    Query& query;
+    std::string_view text;
+    size_t pos = 0;
+    int nesting = 0;
+    std::string message;
+    size_t failed_at = 0;
+};
+
+bool Query::parse(std::string_view text, std::string& error)
+{
+    terms.clear();
+    used = 0;
+    source = text;
+    Parser parser(*this, text);
+    return parser.parse(error);
+}
+
+bool Query::matches(const QueryItem& item) const
+{
+    return root < 0 || evaluate(root, item);
+}
+
+bool Query::evaluate(int index, const QueryItem& item) const
+{
+    const Term& term = terms[index];
+    switch (term.op)
+    {
+    case Op::And: return evaluate(term.left, item) && evaluate(term.right, item);
+    case Op::Or: return evaluate(term.left, item) || evaluate(term.right, item);
+    case Op::Not: return !evaluate(term.left, item);
+    default: return compare(term, item);
+    }
+}
+
+bool Query::compare(const Term& term, const QueryItem& item) const
+{
+    // 値を持たない項目(メッシュ以外のpolygonsなど)は、!=だけが真になる
+    auto number = [&](bool present, double value) {
+        if (!present) return term.op == Op::NotEqual;
+        switch (term.op)
+        {
+        case Op::Equal: return value == term.number;
+        case Op::NotEqual: return value != term.number;
+        case Op::Less: return value < term.number;
+        case Op::LessEqual: return value <= term.number;
+        case Op::Greater: return value > term.number;
+        case Op::GreaterEqual: return value >= term.number;
+        default: return false;
+        }
+    };
+    auto text = [&](std::string_view value) { return glob_match(term.value, value) == (term.op == Op::Equal); };
+
+    FbxMesh* mesh = mesh_of(item);
+    auto normals = mesh ? mesh->GetElementNormal() : nullptr;
+    switch (term.field)
+    {
+    case QueryField::Name: return text(item.node->GetName());
+    case QueryField::Path: return text(item.path);
+    case QueryField::Depth: return number(true, item.depth);
+    case QueryField::Type: return text(item.attr ? attribute_type_name(item.attr->GetAttributeType()) : "none");
+    case QueryField::ControlPoints: return number(mesh != nullptr, mesh ? mesh->GetControlPointsCount() : 0);
+    case QueryField::Polygons: return number(mesh != nullptr, mesh ? mesh->GetPolygonCount() : 0);
+    case QueryField::PolygonVertices: return number(mesh != nullptr, mesh ? mesh->GetPolygonVertexCount() : 0);
+    case QueryField::NormalsMapping: return text(normals ? mapping_mode_name(normals->GetMappingMode()) : "none");
+    case QueryField::NormalsReference: return normals ? text(reference_mode_name(normals->GetReferenceMode())) : term.op == Op::NotEqual;
+    case QueryField::Materials:
+    {
+        if (item.material) return text(item.material->GetName());
+        // ==はどれか一つが一致すれば真、!=はどれも一致しなければ真
+        bool equal = term.op == Op::Equal;
+        for (int i = 0; i < item.node->GetMaterialCount(); ++i)
+        {
+            auto material = item.node->GetMaterial(i);
+            if (material && glob_match(term.value, material->GetName())) return equal;
+        }
+        return !equal;
+    }
+    case QueryField::MaterialCount: return number(true, item.node->GetMaterialCount());
+    case QueryField::Count: break;
+    }
+    return false;
+}
+
+bool parse_query_selection(std::string_view text, QuerySelection& selection)
+{
+    selection = {false, false, false, false};
+    while (!text.empty())
+    {
+        size_t comma = text.find(',');
+        auto name = text.substr(0, comma);
+        if (name == "name") selection.names = true;
+        else if (name == "normals") selection.normals = true;
+        else if (name == "materials") selection.materials = true;
+        else if (name == "statistics") selection.statistics = true;
+        else return false;
+        if (comma == std::string_view::npos) break;
+        text.remove_prefix(comma + 1);
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// --whereで参照できる項目
+enum class QueryField
+{
+    Name,             // ノード名
+    Path,             // ルートからの階層を"/"で繋いだもの
+    Depth,            // ルートの子が0
+    Type,             // アトリビュートの種類(mesh, skeletonなど)。アトリビュートが無ければnone
+    ControlPoints,    // 以下はメッシュだけが値を持つ
+    Polygons,
+    PolygonVertices,
+    NormalsMapping,   // 最初の法線要素のマッピング(control_point, polygon_vertexなど)。無ければnone
+    NormalsReference, // direct, index, index_to_direct
+    Materials,        // ノードのマテリアル名。DisplayMaterial()の中ではそのマテリアルだけ
+    MaterialCount,
+    Count,
+};
+
+// 評価する対象。read()ではノードとアトリビュートの組、DisplayMaterial()ではさらにマテリアル一つ
+struct QueryItem
+{
+    FbxNode* node;
+    FbxNodeAttribute* attr;
+    std::string_view path;
+    int depth;
+    FbxSurfaceMaterial* material = nullptr;
+};
+
+// "type==mesh && normals.mapping==polygon_vertex" のような条件式。
+// 比較(==, !=, <, <=, >, >=)を&&、||、!と括弧で組み合わせる。文字列の==と!=では*が任意の文字列に一致する。
+// 値を複数持つ項目(materials)は、==ならどれか一つ、!=ならどれも一致しないときに真になる
+class Query
+{
+public:
+    // 解釈できなければerrorに理由を入れてfalseを返す
+    bool parse(std::string_view text, std::string& error);
+
+    bool empty() const { return terms.empty(); }
+    bool matches(const QueryItem& item) const;
+    // 式がfieldを参照しているか。読み込むデータを決めるのに使う
+    bool uses(QueryField field) const { return used & (1u << static_cast<int>(field)); }
+
+    // 元の式。キャッシュのキーに使う
+    const std::string& text() const { return source; }
+
+private:
+    enum class Op
+    {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        And,
+        Or,
+        Not,
+    };
+
+    // 式の木の節。left/rightはtermsの添字
+    struct Term
+    {
+        Op op;
+        int left = -1;
+        int right = -1;
+        QueryField field = QueryField::Count;
+        std::string value;
+        double number = 0;
+    };
+
+    class Parser;
+
+    bool evaluate(int index, const QueryItem& item) const;
+    bool compare(const Term& term, const QueryItem& item) const;
+
+    std::vector<Term> terms;
+    int root = -1;
+    unsigned used = 0;
+    std::string source;
+};
+
+// --selectの区画。指定されたものだけを出す
+struct QuerySelection
+{
+    bool names = true;
+    bool normals = true;
+    bool materials = true;
+    bool statistics = false;
+};
+
+// "name,materials" のようなカンマ区切りの一覧。知らない名前があればfalse
+bool parse_query_selection(std::string_view text, QuerySelection& selection);
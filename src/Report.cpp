@@ -0,0 +1,85 @@
+﻿#include "JsonReport.h"
+#include "Report.h"
+#include "ReportWriter.h"
+#include "TextReport.h"
+
+void Report::splice(ReportWriter& part)
+{
+    out << part.view();
+    part.clear();
+}
+
+bool parse_report_format(std::string_view text, ReportFormat& format)
+{
+    if (text == "text") format = ReportFormat::Text;
+    else if (text == "json") format = ReportFormat::Json;
+    else if (text == "ndjson") format = ReportFormat::NdJson;
+    else return false;
+    return true;
+}
+
+const char* attribute_type_name(FbxNodeAttribute::EType type)
+{
+    switch (type)
+    {
+    case FbxNodeAttribute::eUnknown: return "unknown";
+    case FbxNodeAttribute::eNull: return "null";
+    case FbxNodeAttribute::eMarker: return "marker";
+    case FbxNodeAttribute::eSkeleton: return "skeleton";
+    case FbxNodeAttribute::eMesh: return "mesh";
+    case FbxNodeAttribute::eNurbs: return "nurbs";
+    case FbxNodeAttribute::ePatch: return "patch";
+    case FbxNodeAttribute::eCamera: return "camera";
+    case FbxNodeAttribute::eCameraStereo: return "camera_stereo";
+    case FbxNodeAttribute::eCameraSwitcher: return "camera_switcher";
+    case FbxNodeAttribute::eLight: return "light";
+    case FbxNodeAttribute::eOpticalReference: return "optical_reference";
+    case FbxNodeAttribute::eOpticalMarker: return "optical_marker";
+    case FbxNodeAttribute::eNurbsCurve: return "nurbs_curve";
+    case FbxNodeAttribute::eTrimNurbsSurface: return "trim_nurbs_surface";
+    case FbxNodeAttribute::eBoundary: return "boundary";
+    case FbxNodeAttribute::eNurbsSurface: return "nurbs_surface";
+    case FbxNodeAttribute::eShape: return "shape";
+    case FbxNodeAttribute::eLODGroup: return "lod_group";
+    case FbxNodeAttribute::eSubDiv: return "subdiv";
+    case FbxNodeAttribute::eCachedEffect: return "cached_effect";
+    case FbxNodeAttribute::eLine: return "line";
+    }
+    return "unknown";
+}
+
+const char* mapping_mode_name(FbxGeometryElement::EMappingMode mode)
+{
+    switch (mode)
+    {
+    case FbxGeometryElement::eNone: return "none";
+    case FbxGeometryElement::eByControlPoint: return "control_point";
+    case FbxGeometryElement::eByPolygonVertex: return "polygon_vertex";
+    case FbxGeometryElement::eByPolygon: return "polygon";
+    case FbxGeometryElement::eByEdge: return "edge";
+    case FbxGeometryElement::eAllSame: return "all_same";
+    }
+    return "none";
+}
+
+const char* reference_mode_name(FbxGeometryElement::EReferenceMode mode)
+{
+    switch (mode)
+    {
+    case FbxGeometryElement::eDirect: return "direct";
+    case FbxGeometryElement::eIndex: return "index";
+    case FbxGeometryElement::eIndexToDirect: return "index_to_direct";
+    }
+    return "direct";
+}
+
+std::unique_ptr<Report> create_report(ReportFormat format, ReportWriter& out)
+{
+    switch (format)
+    {
+    case ReportFormat::Json: return std::make_unique<JsonReport>(out, false);
+    case ReportFormat::NdJson: return std::make_unique<JsonReport>(out, true);
+    case ReportFormat::Text: break;
+    }
+    return std::make_unique<TextReport>(out);
+}
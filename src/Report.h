@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <memory>
+#include <string_view>
+#include "MeshStatistics.h"
+#include "NormalRecompute.h"
+#include "NormalValidation.h"
+
+class ReportWriter;
+
+enum class ReportFormat
+{
+    Text,
+    Json,
+    NdJson,
+};
+
+// "text" / "json" / "ndjson" を解釈する
+bool parse_report_format(std::string_view text, ReportFormat& format);
+
+// バインディングテーブルのエントリに繋がったテクスチャの種類
+enum class TextureKind
+{
+    File,
+    Layered,
+    Procedural,
+};
+
+// シーンを辿りながら呼ばれるレポートの出力先。
+// read()やDisplayMaterial()は見つけたものをこのイベントとして流すだけで、書式は実装側が決める。
+class Report
+{
+public:
+    explicit Report(ReportWriter& out) : out(out) {}
+    virtual ~Report() = default;
+
+    // 同じ書式で別のライタに書くレポートを作る。メッシュを並列に解析するときに使う
+    virtual std::unique_ptr<Report> fork(ReportWriter& part) const = 0;
+    // fork()したレポートが書いた内容をこの位置に差し込む
+    void splice(ReportWriter& part);
+
+    virtual void begin_file(const char* path) = 0;
+    virtual void end_file() = 0;
+
+    // pathはルートからの階層を"/"で繋いだもの、depthはルートの子が0
+    virtual void node(FbxNode* node, int depth, std::string_view path) = 0;
+    virtual void attribute(FbxNode* node, FbxNodeAttribute* attr) = 0;
+
+    virtual void begin_mesh(FbxNode* node, FbxMesh* mesh) = 0;
+    virtual void end_mesh() = 0;
+
+    virtual void begin_normals(FbxMesh* mesh, FbxGeometryElementNormal* element) = 0;
+    virtual void control_point_normal(int vi, const FbxVector4& normal) = 0;
+    virtual void polygon_vertex_normal(int pi, int i, const FbxVector4& normal) = 0;
+    virtual void end_normals() = 0;
+    virtual void normal_validation(FbxMesh* mesh, FbxGeometryElementNormal* element, const NormalCheckResult& result) = 0;
+    // --compare-normalsで計算し直したスムーズ法線とのずれ
+    virtual void normal_comparison(FbxMesh* mesh, FbxGeometryElementNormal* element, const NormalComparison& comparison) = 0;
+
+    // --stats-meshの集計。メッシュごとにbegin_mesh()の直後と、シーン全体の合計をend_file()の前に流す
+    virtual void mesh_statistics(FbxMesh* mesh, const MeshStatistics& statistics) = 0;
+    virtual void scene_statistics(const MeshStatistics& statistics) = 0;
+
+    virtual void begin_materials(FbxNode* node, int count) = 0;
+    virtual void begin_material(int index, FbxSurfaceMaterial* material) = 0;
+    // --dedup-materialsのとき、詳しく出すマテリアルに付く番号
+    virtual void material_id(int id) = 0;
+    // 同じ内容のマテリアルが既に出ているので、詳細の代わりにそちらを指す
+    virtual void material_reference(int index, FbxSurfaceMaterial* material, int id, FbxSurfaceMaterial* original) = 0;
+    virtual void implementation(const FbxImplementation* implementation) = 0;
+    virtual void binding_entry(const char* source) = 0;
+    virtual void binding_texture(TextureKind kind, const char* name) = 0;
+    virtual void binding_bool(bool value) = 0;
+    virtual void binding_int(int value) = 0;
+    virtual void binding_float(double value) = 0;
+    virtual void binding_double(double value) = 0;
+    virtual void binding_string(const char* value) = 0;
+    virtual void binding_vector(const FbxVector4& value, int size) = 0;
+    virtual void binding_matrix(const FbxDouble4x4& value) = 0;
+    virtual void binding_int64(long long value) = 0;
+    virtual void binding_time(const FbxTime& value) = 0;
+    // 参照型のプロパティが指すオブジェクト。繋がっていなければnullptr
+    virtual void binding_reference(FbxObject* object) = 0;
+    virtual void binding_blob(size_t size) = 0;
+    virtual void binding_distance(double value, const char* unit) = 0;
+    // 値を読めない型。型名だけを出す
+    virtual void binding_unsupported(const char* type_name) = 0;
+    virtual void material_color(const char* name, const FbxColor& value) = 0;
+    virtual void material_scalar(const char* name, double value) = 0;
+    virtual void unknown_material() = 0;
+    virtual void end_material(const char* shading_model) = 0;
+    virtual void end_materials() = 0;
+
+protected:
+    ReportWriter& out;
+};
+
+std::unique_ptr<Report> create_report(ReportFormat format, ReportWriter& out);
+
+// 構造化レポートと--whereで使う列挙値の名前（"mesh"、"polygon_vertex"など）
+const char* attribute_type_name(FbxNodeAttribute::EType type);
+const char* mapping_mode_name(FbxGeometryElement::EMappingMode mode);
+const char* reference_mode_name(FbxGeometryElement::EReferenceMode mode);
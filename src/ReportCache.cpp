@@ -0,0 +1,257 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Hash.h"
+#include "ReportCache.h"
+#include "Stats.h"
+
+namespace fs = std::filesystem;
+
+// エントリの先頭に置くヘッダ。lengthが合わなければ壊れているとみなす
+struct CacheEntryHeader
+{
+    char magic[8];
+    uint64_t key;
+    uint64_t length;
+};
+
+static constexpr char entry_magic[8] = {'F', 'B', 'X', 'A', 'V', 'R', 'C', '1'};
+static constexpr const char* entry_extension = ".report";
+static constexpr const char* index_name = "index";
+// 同じファイルでもSDKが違えば読み込み結果が変わりうる
+static const std::string_view sdk_version = FbxManager::GetVersion(true);
+
+static bool hash_file(const std::string& path, uint64_t& hash)
+{
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+
+    Xxh64 state;
+    std::vector<char> buffer(1 << 20);
+    size_t size;
+    while ((size = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) state.update(buffer.data(), size);
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+
+    hash = state.digest();
+    return ok;
+}
+
+// 同じ名前のファイルへ同時に書くスレッドがあっても一時ファイルは衝突しないようにする
+static fs::path temporary_path(const fs::path& path)
+{
+    static std::atomic<uint64_t> counter = 0;
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%zx-%llx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()), static_cast<unsigned long long>(counter++));
+    auto result = path;
+    result += suffix;
+    return result;
+}
+
+// 一時ファイルに書いてから置き換える
+static bool write_atomically(const fs::path& path, const void* header, size_t header_size, std::string_view data)
+{
+    auto temporary = temporary_path(path);
+    bool ok;
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (header_size > 0) file.write(static_cast<const char*>(header), header_size);
+        file.write(data.data(), data.size());
+        file.close();
+        ok = !file.fail();
+    }
+
+    std::error_code ec;
+    if (ok) fs::rename(temporary, path, ec);
+    if (!ok || ec)
+    {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+ReportCache::ReportCache(fs::path dir, uint64_t max_bytes, bool trust_stamps) : dir(std::move(dir)), max_bytes(max_bytes), trust_stamps(trust_stamps) {}
+
+ReportCache::~ReportCache() { close(); }
+
+bool ReportCache::open(std::ostream& err)
+{
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec || !fs::is_directory(dir, ec))
+    {
+        err << "Error: Unable to create cache directory " << dir.string() << std::endl;
+        return false;
+    }
+
+    // 索引は1行に "サイズ 更新日時 ハッシュ パス" の形で並ぶ
+    std::ifstream index(dir / index_name);
+    std::string line;
+    while (std::getline(index, line))
+    {
+        std::istringstream fields(line);
+        Stamp stamp;
+        std::string path;
+        fields >> stamp.size >> stamp.mtime >> std::hex >> stamp.hash;
+        if (!fields || fields.get() != ' ' || !std::getline(fields, path) || path.empty()) continue;
+        stamps[path] = stamp;
+    }
+
+    opened = true;
+    return true;
+}
+
+bool ReportCache::key(const std::string& path, std::string_view options, uint64_t& key)
+{
+    FBXAV_STATS_SCOPE(Cache);
+    std::error_code ec;
+    uint64_t size = fs::file_size(path, ec);
+    if (ec) return false;
+    int64_t mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) return false;
+
+    uint64_t hash = 0;
+    bool known = false;
+    if (trust_stamps)
+    {
+        std::lock_guard lock(mutex);
+        auto found = stamps.find(path);
+        if (found != stamps.end() && found->second.size == size && found->second.mtime == mtime)
+        {
+            hash = found->second.hash;
+            known = true;
+        }
+    }
+
+    if (!known)
+    {
+        if (!hash_file(path, hash)) return false;
+        std::lock_guard lock(mutex);
+        stamps[path] = {size, mtime, hash};
+        stamps_changed = true;
+    }
+
+    // レポートにはパスも出るので、内容が同じでも場所が違えば別のエントリにする
+    Xxh64 state(hash);
+    state.update_value(report_cache_version);
+    state.update_value(sdk_version.size());
+    state.update(sdk_version);
+    state.update_value(options.size());
+    state.update(options);
+    state.update(path);
+    key = state.digest();
+    return true;
+}
+
+fs::path ReportCache::entry_path(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), entry_extension);
+    return dir / name;
+}
+
+bool ReportCache::load(uint64_t key, std::string& report)
+{
+    FBXAV_STATS_SCOPE(Cache);
+    auto path = entry_path(key);
+    std::ifstream file(path, std::ios::binary);
+
+    CacheEntryHeader header;
+    bool ok = file.read(reinterpret_cast<char*>(&header), sizeof(header)) && std::memcmp(header.magic, entry_magic, sizeof(entry_magic)) == 0 && header.key == key;
+    if (ok)
+    {
+        report.resize(header.length);
+        ok = file.read(report.data(), header.length) && file.peek() == std::char_traits<char>::eof();
+    }
+    if (!ok)
+    {
+        ++miss_count;
+        return false;
+    }
+    file.close();
+
+    // 更新日時を最後に使った時刻として扱い、追い出す順番を決める
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    ++hit_count;
+    return true;
+}
+
+void ReportCache::store(uint64_t key, std::string_view report)
+{
+    FBXAV_STATS_SCOPE(Cache);
+    CacheEntryHeader header;
+    std::memcpy(header.magic, entry_magic, sizeof(entry_magic));
+    header.key = key;
+    header.length = report.size();
+    write_atomically(entry_path(key), &header, sizeof(header), report);
+}
+
+void ReportCache::close()
+{
+    if (!opened) return;
+    opened = false;
+
+    if (stamps_changed)
+    {
+        std::ostringstream index;
+        for (const auto& [path, stamp] : stamps) index << stamp.size << ' ' << stamp.mtime << ' ' << std::hex << stamp.hash << std::dec << ' ' << path << '\n';
+        write_atomically(dir / index_name, nullptr, 0, std::move(index).str());
+        stamps_changed = false;
+    }
+
+    evict();
+}
+
+void ReportCache::evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type time;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    auto now = fs::file_time_type::clock::now();
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+    {
+        std::error_code entry_ec;
+        auto path = it->path();
+        auto time = it->last_write_time(entry_ec);
+        if (entry_ec) continue;
+
+        // 落ちたプロセスが残した一時ファイルは、十分古ければ片付ける
+        if (path.extension() == ".tmp")
+        {
+            if (now - time > std::chrono::hours(1)) fs::remove(path, entry_ec);
+            continue;
+        }
+        if (path.extension() != entry_extension) continue;
+
+        auto size = it->file_size(entry_ec);
+        if (entry_ec) continue;
+        entries.push_back({path, size, time});
+        total += size;
+    }
+    if (total <= max_bytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const auto& entry : entries)
+    {
+        if (total <= max_bytes) break;
+        std::error_code remove_ec;
+        if (fs::remove(entry.path, remove_ec)) total -= entry.size;
+    }
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// レポートの書式や内容を変えたら上げる。古いキャッシュは自然に外れる。
+// 2: バインディングの型の追加、法線の再計算との比較など、1以降の出力の変更
+// キーにはFBX SDKのバージョンも含めるので、SDKを入れ替えたときは上げなくてよい
+constexpr uint32_t report_cache_version = 2;
+
+// 生成したレポートをファイル内容のハッシュ・オプション・ツールのバージョンをキーにディスクへ保存する。
+// 変わっていないファイルはimportせずにキャッシュの内容をそのまま流せる。
+// 複数のワーカースレッドから同時に使ってよい
+class ReportCache
+{
+public:
+    // max_bytesを超えた分は、最後に使われたのが古いエントリから消す。
+    // trust_stampsなら更新日時とサイズが前回と同じファイルはハッシュを計算し直さない
+    ReportCache(std::filesystem::path dir, uint64_t max_bytes, bool trust_stamps);
+    ~ReportCache();
+
+    ReportCache(const ReportCache&) = delete;
+    ReportCache& operator=(const ReportCache&) = delete;
+
+    // ディレクトリを作り、前回の索引を読む
+    bool open(std::ostream& err);
+
+    // pathのエントリのキーを求める。ファイルが読めなければfalseを返す
+    bool key(const std::string& path, std::string_view options, uint64_t& key);
+    // 見つかればreportに読み込んでtrueを返す
+    bool load(uint64_t key, std::string& report);
+    // 一時ファイルに書いてから名前を変えるので、途中で落ちても壊れたエントリは残らない
+    void store(uint64_t key, std::string_view report);
+
+    // 索引を保存し、容量を超えていれば古いエントリを消す
+    void close();
+
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+
+private:
+    // 前回ハッシュを計算したときのファイルの状態
+    struct Stamp
+    {
+        uint64_t size;
+        int64_t mtime;
+        uint64_t hash;
+    };
+
+    std::filesystem::path entry_path(uint64_t key) const;
+    void evict();
+
+    std::filesystem::path dir;
+    uint64_t max_bytes;
+    bool trust_stamps;
+    bool opened = false;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Stamp> stamps;
+    bool stamps_changed = false;
+
+    std::atomic<size_t> hit_count = 0;
+    std::atomic<size_t> miss_count = 0;
+};
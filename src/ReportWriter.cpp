@@ -0,0 +1,107 @@
+﻿#include <charconv>
+#include <cstring>
+#include "ReportWriter.h"
+#include "Stats.h"
+
+// 数値一つ分の書き込みに必要な最大文字数
+static constexpr size_t max_number_chars = 32;
+
+ReportWriter::ReportWriter(std::FILE* sink, size_t capacity, std::pmr::memory_resource* memory)
+    : sink(sink), memory(memory ? memory : std::pmr::new_delete_resource()), buffer(static_cast<char*>(this->memory->allocate(capacity, 1))), capacity(capacity)
+{
+}
+
+ReportWriter::~ReportWriter()
+{
+    flush();
+    memory->deallocate(buffer, capacity, 1);
+}
+
+void ReportWriter::write(std::string_view text)
+{
+    if (capacity - size < text.size())
+    {
+        // バッファより大きな書き込みはコピーせずそのまま流す
+        if (sink && text.size() >= capacity)
+        {
+            flush();
+            FBXAV_STATS_SCOPE(Output);
+            FBXAV_STATS_COUNT(OutputBytes, text.size());
+            std::fwrite(text.data(), 1, text.size(), sink);
+            return;
+        }
+        grow(text.size());
+    }
+    std::memcpy(buffer + size, text.data(), text.size());
+    size += text.size();
+}
+
+void ReportWriter::write_int(long long value)
+{
+    reserve(max_number_chars);
+    auto result = std::to_chars(buffer + size, buffer + capacity, value);
+    size = result.ptr - buffer;
+}
+
+void ReportWriter::write_uint(unsigned long long value)
+{
+    reserve(max_number_chars);
+    auto result = std::to_chars(buffer + size, buffer + capacity, value);
+    size = result.ptr - buffer;
+}
+
+void ReportWriter::write_float(float value)
+{
+    reserve(max_number_chars);
+    auto result = std::to_chars(buffer + size, buffer + capacity, value, std::chars_format::general, 6);
+    size = result.ptr - buffer;
+}
+
+void ReportWriter::write_double(double value)
+{
+    reserve(max_number_chars);
+    auto result = std::to_chars(buffer + size, buffer + capacity, value, std::chars_format::general, 6);
+    size = result.ptr - buffer;
+}
+
+void ReportWriter::write_shortest(double value)
+{
+    reserve(max_number_chars);
+    auto result = std::to_chars(buffer + size, buffer + capacity, value);
+    size = result.ptr - buffer;
+}
+
+void ReportWriter::flush()
+{
+    if (sink == nullptr || size == 0) return;
+    FBXAV_STATS_SCOPE(Output);
+    FBXAV_STATS_COUNT(OutputBytes, size);
+    std::fwrite(buffer, 1, size, sink);
+    std::fflush(sink);
+    size = 0;
+}
+
+std::string ReportWriter::take()
+{
+    std::string text(buffer, size);
+    size = 0;
+    return text;
+}
+
+void ReportWriter::grow(size_t n)
+{
+    if (sink)
+    {
+        flush();
+        if (capacity >= n) return;
+    }
+
+    // メモリモードでは倍々に拡張して、行ごとの確保にならないようにする
+    size_t new_capacity = capacity * 2;
+    while (new_capacity - size < n) new_capacity *= 2;
+    auto new_buffer = static_cast<char*>(memory->allocate(new_capacity, 1));
+    std::memcpy(new_buffer, buffer, size);
+    memory->deallocate(buffer, capacity, 1);
+    buffer = new_buffer;
+    capacity = new_capacity;
+}
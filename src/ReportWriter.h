@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// レポート出力用のバッファ付きライタ。
+// 行ごとのヒープ確保やフラッシュをせず、数値はstd::to_charsで直接バッファに書き込む。
+// sinkを指定するとバッファが埋まるたびにそこへ書き出し、nullptrならメモリ上に溜め続ける。
+// バッファはmemoryから確保する。nullptrなら通常のヒープ
+class ReportWriter
+{
+public:
+    static constexpr size_t default_capacity = 1 << 20;
+
+    explicit ReportWriter(std::FILE* sink = nullptr, size_t capacity = default_capacity, std::pmr::memory_resource* memory = nullptr);
+    ~ReportWriter();
+
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    void write(std::string_view text);
+    void write(char c)
+    {
+        if (size == capacity) grow(1);
+        buffer[size++] = c;
+    }
+
+    // 整数は%d、浮動小数点数はiostreamの既定と同じ%g（有効数字6桁）で書く
+    void write_int(long long value);
+    void write_uint(unsigned long long value);
+    void write_float(float value);
+    void write_double(double value);
+
+    // 往復変換で値が変わらない最短表現で書く（構造化出力用）
+    void write_shortest(double value);
+
+    // sinkへ書き出す。メモリモードでは何もしない
+    void flush();
+
+    // メモリモードで溜めた内容
+    std::string_view view() const { return std::string_view(buffer, size); }
+    // 溜めた内容を取り出してバッファを空にする
+    std::string take();
+    void clear() { size = 0; }
+
+    ReportWriter& operator<<(std::string_view text)
+    {
+        write(text);
+        return *this;
+    }
+    ReportWriter& operator<<(const char* text)
+    {
+        if (text) write(std::string_view(text));
+        return *this;
+    }
+    ReportWriter& operator<<(char c)
+    {
+        write(c);
+        return *this;
+    }
+    ReportWriter& operator<<(int value)
+    {
+        write_int(value);
+        return *this;
+    }
+    ReportWriter& operator<<(long value)
+    {
+        write_int(value);
+        return *this;
+    }
+    ReportWriter& operator<<(long long value)
+    {
+        write_int(value);
+        return *this;
+    }
+    ReportWriter& operator<<(unsigned value)
+    {
+        write_uint(value);
+        return *this;
+    }
+    ReportWriter& operator<<(unsigned long value)
+    {
+        write_uint(value);
+        return *this;
+    }
+    ReportWriter& operator<<(unsigned long long value)
+    {
+        write_uint(value);
+        return *this;
+    }
+    ReportWriter& operator<<(float value)
+    {
+        write_float(value);
+        return *this;
+    }
+    ReportWriter& operator<<(double value)
+    {
+        write_double(value);
+        return *this;
+    }
+
+private:
+    // 少なくともn文字分の空きを用意する
+    void reserve(size_t n)
+    {
+        if (capacity - size < n) grow(n);
+    }
+    void grow(size_t n);
+
+    std::FILE* sink;
+    std::pmr::memory_resource* memory;
+    char* buffer;
+    size_t capacity;
+    size_t size = 0;
+};
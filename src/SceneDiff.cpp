@@ -0,0 +1,368 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "FbxPtr.h"
+#include "Hash.h"
+#include "LayerElement.h"
+#include "MaterialIndex.h"
+#include "Report.h"
+#include "ReportWriter.h"
+#include "SceneDiff.h"
+#include "Viewer.h"
+
+namespace
+{
+struct MaterialSummary
+{
+    std::string name;
+    uint64_t fingerprint = 0;
+};
+
+struct NormalSummary
+{
+    FbxGeometryElementNormal* element;
+    FbxGeometryElement::EMappingMode mapping;
+    FbxGeometryElement::EReferenceMode reference;
+    // 直接配列とインデックス配列をそのまま混ぜたハッシュ
+    uint64_t hash;
+};
+
+// 比べるのに要るノード一つ分の要約。配列の中身はハッシュだけを持つ
+struct NodeSummary
+{
+    FbxNode* node = nullptr;
+    std::vector<FbxNodeAttribute::EType> types;
+    // 最初のメッシュアトリビュート。無ければnullptr
+    FbxMesh* mesh = nullptr;
+    int control_points = 0;
+    int polygons = 0;
+    int polygon_vertices = 0;
+    std::vector<MaterialSummary> materials;
+    // ポリゴンへのマテリアルの割り当て（最初のマテリアル要素）
+    FbxGeometryElementMaterial* assignment = nullptr;
+    uint64_t assignment_hash = 0;
+    std::vector<NormalSummary> normals;
+};
+
+// 読み込んだシーンと、階層順に並べたノードの要約。シーンはマネージャより先に破棄される
+struct SceneSummary
+{
+    FbxPtr<FbxManager> manager;
+    FbxPtr<FbxScene> scene;
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, NodeSummary> nodes;
+    std::ostringstream err;
+    bool ok = false;
+};
+} // namespace
+
+template <typename T> static void hash_array(Xxh64& hash, FbxLayerElementArrayTemplate<T>& array)
+{
+    LockedArray<T> locked(array);
+    hash.update_value(locked.size());
+    if (locked.get())
+    {
+        hash.update(locked.get(), sizeof(T) * locked.size());
+        return;
+    }
+    for (int i = 0; i < locked.size(); ++i) hash.update_value(array.GetAt(i));
+}
+
+static uint64_t hash_normals(FbxGeometryElementNormal* element)
+{
+    Xxh64 hash;
+    hash_array(hash, element->GetDirectArray());
+    if (element->GetReferenceMode() != FbxGeometryElement::eDirect) hash_array(hash, element->GetIndexArray());
+    return hash.digest();
+}
+
+static void summarize_mesh(FbxMesh* mesh, NodeSummary& summary)
+{
+    summary.mesh = mesh;
+    summary.control_points = mesh->GetControlPointsCount();
+    summary.polygons = mesh->GetPolygonCount();
+    summary.polygon_vertices = mesh->GetPolygonVertexCount();
+
+    for (int i = 0; i < mesh->GetElementNormalCount(); ++i)
+    {
+        auto element = mesh->GetElementNormal(i);
+        if (element) summary.normals.push_back({element, element->GetMappingMode(), element->GetReferenceMode(), hash_normals(element)});
+    }
+
+    summary.assignment = mesh->GetElementMaterial(0);
+    if (summary.assignment)
+    {
+        Xxh64 hash;
+        hash.update_value(summary.assignment->GetMappingMode());
+        hash_array(hash, summary.assignment->GetIndexArray());
+        summary.assignment_hash = hash.digest();
+    }
+
+    auto node = summary.node;
+    std::pmr::vector<std::pmr::string> textures;
+    for (int i = 0; i < node->GetMaterialCount(); ++i)
+    {
+        auto material = node->GetMaterial(i);
+        auto& entry = summary.materials.emplace_back();
+        if (material == nullptr) continue;
+        entry.name = material->GetName();
+        textures.clear();
+        entry.fingerprint = material_fingerprint(material, textures);
+    }
+}
+
+// 同じ名前の兄弟は2番目から"[n]"を付けて区別する
+static void summarize(FbxNode* node, std::string& path, SceneSummary& scene)
+{
+    for (int i = 0; i < node->GetChildCount(); ++i)
+    {
+        auto child = node->GetChild(i);
+        if (child == nullptr) continue;
+
+        size_t length = path.size();
+        path += '/';
+        path += child->GetName();
+        size_t base = path.size();
+        for (int n = 2; scene.nodes.contains(path); ++n)
+        {
+            path.resize(base);
+            path += '[' + std::to_string(n) + ']';
+        }
+
+        auto& summary = scene.nodes[path];
+        summary.node = child;
+        for (int a = 0; a < child->GetNodeAttributeCount(); ++a)
+        {
+            auto attr = child->GetNodeAttributeByIndex(a);
+            if (attr == nullptr) continue;
+            summary.types.push_back(attr->GetAttributeType());
+            if (attr->GetAttributeType() == FbxNodeAttribute::eMesh && summary.mesh == nullptr) summarize_mesh(static_cast<FbxMesh*>(attr), summary);
+        }
+        scene.paths.push_back(path);
+
+        summarize(child, path, scene);
+        path.resize(length);
+    }
+}
+
+static void load(const char* path, SceneSummary& scene)
+{
+    if (scene.manager == nullptr)
+    {
+        scene.err << "Error: Unable to create FBX Manager!" << std::endl;
+        return;
+    }
+    if (!import(scene.manager, path, ImportProfile::Materials, scene.scene, scene.err))
+    {
+        scene.err << "Error: Unable to import " << path << std::endl;
+        return;
+    }
+
+    std::string node_path;
+    if (auto root = scene.scene->GetRootNode()) summarize(root, node_path, scene);
+    scene.ok = true;
+}
+
+namespace
+{
+// 一つのノードの違いを"~ パス: 内容"の形で書き、数を数える
+class ChangeWriter
+{
+public:
+    ChangeWriter(ReportWriter& out, const char* a, const char* b) : out(out), a(a), b(b) {}
+
+    ReportWriter& line(char kind, std::string_view path)
+    {
+        // 違いがあったときだけ見出しを付ける
+        if (changes++ == 0) out << "--- " << a << '\n' << "+++ " << b << '\n';
+        out << kind << ' ' << path;
+        return out;
+    }
+    ReportWriter& change(std::string_view path)
+    {
+        line('~', path);
+        return out << ": ";
+    }
+
+    size_t count() const { return changes; }
+
+private:
+    ReportWriter& out;
+    const char* a;
+    const char* b;
+    size_t changes = 0;
+};
+} // namespace
+
+static void write_types(ReportWriter& out, const std::vector<FbxNodeAttribute::EType>& types)
+{
+    if (types.empty()) out << "none";
+    for (size_t i = 0; i < types.size(); ++i) out << (i ? "," : "") << attribute_type_name(types[i]);
+}
+
+static void diff_normals(std::string_view path, const NodeSummary& a, const NodeSummary& b, ChangeWriter& changes)
+{
+    if (a.normals.size() != b.normals.size()) changes.change(path) << "normal elements " << a.normals.size() << " -> " << b.normals.size() << '\n';
+
+    for (size_t i = 0; i < std::min(a.normals.size(), b.normals.size()); ++i)
+    {
+        const auto& na = a.normals[i];
+        const auto& nb = b.normals[i];
+        if (na.mapping != nb.mapping || na.reference != nb.reference)
+        {
+            changes.change(path) << "normals " << i << " mapping " << mapping_mode_name(na.mapping) << '/' << reference_mode_name(na.reference) << " -> "
+                                 << mapping_mode_name(nb.mapping) << '/' << reference_mode_name(nb.reference) << '\n';
+        }
+        if (na.hash == nb.hash && na.mapping == nb.mapping && na.reference == nb.reference) continue;
+
+        // ハッシュが食い違ったものだけ、ポリゴン頂点の単位に揃えて一つずつ比べる
+        ResolvedElement<FbxVector4> ra, rb;
+        resolve_element(a.mesh, na.element, ra);
+        resolve_element(b.mesh, nb.element, rb);
+        std::pmr::vector<FbxVector4> va(analysis_memory()), vb(analysis_memory());
+        if (a.polygon_vertices != b.polygon_vertices || !expand_to_polygon_vertex(a.mesh, ra, va) || !expand_to_polygon_vertex(b.mesh, rb, vb))
+        {
+            changes.change(path) << "normals " << i << " values changed" << '\n';
+            continue;
+        }
+
+        size_t differing = 0;
+        size_t first = 0;
+        double max_delta = 0;
+        for (size_t v = 0; v < va.size(); ++v)
+        {
+            // NaNは差を測れないが、食い違いとしては数える
+            if (va[v][0] == vb[v][0] && va[v][1] == vb[v][1] && va[v][2] == vb[v][2]) continue;
+            double delta = 0;
+            for (int c = 0; c < 3; ++c) delta = std::max(delta, std::abs(va[v][c] - vb[v][c]));
+            if (differing++ == 0) first = v;
+            max_delta = std::max(max_delta, delta);
+        }
+        if (differing == 0)
+        {
+            if (na.mapping == nb.mapping && na.reference == nb.reference) changes.change(path) << "normals " << i << " stored differently, same values" << '\n';
+            continue;
+        }
+        changes.change(path) << "normals " << i << ' ' << differing << " of " << va.size() << " polygon vertices differ (first " << first << ", max delta " << max_delta << ")" << '\n';
+    }
+}
+
+static bool per_polygon(const ResolvedElement<int>& resolved)
+{
+    return resolved.mapping == FbxGeometryElement::eByPolygon || resolved.mapping == FbxGeometryElement::eAllSame;
+}
+
+// 全体が一つのマテリアルなら、どのポリゴンも同じ番号として扱う
+static int polygon_material(const ResolvedElement<int>& resolved, int pi)
+{
+    if (resolved.mapping == FbxGeometryElement::eAllSame) return resolved.values.empty() ? -1 : resolved.values[0];
+    return pi < static_cast<int>(resolved.values.size()) ? resolved.values[pi] : -1;
+}
+
+static void diff_materials(std::string_view path, const NodeSummary& a, const NodeSummary& b, ChangeWriter& changes)
+{
+    if (a.materials.size() != b.materials.size()) changes.change(path) << "material slots " << a.materials.size() << " -> " << b.materials.size() << '\n';
+
+    for (size_t i = 0; i < std::min(a.materials.size(), b.materials.size()); ++i)
+    {
+        const auto& ma = a.materials[i];
+        const auto& mb = b.materials[i];
+        if (ma.name != mb.name)
+        {
+            changes.change(path) << "material " << i << " \"" << ma.name << "\" -> \"" << mb.name << "\"" << (ma.fingerprint != mb.fingerprint ? ", properties changed" : "") << '\n';
+        } else if (ma.fingerprint != mb.fingerprint)
+        {
+            changes.change(path) << "material " << i << " \"" << ma.name << "\" properties changed" << '\n';
+        }
+    }
+
+    if ((a.assignment == nullptr) != (b.assignment == nullptr))
+    {
+        changes.change(path) << "material assignment " << (a.assignment ? "removed" : "added") << '\n';
+        return;
+    }
+    if (a.assignment == nullptr || a.assignment_hash == b.assignment_hash) return;
+
+    ResolvedElement<int> ra, rb;
+    resolve_material_indices(a.mesh, a.assignment, ra);
+    resolve_material_indices(b.mesh, b.assignment, rb);
+    if (!per_polygon(ra) || !per_polygon(rb) || a.polygons != b.polygons)
+    {
+        changes.change(path) << "material assignment changed" << '\n';
+        return;
+    }
+
+    int differing = 0;
+    int first = 0;
+    for (int pi = 0; pi < a.polygons; ++pi)
+    {
+        if (polygon_material(ra, pi) == polygon_material(rb, pi)) continue;
+        if (differing++ == 0) first = pi;
+    }
+    if (differing) changes.change(path) << "material assignment " << differing << " of " << a.polygons << " polygons differ (first " << first << ")" << '\n';
+}
+
+static void diff_nodes(std::string_view path, const NodeSummary& a, const NodeSummary& b, ChangeWriter& changes)
+{
+    if (a.types != b.types)
+    {
+        auto& out = changes.change(path) << "attributes ";
+        write_types(out, a.types);
+        out << " -> ";
+        write_types(out, b.types);
+        out << '\n';
+    }
+    if (a.mesh == nullptr || b.mesh == nullptr) return;
+
+    if (a.control_points != b.control_points || a.polygons != b.polygons || a.polygon_vertices != b.polygon_vertices)
+    {
+        changes.change(path) << "mesh " << a.control_points << " points, " << a.polygons << " polygons, " << a.polygon_vertices << " polygon vertices -> " << b.control_points << " points, "
+                             << b.polygons << " polygons, " << b.polygon_vertices << " polygon vertices" << '\n';
+    }
+    diff_materials(path, a, b, changes);
+    diff_normals(path, a, b, changes);
+}
+
+int diff_scenes(const char* a, const char* b, ReportWriter& out, std::ostream& err)
+{
+    // FbxManagerの生成はSDK内部の初期化を伴うので、スレッドを分ける前に順に作る
+    SceneSummary sa, sb;
+    sa.manager.reset(FbxManager::Create());
+    sb.manager.reset(FbxManager::Create());
+
+    // 読み込みと配列のハッシュはファイルごとに独立しているので、片方を別のスレッドで進める
+    {
+        std::jthread other([&] { load(b, sb); });
+        load(a, sa);
+    }
+    err << sa.err.str() << sb.err.str();
+    if (!sa.ok || !sb.ok) return 2;
+
+    // aの階層順に比べ、bにしか無いノードは最後にbの階層順で並べる
+    ChangeWriter changes(out, a, b);
+    for (const auto& path : sa.paths)
+    {
+        auto found = sb.nodes.find(path);
+        if (found == sb.nodes.end())
+        {
+            changes.line('-', path) << '\n';
+            continue;
+        }
+        diff_nodes(path, sa.nodes[path], found->second, changes);
+    }
+    for (const auto& path : sb.paths)
+    {
+        if (!sa.nodes.contains(path)) changes.line('+', path) << '\n';
+    }
+    out.flush();
+
+    err << "Compared " << sa.paths.size() << " and " << sb.paths.size() << " nodes, " << changes.count() << " changes" << std::endl;
+    return changes.count() == 0 ? 0 : 1;
+}
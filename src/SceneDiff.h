@@ -0,0 +1,9 @@
+﻿#pragma once
+#include <iosfwd>
+
+class ReportWriter;
+
+// 二つのファイルを別々のスレッドで読み込み、階層のパスで対応させたノードの違いを一行ずつ書く。
+// 配列はまず丸ごとのハッシュで比べ、食い違ったものだけ要素ごとに辿る。
+// diff(1)と同じく、違いが無ければ0、あれば1、読み込めなければ2を返す
+int diff_scenes(const char* a, const char* b, ReportWriter& out, std::ostream& err);
@@ -0,0 +1,484 @@
+﻿#include <fbxsdk.h>
+#include <ostream>
+#include "Server.h"
+
+#if defined(_WIN32)
+
+int run_server(const ServerOptions&, std::ostream& err)
+{
+    err << "Error: --serve is only available on POSIX systems" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "FbxPtr.h"
+#include "ImportProfile.h"
+#include "Query.h"
+#include "ReportWriter.h"
+#include "Viewer.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// ワーカー一つ分の温めたマネージャ。
+// FbxManagerはスレッド安全ではないので、そのマネージャのシーンの読み込み、読み出し、破棄はこのロックの下で行う
+struct WarmManager
+{
+    std::mutex mutex;
+    FbxPtr<FbxManager> manager;
+};
+
+// 読み込み済みのシーン。最後の参照が外れたときに持ち主のマネージャのロックを取って破棄する
+struct CachedScene
+{
+    CachedScene(WarmManager& owner, FbxPtr<FbxScene> scene, ImportProfile profile) : owner(owner), scene(std::move(scene)), profile(profile) {}
+    ~CachedScene()
+    {
+        std::lock_guard lock(owner.mutex);
+        scene.reset();
+    }
+
+    WarmManager& owner;
+    FbxPtr<FbxScene> scene;
+    ImportProfile profile;
+};
+
+// 読み込み時のプロファイルが、求められたプロファイルの内容を全部含んでいるか
+bool covers(ImportProfile have, ImportProfile want)
+{
+    if (have == ImportProfile::Full || have == ImportProfile::Auto) return true;
+    if (want == ImportProfile::Full || want == ImportProfile::Auto) return false;
+    return have == ImportProfile::Materials || want == ImportProfile::Normals;
+}
+
+// パスごとに最新のシーンを一つだけ持つLRU。ファイルの更新時刻かサイズが変わったものは使わない
+class SceneCache
+{
+public:
+    explicit SceneCache(size_t capacity) : capacity(capacity) {}
+
+    std::shared_ptr<CachedScene> find(const std::string& path, int64_t mtime, uintmax_t size, ImportProfile profile)
+    {
+        std::lock_guard lock(mutex);
+        auto found = entries.find(path);
+        if (found == entries.end()) return nullptr;
+        auto& entry = *found->second;
+        if (entry.mtime != mtime || entry.size != size || !covers(entry.scene->profile, profile)) return nullptr;
+        order.splice(order.begin(), order, found->second);
+        return entry.scene;
+    }
+
+    void insert(const std::string& path, int64_t mtime, uintmax_t size, std::shared_ptr<CachedScene> scene)
+    {
+        // 追い出したシーンの破棄はマネージャのロックを取るので、キャッシュのロックの外で行う
+        std::vector<std::shared_ptr<CachedScene>> evicted;
+        {
+            std::lock_guard lock(mutex);
+            if (capacity == 0) return;
+            auto found = entries.find(path);
+            if (found != entries.end())
+            {
+                evicted.push_back(std::move(found->second->scene));
+                order.erase(found->second);
+                entries.erase(found);
+            }
+            order.push_front({path, mtime, size, std::move(scene)});
+            entries.emplace(path, order.begin());
+            while (order.size() > capacity)
+            {
+                evicted.push_back(std::move(order.back().scene));
+                entries.erase(order.back().path);
+                order.pop_back();
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        std::string path;
+        int64_t mtime;
+        uintmax_t size;
+        std::shared_ptr<CachedScene> scene;
+    };
+
+    size_t capacity;
+    std::mutex mutex;
+    std::list<Entry> order;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+};
+
+// 1回の要求。queryはoptions.viewer.queryから指される
+struct Request
+{
+    std::string path;
+    ViewerOptions viewer;
+    Query query;
+};
+
+template <typename T> bool parse_number(std::string_view text, T& value)
+{
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool parse_option(std::string_view field, Request& request, std::ostream& err)
+{
+    auto separator = field.find('=');
+    auto name = field.substr(0, separator);
+    auto value = separator == std::string_view::npos ? std::string_view() : field.substr(separator + 1);
+    auto& viewer = request.viewer;
+
+    bool valid = true;
+    if (name == "--format")
+    {
+        valid = parse_report_format(value, viewer.format);
+    } else if (name == "--only")
+    {
+        valid = value == "normals" || value == "materials";
+        viewer.normals = value == "normals";
+        viewer.materials = value == "materials";
+    } else if (name == "--select")
+    {
+        QuerySelection selection;
+        valid = parse_query_selection(value, selection);
+        viewer.names = selection.names;
+        viewer.normals = selection.normals;
+        viewer.materials = selection.materials;
+        viewer.mesh_statistics = selection.statistics;
+    } else if (name == "--where")
+    {
+        std::string error;
+        if (!request.query.parse(value, error))
+        {
+            err << "Error: Invalid --where expression: " << error << std::endl;
+            return false;
+        }
+        viewer.query = &request.query;
+    } else if (name == "--import-profile")
+    {
+        valid = parse_import_profile(value, viewer.profile);
+    } else if (name == "--dedup-materials")
+    {
+        viewer.dedup_materials = true;
+    } else if (name == "--stats-mesh")
+    {
+        viewer.mesh_statistics = true;
+    } else if (name == "--validate")
+    {
+        viewer.validate = true;
+    } else if (name == "--compare-normals")
+    {
+        valid = parse_normal_weighting(value, viewer.weighting);
+        viewer.compare_normals = true;
+    } else if (name == "--tolerance")
+    {
+        valid = parse_number(value, viewer.check.tolerance) && viewer.check.tolerance >= 0;
+    } else if (name == "--max-offenders")
+    {
+        valid = parse_number(value, viewer.check.max_offenders) && viewer.check.max_offenders >= 0;
+    } else
+    {
+        err << "Error: Unsupported option " << field << std::endl;
+        return false;
+    }
+    if (!valid) err << "Error: Invalid option " << field << std::endl;
+    return valid;
+}
+
+bool parse_request(std::string_view line, Request& request, std::ostream& err)
+{
+    std::vector<std::string_view> fields;
+    for (size_t begin = 0; begin <= line.size();)
+    {
+        size_t end = std::min(line.find('\t', begin), line.size());
+        fields.push_back(line.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    if (fields.back().empty())
+    {
+        err << "Error: Request has no path" << std::endl;
+        return false;
+    }
+
+    request.path = fields.back();
+    for (size_t i = 0; i + 1 < fields.size(); ++i)
+    {
+        if (!parse_option(fields[i], request, err)) return false;
+    }
+    if (request.viewer.profile == ImportProfile::Normals && (request.viewer.materials || request.viewer.mesh_statistics))
+    {
+        err << "Error: --import-profile=normals drops materials; use it with --only=normals and without --stats-mesh" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 要求の1行を読み終えるまでの時間と、応答を書くときに1回の書き込みを待つ時間の上限。
+// 何も送らない、あるいは読まない接続にワーカーを取られたままにしない
+constexpr auto request_timeout = std::chrono::seconds(10);
+
+// 改行か、クライアントが書き込みを閉じるまでを読む。長すぎる要求や空の要求、時間切れはfalse
+bool read_line(int fd, std::string& line)
+{
+    constexpr size_t max_request = 64 * 1024;
+    // 少しずつ送って引き延ばす接続も切れるよう、1行全体に期限を設ける
+    auto deadline = std::chrono::steady_clock::now() + request_timeout;
+    char buffer[4096];
+    for (;;)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) return false;
+        pollfd ready{fd, POLLIN, 0};
+        int polled = ::poll(&ready, 1, static_cast<int>(remaining));
+        if (polled < 0 && errno == EINTR) continue;
+        if (polled <= 0) return false;
+
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) break;
+        std::string_view chunk(buffer, static_cast<size_t>(n));
+        auto newline = chunk.find('\n');
+        line.append(chunk.substr(0, newline));
+        // 改行より後ろは無視する。1接続につき1要求
+        if (newline != std::string_view::npos) break;
+        if (line.size() > max_request) return false;
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return !line.empty();
+}
+
+class Server
+{
+public:
+    Server(const ServerOptions& options, std::ostream& log) : log(log), scenes(options.scene_cache)
+    {
+        unsigned jobs = options.jobs != 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+        // マネージャとIOSettingsは起動時に作っておき、要求ごとの初期化を無くす
+        managers.resize(jobs);
+        for (auto& warm : managers)
+        {
+            warm = std::make_unique<WarmManager>();
+            warm->manager.reset(FbxManager::Create());
+            if (warm->manager) warm->manager->SetIOSettings(FbxIOSettings::Create(warm->manager.get(), IOSROOT));
+        }
+    }
+
+    ~Server()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        workers.clear();
+    }
+
+    void start()
+    {
+        for (auto& warm : managers) workers.emplace_back([this, &warm] { work(*warm); });
+    }
+
+    void submit(int fd)
+    {
+        {
+            std::lock_guard lock(mutex);
+            connections.push_back(fd);
+        }
+        queue_cv.notify_one();
+    }
+
+private:
+    void work(WarmManager& warm)
+    {
+        // 解析の一時的な確保は要求ごとに巻き戻すアリーナから取る。シーンはキャッシュが持つので使わない
+        Workspace workspace;
+        for (;;)
+        {
+            int fd;
+            {
+                std::unique_lock lock(mutex);
+                queue_cv.wait(lock, [&] { return stopping || !connections.empty(); });
+                if (connections.empty()) return;
+                fd = connections.front();
+                connections.pop_front();
+            }
+            serve(warm, workspace, fd);
+            workspace.arena.reset();
+        }
+    }
+
+    std::shared_ptr<CachedScene> acquire(WarmManager& warm, const Request& request, bool& cached, std::ostream& err)
+    {
+        ImportProfile profile = select_import_profile(request.viewer);
+
+        std::error_code ec;
+        auto mtime = static_cast<int64_t>(fs::last_write_time(request.path, ec).time_since_epoch().count());
+        auto size = ec ? 0 : fs::file_size(request.path, ec);
+        if (ec)
+        {
+            err << "Error: Unable to open " << request.path << std::endl;
+            return nullptr;
+        }
+
+        cached = true;
+        if (auto scene = scenes.find(request.path, mtime, size, profile)) return scene;
+        cached = false;
+
+        FbxPtr<FbxScene> scene;
+        {
+            std::lock_guard lock(warm.mutex);
+            if (!import(warm.manager, request.path.c_str(), profile, scene, err))
+            {
+                err << "Error: Unable to import FBX file!" << std::endl;
+                scene.reset();
+                return nullptr;
+            }
+        }
+        auto entry = std::make_shared<CachedScene>(warm, std::move(scene), profile);
+        scenes.insert(request.path, mtime, size, entry);
+        return entry;
+    }
+
+    void serve(WarmManager& warm, Workspace& workspace, int fd)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string line;
+        if (!read_line(fd, line))
+        {
+            ::close(fd);
+            return;
+        }
+
+        std::FILE* stream = fdopen(fd, "w");
+        if (stream == nullptr)
+        {
+            ::close(fd);
+            return;
+        }
+
+        std::ostringstream err;
+        bool ok = false;
+        bool cached = false;
+        {
+            ReportWriter out(stream, 64 * 1024, &workspace.arena);
+            Request request;
+            try
+            {
+                if (parse_request(line, request, err))
+                {
+                    // シーンへの参照はロックより長く持ち、破棄がロックの中で起きないようにする
+                    auto scene = acquire(warm, request, cached, err);
+                    if (scene)
+                    {
+                        std::lock_guard lock(scene->owner.mutex);
+                        request.viewer.scene = scene->scene.get();
+                        request.viewer.workspace = &workspace;
+                        ok = inspect(scene->owner.manager, request.path.c_str(), request.viewer, out, err);
+                    }
+                }
+            } catch (const std::exception& e)
+            {
+                err << "Error: " << e.what() << std::endl;
+                ok = false;
+            }
+            out << '\0' << (ok ? "ok" : "failed") << '\n' << err.str();
+        }
+        std::fclose(stream);
+
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard lock(log_mutex);
+        log << (ok ? "Served " : "Failed ") << line << (cached ? " (cached scene)" : "") << " in " << ms << " ms" << std::endl;
+    }
+
+    std::ostream& log;
+    std::mutex log_mutex;
+    // キャッシュのシーンは破棄にマネージャを使うので、マネージャより後に宣言して先に破棄する
+    std::vector<std::unique_ptr<WarmManager>> managers;
+    SceneCache scenes;
+
+    std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::deque<int> connections;
+    bool stopping = false;
+    // シーンを触るワーカーはキャッシュとマネージャより先に止める
+    std::vector<std::jthread> workers;
+};
+} // namespace
+
+int run_server(const ServerOptions& options, std::ostream& err)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socket_path.empty() || options.socket_path.size() >= sizeof(address.sun_path))
+    {
+        err << "Error: Invalid socket path " << options.socket_path << std::endl;
+        return 1;
+    }
+    options.socket_path.copy(address.sun_path, options.socket_path.size());
+
+    // 途中で切った接続へ書いてもプロセスごと落ちないようにする
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        err << "Error: Unable to create a socket" << std::endl;
+        return 1;
+    }
+    ::unlink(options.socket_path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        err << "Error: Unable to listen on " << options.socket_path << std::endl;
+        ::close(listener);
+        return 1;
+    }
+
+    Server server(options, err);
+    server.start();
+    err << "Listening on " << options.socket_path << std::endl;
+    for (;;)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd >= 0)
+        {
+            timeval timeout{static_cast<time_t>(request_timeout.count()), 0};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            server.submit(fd);
+        }
+        else if (errno != EINTR && errno != ECONNABORTED) break;
+    }
+
+    err << "Error: Unable to accept connections on " << options.socket_path << std::endl;
+    ::close(listener);
+    ::unlink(options.socket_path.c_str());
+    return 1;
+}
+
+#endif
@@ -0,0 +1,22 @@
+﻿#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+struct ServerOptions
+{
+    // 要求を待つUnixドメインソケットのパス。残っていたファイルは作り直す
+    std::string socket_path;
+    // 要求を並行して処理するワーカー数。0ならハードウェアのスレッド数に合わせる
+    unsigned jobs = 0;
+    // 読み込み済みのまま取っておくシーンの数。0なら毎回読み込む
+    size_t scene_cache = 8;
+};
+
+// 温めたFbxManagerを持つワーカーで、ソケットから来た要求を終了させられるまで処理し続ける。
+// 要求は接続ごとに1行で、タブ区切りの"--name=value"形式のオプションの後に最後の欄としてパスを置く。
+// 応答はレポートをそのまま流し、最後にNUL、"ok"か"failed"の行、警告やエラーの順に書いて接続を閉じる。
+// 受け付けるオプションは--format、--only、--select、--where、--dedup-materials、--stats-mesh、
+// --validate、--compare-normals、--tolerance、--max-offenders、--import-profile。
+// シーンはパスと更新時刻、サイズで引くLRUに残し、同じファイルへの要求では読み込みを省く
+int run_server(const ServerOptions& options, std::ostream& err);
@@ -0,0 +1,76 @@
+﻿#include <cstdio>
+#include <ostream>
+#include "ProcessMemory.h"
+#include "Stats.h"
+
+static thread_local Stats* current = nullptr;
+
+void StatTotals::add(const StatTotals& other)
+{
+    for (int i = 0; i < stat_phase_count; ++i) nanoseconds[i] += other.nanoseconds[i];
+    for (int i = 0; i < stat_counter_count; ++i) counts[i] += other.counts[i];
+    if (other.peak_memory > peak_memory) peak_memory = other.peak_memory;
+}
+
+StatTotals Stats::totals() const
+{
+    StatTotals result;
+    for (int i = 0; i < stat_phase_count; ++i) result.nanoseconds[i] = times[i].load(std::memory_order_relaxed);
+    for (int i = 0; i < stat_counter_count; ++i) result.counts[i] = counts[i].load(std::memory_order_relaxed);
+    result.peak_memory = peak_resident_memory();
+    return result;
+}
+
+Stats* current_stats() { return current; }
+
+Stats* set_current_stats(Stats* stats)
+{
+    auto previous = current;
+    current = stats;
+    return previous;
+}
+
+static const char* phase_name(StatPhase phase)
+{
+    switch (phase)
+    {
+    case StatPhase::Total: return "total";
+    case StatPhase::Prefetch: return "prefetch";
+    case StatPhase::Initialize: return "initialize";
+    case StatPhase::Import: return "import";
+    case StatPhase::Traversal: return "traversal";
+    case StatPhase::Normals: return "normals";
+    case StatPhase::Geometry: return "geometry";
+    case StatPhase::Materials: return "materials";
+    case StatPhase::Dump: return "dump";
+    case StatPhase::Cache: return "cache";
+    case StatPhase::Output: return "output";
+    case StatPhase::Count: break;
+    }
+    return "unknown";
+}
+
+void write_stats(std::ostream& out, const char* title, const StatTotals& totals)
+{
+    char line[128];
+    out << "Stats: " << title << '\n';
+
+    double total = static_cast<double>(totals.nanoseconds[static_cast<int>(StatPhase::Total)]);
+    for (int i = 0; i < stat_phase_count; ++i)
+    {
+        double ms = totals.nanoseconds[i] / 1e6;
+        double share = total > 0 ? 100.0 * totals.nanoseconds[i] / total : 0.0;
+        std::snprintf(line, sizeof(line), "    %-12s %12.3f ms %6.1f%%", phase_name(static_cast<StatPhase>(i)), ms, share);
+        out << line << '\n';
+    }
+
+    auto count = [&](StatCounter counter) { return static_cast<unsigned long long>(totals.counts[static_cast<int>(counter)]); };
+    std::snprintf(line, sizeof(line), "    nodes %llu, meshes %llu, normals %llu, materials %llu", count(StatCounter::Nodes), count(StatCounter::Meshes), count(StatCounter::Normals),
+                  count(StatCounter::Materials));
+    out << line << '\n';
+    std::snprintf(line, sizeof(line), "    arena %.1f KiB in %llu allocations", count(StatCounter::ArenaBytes) / 1024.0, count(StatCounter::ArenaAllocations));
+    out << line << '\n';
+    std::snprintf(line, sizeof(line), "    prefetched %.1f KiB, output %.1f KiB, peak memory %.1f MiB", count(StatCounter::PrefetchBytes) / 1024.0, count(StatCounter::OutputBytes) / 1024.0,
+                  totals.peak_memory / (1024.0 * 1024.0));
+    out << line << std::endl;
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// 0にするとFBXAV_STATS_*のマクロが空になり、計測のコードは一切残らない
+#ifndef FBXAV_STATS
+#define FBXAV_STATS 0
+#endif
+
+// 時間を測る段階
+enum class StatPhase
+{
+    Total,      // 1ファイル全体。他の段階の合計より少し大きい
+    Prefetch,   // 先読みしているファイルの中身が揃うのを待った時間
+    Initialize, // FbxImporter::Initialize
+    Import,     // FbxImporter::Import
+    Traversal,  // ノード階層を辿る部分
+    Normals,    // 法線の読み出しや検査と、そのレポート
+    Geometry,   // --stats-meshの集計と、そのレポート
+    Materials,  // マテリアルとバインディングテーブルの読み出しと、そのレポート
+    Dump,       // --dump-normalsの書き出し
+    Cache,      // キャッシュのハッシュ計算と読み書き
+    Output,     // 標準出力などへの書き出し
+    Count,
+};
+
+enum class StatCounter
+{
+    Nodes,
+    Meshes,
+    Normals,
+    Materials,
+    OutputBytes,
+    ArenaBytes,       // アリーナから確保したバイト数
+    ArenaAllocations, // アリーナから確保した回数
+    PrefetchBytes,    // メモリに先読みしたファイルのバイト数
+    Count,
+};
+
+constexpr int stat_phase_count = static_cast<int>(StatPhase::Count);
+constexpr int stat_counter_count = static_cast<int>(StatCounter::Count);
+
+// 集計済みの値。ファイルごとの結果や全体の合計として持ち回る
+struct StatTotals
+{
+    uint64_t nanoseconds[stat_phase_count] = {};
+    uint64_t counts[stat_counter_count] = {};
+    // 計測した時点までのプロセス全体の最大常駐メモリ
+    size_t peak_memory = 0;
+
+    void add(const StatTotals& other);
+};
+
+// 計測中の値。メッシュを並列に解析するときは複数のスレッドから同時に足される
+class Stats
+{
+public:
+    void add_time(StatPhase phase, uint64_t nanoseconds) { times[static_cast<int>(phase)].fetch_add(nanoseconds, std::memory_order_relaxed); }
+    void add_count(StatCounter counter, uint64_t n) { counts[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed); }
+
+    // 今の値にピークメモリを添えて返す
+    StatTotals totals() const;
+
+private:
+    std::atomic<uint64_t> times[stat_phase_count] = {};
+    std::atomic<uint64_t> counts[stat_counter_count] = {};
+};
+
+// このスレッドで計測した値を足す先。nullptrなら何も測らない
+Stats* current_stats();
+Stats* set_current_stats(Stats* stats);
+
+// スコープの間だけ足し先を差し替える
+class ScopedStats
+{
+public:
+    explicit ScopedStats(Stats* stats) : previous(set_current_stats(stats)) {}
+    ~ScopedStats() { set_current_stats(previous); }
+
+    ScopedStats(const ScopedStats&) = delete;
+    ScopedStats& operator=(const ScopedStats&) = delete;
+
+private:
+    Stats* previous;
+};
+
+// スコープの時間をphaseに足す。足し先が無ければ時計も読まない
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(StatPhase phase) : stats(current_stats()), phase(phase)
+    {
+        if (stats) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedPhase()
+    {
+        if (stats) stats->add_time(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    Stats* stats;
+    StatPhase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline void count_stat(StatCounter counter, uint64_t n)
+{
+    if (auto stats = current_stats()) stats->add_count(counter, n);
+}
+
+// 段階ごとの内訳を人が読む形で書く
+void write_stats(std::ostream& out, const char* title, const StatTotals& totals);
+
+#define FBXAV_STATS_CONCAT_(a, b) a##b
+#define FBXAV_STATS_CONCAT(a, b) FBXAV_STATS_CONCAT_(a, b)
+
+#if FBXAV_STATS
+#define FBXAV_STATS_SCOPE(phase) ScopedPhase FBXAV_STATS_CONCAT(stats_scope_, __LINE__)(StatPhase::phase)
+#define FBXAV_STATS_COUNT(counter, n) count_stat(StatCounter::counter, (n))
+#else
+#define FBXAV_STATS_SCOPE(phase) ((void)0)
+#define FBXAV_STATS_COUNT(counter, n) ((void)0)
+#endif
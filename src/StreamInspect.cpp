@@ -0,0 +1,748 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "DisplayCommon.h"
+#include "FbxBinaryReader.h"
+#include "GeometryArrays.h"
+#include "LayerElement.h"
+#include "NormalValidation.h"
+#include "ReportWriter.h"
+#include "Stats.h"
+#include "StreamInspect.h"
+#include "TextReport.h"
+#include "Viewer.h"
+
+namespace
+{
+enum class ObjectKind
+{
+    Model,
+    Attribute,
+    Geometry,
+    Material,
+    Implementation,
+};
+
+// Objectsの下のオブジェクト一つ分。中身はレコードの位置だけを覚えておき、出力するときに読み直す
+struct StreamObject
+{
+    ObjectKind kind;
+    FbxRecord record;
+    std::string_view name;
+    std::string_view subclass;
+};
+
+// マテリアルのプロパティ。クラスの既定値にPropertyTemplate、オブジェクト自身の値の順に重ねる
+struct MaterialValues
+{
+    double ambient[3] = {0.2, 0.2, 0.2};
+    double diffuse[3] = {0.8, 0.8, 0.8};
+    double specular[3] = {0.2, 0.2, 0.2};
+    double emissive[3] = {0.0, 0.0, 0.0};
+    double transparency = 0.0;
+    double shininess = 20.0;
+    double reflection = 1.0;
+    std::string_view shading_model;
+};
+
+// レポートに要る分だけのシーンの索引。配列の中身は含まない
+struct StreamScene
+{
+    std::unordered_map<int64_t, StreamObject> objects;
+    // モデルのIDごとの子モデル・アトリビュート・マテリアル（接続の順）。ルートはID 0
+    std::unordered_map<int64_t, std::vector<int64_t>> children;
+    std::unordered_map<int64_t, std::vector<int64_t>> attributes;
+    std::unordered_map<int64_t, std::vector<int64_t>> materials;
+    // ジオメトリが最初に繋がったモデル（FbxMesh::GetNode()が返すもの）
+    std::unordered_map<int64_t, int64_t> owners;
+    // ハードウェアシェーダの実装が繋がったマテリアル
+    std::unordered_set<int64_t> shaded;
+    MaterialValues phong;
+    MaterialValues lambert;
+};
+
+// 配列プロパティを作業用バッファ一つ分ずつ読みながら、先頭から一要素ずつ返す
+template <typename T> class ArrayCursor
+{
+public:
+    bool open(const FbxRecordValue& value, std::ostream& err)
+    {
+        position = size = 0;
+        return array.open(value, err);
+    }
+
+    bool next(T& value)
+    {
+        if (position == size)
+        {
+            size = array.read(buffer.data(), buffer.size());
+            position = 0;
+            if (size == 0) return false;
+        }
+        value = buffer[position++];
+        return true;
+    }
+
+    FbxArrayReader& reader() { return array; }
+
+private:
+    FbxArrayReader array;
+    std::array<T, 4096> buffer;
+    size_t position = 0;
+    size_t size = 0;
+};
+
+// 法線をマッピングの単位の順に一つずつ取り出す。インデックス参照なら値の配列だけを先に展開しておく
+class NormalCursor
+{
+public:
+    bool open(const FbxRecordValue& normals, const FbxRecordValue* index, std::ostream& err)
+    {
+        indexed = index != nullptr;
+        if (!indexed) return values.open(normals, err);
+
+        // 展開済みならそのバッファを直接引き、圧縮されたままならここで一度だけ展開する
+        direct = normals;
+        if (normals.compressed)
+        {
+            FbxArrayReader reader;
+            expanded.clear();
+            if (!reader.open(normals, err) || !reader.read_all(expanded))
+            {
+                err << "Error: Unable to decompress the Normals array" << std::endl;
+                return false;
+            }
+            direct.type = 'd';
+            direct.data = reinterpret_cast<const uint8_t*>(expanded.data());
+            direct.count = static_cast<uint32_t>(expanded.size());
+            direct.size = expanded.size() * sizeof(double);
+            direct.compressed = false;
+        }
+        return indices.open(*index, err);
+    }
+
+    // 足りない分や範囲外のインデックスはresolve_element()と同じくゼロにする
+    FbxVector4 next()
+    {
+        FbxVector4 normal(0, 0, 0);
+        if (indexed)
+        {
+            int ni = -1;
+            if (indices.next(ni) && ni >= 0 && static_cast<size_t>(ni) < direct.count / 3)
+            {
+                for (int c = 0; c < 3; ++c) normal[c] = direct.double_at(static_cast<size_t>(ni) * 3 + c);
+            }
+            return normal;
+        }
+        double x, y, z;
+        if (values.next(x) && values.next(y) && values.next(z)) normal = FbxVector4(x, y, z);
+        return normal;
+    }
+
+private:
+    ArrayCursor<double> values;
+    ArrayCursor<int> indices;
+    bool indexed = false;
+    FbxRecordValue direct;
+    std::vector<double> expanded;
+};
+} // namespace
+
+static bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+static void read_color(const FbxRecordValue* values, int count, double* color)
+{
+    if (count < 7) return;
+    for (int c = 0; c < 3; ++c) color[c] = values[4 + c].as_double();
+}
+
+// Properties70の"P"レコード（名前・型・ラベル・フラグ・値…）からマテリアルのプロパティを拾う
+static void read_material_properties(FbxBinaryReader& reader, const FbxRecord& parent, MaterialValues& material)
+{
+    FbxRecord properties;
+    if (!reader.find(&parent, "Properties70", properties)) return;
+
+    FbxRecord p;
+    FbxRecordValue values[7];
+    for (bool ok = reader.first_child(properties, p); ok; ok = reader.next(p, &properties, p))
+    {
+        if (p.name != "P") continue;
+        int count = reader.values(p, values, 7);
+        if (count < 5) continue;
+        auto name = values[0].as_string();
+        if (name == "AmbientColor") read_color(values, count, material.ambient);
+        else if (name == "DiffuseColor") read_color(values, count, material.diffuse);
+        else if (name == "SpecularColor") read_color(values, count, material.specular);
+        else if (name == "EmissiveColor") read_color(values, count, material.emissive);
+        else if (name == "TransparencyFactor") material.transparency = values[4].as_double();
+        else if (name == "ShininessExponent") material.shininess = values[4].as_double();
+        else if (name == "ReflectionFactor") material.reflection = values[4].as_double();
+        else if (name == "ShadingModel") material.shading_model = values[4].as_string();
+    }
+}
+
+// DefinitionsにあるPhong/LambertのPropertyTemplateを既定値として読む
+static void read_material_templates(FbxBinaryReader& reader, StreamScene& scene)
+{
+    scene.phong.shading_model = "Phong";
+    scene.lambert.shading_model = "Lambert";
+
+    FbxRecord definitions;
+    if (!reader.find(nullptr, "Definitions", definitions)) return;
+
+    FbxRecord type;
+    FbxRecordValue value;
+    for (bool ok = reader.first_child(definitions, type); ok; ok = reader.next(type, &definitions, type))
+    {
+        if (type.name != "ObjectType" || reader.values(type, &value, 1) < 1 || value.as_string() != "Material") continue;
+        FbxRecord property_template;
+        for (bool found = reader.first_child(type, property_template); found; found = reader.next(property_template, &type, property_template))
+        {
+            if (property_template.name != "PropertyTemplate" || reader.values(property_template, &value, 1) < 1) continue;
+            if (value.as_string() == "FbxSurfacePhong") read_material_properties(reader, property_template, scene.phong);
+            else if (value.as_string() == "FbxSurfaceLambert") read_material_properties(reader, property_template, scene.lambert);
+        }
+    }
+}
+
+// オブジェクトの一覧と接続だけを読んで索引を作る。ジオメトリの配列には触れない
+static bool index_scene(FbxBinaryReader& reader, StreamScene& scene, std::ostream& err)
+{
+    FbxRecord objects;
+    if (!reader.find(nullptr, "Objects", objects))
+    {
+        if (!reader.failed()) err << "Error: FBX file has no Objects section" << std::endl;
+        return false;
+    }
+
+    FbxRecord record;
+    FbxRecordValue values[3];
+    for (bool ok = reader.first_child(objects, record); ok; ok = reader.next(record, &objects, record))
+    {
+        ObjectKind kind;
+        if (record.name == "Model") kind = ObjectKind::Model;
+        else if (record.name == "NodeAttribute") kind = ObjectKind::Attribute;
+        else if (record.name == "Geometry") kind = ObjectKind::Geometry;
+        else if (record.name == "Material") kind = ObjectKind::Material;
+        else if (record.name == "Implementation") kind = ObjectKind::Implementation;
+        else continue;
+        if (reader.values(record, values, 3) < 3) continue;
+        scene.objects[values[0].as_int()] = {kind, record, fbx_object_name(values[1].as_string()), values[2].as_string()};
+    }
+
+    FbxRecord connections;
+    if (reader.find(nullptr, "Connections", connections))
+    {
+        for (bool ok = reader.first_child(connections, record); ok; ok = reader.next(record, &connections, record))
+        {
+            if (record.name != "C" || reader.values(record, values, 3) < 3 || values[0].as_string() != "OO") continue;
+            int64_t src = values[1].as_int();
+            int64_t dst = values[2].as_int();
+            auto source = scene.objects.find(src);
+            if (source == scene.objects.end()) continue;
+            auto target = scene.objects.find(dst);
+            bool to_model = target != scene.objects.end() && target->second.kind == ObjectKind::Model;
+            switch (source->second.kind)
+            {
+            case ObjectKind::Model:
+                if (dst == 0 || to_model) scene.children[dst].push_back(src);
+                break;
+            case ObjectKind::Attribute:
+            case ObjectKind::Geometry:
+                if (!to_model) break;
+                scene.attributes[dst].push_back(src);
+                scene.owners.try_emplace(src, dst);
+                break;
+            case ObjectKind::Material:
+                if (to_model) scene.materials[dst].push_back(src);
+                break;
+            case ObjectKind::Implementation:
+                if (target != scene.objects.end() && target->second.kind == ObjectKind::Material) scene.shaded.insert(dst);
+                break;
+            }
+        }
+    }
+
+    read_material_templates(reader, scene);
+    return !reader.failed();
+}
+
+// クラス名からFbxNodeAttribute::ETypeを決める
+static FbxNodeAttribute::EType attribute_type(const StreamObject& object)
+{
+    static const std::pair<std::string_view, FbxNodeAttribute::EType> types[] = {
+        {"Mesh", FbxNodeAttribute::eMesh},
+        {"Null", FbxNodeAttribute::eNull},
+        {"Marker", FbxNodeAttribute::eMarker},
+        {"LimbNode", FbxNodeAttribute::eSkeleton},
+        {"Limb", FbxNodeAttribute::eSkeleton},
+        {"Root", FbxNodeAttribute::eSkeleton},
+        {"Nurbs", FbxNodeAttribute::eNurbs},
+        {"Patch", FbxNodeAttribute::ePatch},
+        {"Camera", FbxNodeAttribute::eCamera},
+        {"CameraStereo", FbxNodeAttribute::eCameraStereo},
+        {"CameraSwitcher", FbxNodeAttribute::eCameraSwitcher},
+        {"Light", FbxNodeAttribute::eLight},
+        {"OpticalReference", FbxNodeAttribute::eOpticalReference},
+        {"OpticalMarker", FbxNodeAttribute::eOpticalMarker},
+        {"NurbsCurve", FbxNodeAttribute::eNurbsCurve},
+        {"TrimNurbsSurface", FbxNodeAttribute::eTrimNurbsSurface},
+        {"Boundary", FbxNodeAttribute::eBoundary},
+        {"NurbsSurface", FbxNodeAttribute::eNurbsSurface},
+        {"Shape", FbxNodeAttribute::eShape},
+        {"LodGroup", FbxNodeAttribute::eLODGroup},
+        {"SubDiv", FbxNodeAttribute::eSubDiv},
+        {"CachedEffect", FbxNodeAttribute::eCachedEffect},
+        {"Line", FbxNodeAttribute::eLine},
+    };
+    for (const auto& [name, type] : types)
+    {
+        if (object.subclass == name) return type;
+    }
+    return FbxNodeAttribute::eUnknown;
+}
+
+namespace
+{
+// 出力する順に並べたシーンの要素。meshは読むメッシュの番号で、メッシュでなければ-1
+struct StreamItem
+{
+    int64_t id;
+    bool node;
+    int mesh;
+};
+
+// 配列を読むメッシュ一つ分。並列に展開するときは先の数個分を前もって展開しておく
+struct StreamMesh
+{
+    int64_t id;
+    const StreamObject* object;
+    GeometryArrays arrays;
+    std::unique_ptr<GeometryLoad> load;
+};
+
+// 索引を階層順に辿りながら、TextReportと同じ行を書く
+class StreamInspector
+{
+public:
+    StreamInspector(FbxBinaryReader& reader, const StreamScene& scene, const ViewerOptions& options, BufferPool& buffers, ReportWriter& out, std::ostream& err)
+        : reader(reader), scene(scene), options(options), buffers(buffers), out(out), err(err)
+    {
+    }
+
+    void collect(int64_t parent);
+    void write();
+
+private:
+    void prepare(StreamMesh& mesh);
+    void write_mesh(StreamMesh& mesh);
+    void write_normals(const GeometryArrays& arrays);
+    void validate_normals(const GeometryArrays& arrays);
+    void write_materials(int64_t owner);
+    void write_material(int index, int64_t id, const StreamObject& material);
+
+    FbxBinaryReader& reader;
+    const StreamScene& scene;
+    const ViewerOptions& options;
+    BufferPool& buffers;
+    ReportWriter& out;
+    std::ostream& err;
+    std::vector<StreamItem> items;
+    std::deque<StreamMesh> meshes;
+    // 接続が循環していても同じモデルは一度しか辿らない
+    std::unordered_set<int64_t> visited;
+};
+} // namespace
+
+void StreamInspector::collect(int64_t parent)
+{
+    auto children = scene.children.find(parent);
+    if (children == scene.children.end()) return;
+
+    for (int64_t id : children->second)
+    {
+        if (!visited.insert(id).second) continue;
+        items.push_back({id, true, -1});
+
+        auto attributes = scene.attributes.find(id);
+        if (attributes == scene.attributes.end()) err << "Error: Node attribute is null!" << std::endl;
+        else
+        {
+            for (int64_t attribute : attributes->second)
+            {
+                const auto& object = scene.objects.at(attribute);
+                int mesh = -1;
+                if (attribute_type(object) == FbxNodeAttribute::eMesh)
+                {
+                    mesh = static_cast<int>(meshes.size());
+                    meshes.push_back({attribute, &object, {}, nullptr});
+                }
+                items.push_back({attribute, false, mesh});
+            }
+        }
+
+        collect(id);
+    }
+}
+
+void StreamInspector::prepare(StreamMesh& mesh)
+{
+    find_geometry_arrays(reader, mesh.object->record, mesh.arrays);
+    if (!options.normals) return;
+
+    // 1スレッドで法線を列挙するだけなら、丸ごとは展開せずに少しずつ読む
+    if (options.pool == nullptr && !options.validate) return;
+    unsigned what = GeometryNormals | GeometryPolygons;
+    if (options.validate) what |= GeometryVertices;
+    mesh.load = std::make_unique<GeometryLoad>(buffers);
+    mesh.load->start(mesh.arrays, what, options.pool);
+}
+
+void StreamInspector::write()
+{
+    // 並列に展開するときは、いま書いているメッシュの先をスレッド数分だけ展開しておく
+    size_t ahead = options.pool ? options.pool->thread_count() + 1 : 0;
+    size_t prepared = 0;
+    for (const auto& item : items)
+    {
+        if (item.node)
+        {
+            out << "Child node: " << scene.objects.at(item.id).name << '\n';
+            FBXAV_STATS_COUNT(Nodes, 1);
+            continue;
+        }
+
+        out << "Node attribute: " << static_cast<int>(attribute_type(scene.objects.at(item.id))) << '\n';
+        if (item.mesh < 0) continue;
+
+        size_t index = static_cast<size_t>(item.mesh);
+        for (; prepared < meshes.size() && prepared <= index + ahead; ++prepared) prepare(meshes[prepared]);
+        write_mesh(meshes[index]);
+    }
+}
+
+void StreamInspector::write_mesh(StreamMesh& mesh)
+{
+    FBXAV_STATS_COUNT(Meshes, 1);
+    out << "Mesh: " << mesh.object->name << '\n';
+    bool loaded = mesh.load == nullptr || mesh.load->wait();
+    if (!loaded) err << "Error: Unable to decompress the arrays of mesh " << mesh.object->name << std::endl;
+    if (options.normals && loaded)
+    {
+        FBXAV_STATS_SCOPE(Normals);
+        if (options.validate) validate_normals(mesh.arrays);
+        else write_normals(mesh.arrays);
+    }
+    if (options.materials)
+    {
+        FBXAV_STATS_SCOPE(Materials);
+        write_materials(scene.owners.at(mesh.id));
+    }
+
+    // 展開したバッファはプールへ返し、読み終えたメッシュのページは手放す
+    mesh.load.reset();
+    reader.file().release(mesh.object->record.offset, mesh.object->record.end - mesh.object->record.offset);
+}
+
+static bool is_by_control_point(std::string_view mapping)
+{
+    return mapping == "ByVertice" || mapping == "ByVertex" || mapping == "ByControlPoint";
+}
+
+static bool is_indexed(std::string_view reference)
+{
+    return reference == "IndexToDirect" || reference == "Index";
+}
+
+void StreamInspector::write_normals(const GeometryArrays& arrays)
+{
+    if (!arrays.has_normals) return;
+    out << "Element normal: " << arrays.normal_name << '\n';
+
+    bool by_control_point = is_by_control_point(arrays.normal_mapping);
+    bool by_polygon_vertex = arrays.normal_mapping == "ByPolygonVertex";
+    if (!arrays.normals.is_array() || (!by_control_point && !by_polygon_vertex)) return;
+
+    bool indexed = is_indexed(arrays.normal_reference) && arrays.normal_indices.is_array();
+    NormalCursor cursor;
+    if (!cursor.open(arrays.normals, indexed ? &arrays.normal_indices : nullptr, err)) return;
+
+    // 要素数は配列のヘッダだけで分かるので、頂点の配列は展開しない
+    if (by_control_point)
+    {
+        int count = static_cast<int>(arrays.vertices.count / 3);
+        FBXAV_STATS_COUNT(Normals, count);
+        for (int vi = 0; vi < count; vi++)
+        {
+            auto normal = cursor.next();
+            out << "Normal for vertex " << vi << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << '\n';
+        }
+        return;
+    }
+
+    // ポリゴンの区切りは負の頂点番号で表されるので、法線と並べて読みながら数える
+    ArrayCursor<int> polygons;
+    if (!arrays.polygon_vertices.is_array() || !polygons.open(arrays.polygon_vertices, err)) return;
+    int count = static_cast<int>(arrays.polygon_vertices.count);
+    FBXAV_STATS_COUNT(Normals, count);
+    int pi = 0, i = 0;
+    for (int pvi = 0; pvi < count; pvi++)
+    {
+        int vertex = 0;
+        polygons.next(vertex);
+        auto normal = cursor.next();
+        out << "Normal for polygon " << pi << " vertex " << i << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << '\n';
+        if (vertex < 0)
+        {
+            pi++;
+            i = 0;
+        } else
+        {
+            i++;
+        }
+    }
+}
+
+static NormalArrays arrays_of(const SoaVectors& soa)
+{
+    return {soa.x.data(), soa.y.data(), soa.z.data(), soa.size()};
+}
+
+// validate_mesh_normals()と同じ検査を、展開済みの配列から直接行う
+void StreamInspector::validate_normals(const GeometryArrays& arrays)
+{
+    if (!arrays.has_normals) return;
+    const auto& points = arrays.vertices;
+    const auto& vertices = arrays.polygon_vertices;
+    size_t point_count = points.is_array() ? points.count / 3 : 0;
+    size_t polygon_vertex_count = vertices.is_array() ? vertices.count : 0;
+
+    // 各ポリゴンの先頭のポリゴン頂点番号。末尾の区切りが無いポリゴンも一つに数える
+    std::pmr::vector<int> starts(1, 0, analysis_memory());
+    for (size_t k = 0; k < polygon_vertex_count; ++k)
+    {
+        if (vertices.int_at(k) < 0) starts.push_back(static_cast<int>(k + 1));
+    }
+    if (static_cast<size_t>(starts.back()) != polygon_vertex_count) starts.push_back(static_cast<int>(polygon_vertex_count));
+    auto vertex_at = [&](size_t k) {
+        int v = vertices.int_at(k);
+        return v < 0 ? ~v : v;
+    };
+
+    // マッピングの単位に解決する
+    size_t count = 0;
+    bool by_control_point = is_by_control_point(arrays.normal_mapping);
+    bool by_polygon_vertex = arrays.normal_mapping == "ByPolygonVertex";
+    bool by_polygon = arrays.normal_mapping == "ByPolygon";
+    bool all_same = arrays.normal_mapping == "AllSame";
+    if (by_control_point) count = point_count;
+    else if (by_polygon_vertex) count = polygon_vertex_count;
+    else if (by_polygon) count = starts.size() - 1;
+    else if (arrays.normal_mapping == "ByEdge") count = arrays.edges.is_array() ? arrays.edges.count : 0;
+    else if (all_same) count = 1;
+
+    const auto& normals = arrays.normals;
+    const auto& indices = arrays.normal_indices;
+    bool indexed = is_indexed(arrays.normal_reference);
+    size_t value_count = normals.is_array() ? normals.count / 3 : 0;
+    size_t index_count = indices.is_array() ? indices.count : 0;
+    SoaVectors soa;
+    soa.x.assign(count, 0.0f);
+    soa.y.assign(count, 0.0f);
+    soa.z.assign(count, 0.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        long long ni = static_cast<long long>(i);
+        if (indexed) ni = i < index_count ? indices.int_at(i) : -1;
+        if (ni < 0 || static_cast<size_t>(ni) >= value_count) continue;
+        soa.x[i] = static_cast<float>(normals.double_at(ni * 3));
+        soa.y[i] = static_cast<float>(normals.double_at(ni * 3 + 1));
+        soa.z[i] = static_cast<float>(normals.double_at(ni * 3 + 2));
+    }
+
+    NormalCheckResult result;
+    check_normals(arrays_of(soa), options.check, result);
+
+    // 向きはポリゴン頂点の単位で比べる
+    if (points.is_array() && (by_control_point || by_polygon_vertex || by_polygon || all_same))
+    {
+        SoaVectors expanded;
+        if (!by_polygon_vertex)
+        {
+            expanded.x.assign(polygon_vertex_count, 0.0f);
+            expanded.y.assign(polygon_vertex_count, 0.0f);
+            expanded.z.assign(polygon_vertex_count, 0.0f);
+            for (size_t pi = 0; pi + 1 < starts.size(); ++pi)
+            {
+                for (int k = starts[pi]; k < starts[pi + 1]; ++k)
+                {
+                    size_t source = by_control_point ? static_cast<size_t>(vertex_at(k)) : by_polygon ? pi : 0;
+                    if (source >= count) continue;
+                    expanded.x[k] = soa.x[source];
+                    expanded.y[k] = soa.y[source];
+                    expanded.z[k] = soa.z[source];
+                }
+            }
+        }
+
+        // 各ポリゴンの幾何法線をNewellの方法で求め、そのポリゴンの頂点ごとに並べる
+        SoaVectors faces;
+        faces.x.assign(polygon_vertex_count, 0.0f);
+        faces.y.assign(polygon_vertex_count, 0.0f);
+        faces.z.assign(polygon_vertex_count, 0.0f);
+        for (size_t pi = 0; pi + 1 < starts.size(); ++pi)
+        {
+            int begin = starts[pi];
+            int end = starts[pi + 1];
+            double nx = 0, ny = 0, nz = 0;
+            bool valid = true;
+            for (int k = begin; k < end; ++k)
+            {
+                size_t a = static_cast<size_t>(vertex_at(k));
+                size_t b = static_cast<size_t>(vertex_at(k + 1 < end ? k + 1 : begin));
+                if (a >= point_count || b >= point_count)
+                {
+                    valid = false;
+                    break;
+                }
+                double p[3], q[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    p[c] = points.double_at(a * 3 + c);
+                    q[c] = points.double_at(b * 3 + c);
+                }
+                nx += (p[1] - q[1]) * (p[2] + q[2]);
+                ny += (p[2] - q[2]) * (p[0] + q[0]);
+                nz += (p[0] - q[0]) * (p[1] + q[1]);
+            }
+            if (!valid) continue;
+            std::fill(faces.x.begin() + begin, faces.x.begin() + end, static_cast<float>(nx));
+            std::fill(faces.y.begin() + begin, faces.y.begin() + end, static_cast<float>(ny));
+            std::fill(faces.z.begin() + begin, faces.z.begin() + end, static_cast<float>(nz));
+        }
+
+        const auto& facing = by_polygon_vertex ? soa : expanded;
+        if (faces.size() == facing.size()) check_facing(arrays_of(facing), arrays_of(faces), options.check, result);
+    }
+
+    FBXAV_STATS_COUNT(Normals, result.checked);
+    TextReport::write_normal_validation(out, arrays.normal_name, result);
+}
+
+void StreamInspector::write_materials(int64_t owner)
+{
+    static const std::vector<int64_t> none;
+    auto found = scene.materials.find(owner);
+    const auto& materials = found != scene.materials.end() ? found->second : none;
+
+    out << "DisplayMaterial" << '\n';
+    out << "Node: " << scene.objects.at(owner).name << '\n';
+    out << "Material count: " << static_cast<int>(materials.size()) << '\n';
+    FBXAV_STATS_COUNT(Materials, materials.size());
+    for (int i = 0; i < static_cast<int>(materials.size()); ++i) write_material(i, materials[i], scene.objects.at(materials[i]));
+}
+
+static void write_color(ReportWriter& out, const char* name, const double* color)
+{
+    out << "            " << name << ": ";
+    DisplayColor("", FbxColor(color[0], color[1], color[2]));
+}
+
+static void write_scalar(ReportWriter& out, const char* name, double value)
+{
+    out << "            " << name << ": ";
+    DisplayDouble("", value);
+}
+
+void StreamInspector::write_material(int index, int64_t id, const StreamObject& material)
+{
+    DisplayInt("        Material ", index);
+    out << "            Name: \"" << material.name << "\"" << '\n';
+    if (scene.shaded.count(id)) err << "Warning: Streaming mode does not read the shader implementation of material " << material.name << std::endl;
+
+    // SDKと同じく、ShadingModelの名前でPhong/Lambert/それ以外のクラスを選ぶ
+    FbxRecord record;
+    FbxRecordValue value;
+    std::string_view shading = reader.find(&material.record, "ShadingModel", record) && reader.values(record, &value, 1) == 1 ? value.as_string() : std::string_view();
+    bool phong = equals_ignore_case(shading, "phong");
+    bool lambert = equals_ignore_case(shading, "lambert");
+
+    MaterialValues values = phong ? scene.phong : lambert ? scene.lambert : MaterialValues();
+    if (!phong && !lambert) values.shading_model = "Unknown";
+    if (!shading.empty()) values.shading_model = shading;
+    read_material_properties(reader, material.record, values);
+
+    if (phong)
+    {
+        write_color(out, "Ambient", values.ambient);
+        write_color(out, "Diffuse", values.diffuse);
+        write_color(out, "Specular", values.specular);
+        write_color(out, "Emissive", values.emissive);
+        write_scalar(out, "Opacity", 1.0 - values.transparency);
+        write_scalar(out, "Shininess", values.shininess);
+        write_scalar(out, "Reflectivity", values.reflection);
+    } else if (lambert)
+    {
+        write_color(out, "Ambient", values.ambient);
+        write_color(out, "Diffuse", values.diffuse);
+        write_color(out, "Emissive", values.emissive);
+        write_scalar(out, "Opacity", 1.0 - values.transparency);
+    } else
+    {
+        DisplayString("Unknown type of Material");
+    }
+    out << "            Shading Model: " << values.shading_model << '\n';
+    DisplayString("");
+}
+
+bool inspect_stream(const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err)
+{
+    if (options.format != ReportFormat::Text)
+    {
+        err << "Error: Streaming mode only writes text reports" << std::endl;
+        return false;
+    }
+
+    FbxBinaryReader reader;
+    StreamScene scene;
+    {
+        FBXAV_STATS_SCOPE(Import);
+        if (!reader.open(path, err)) return false;
+        if (!index_scene(reader, scene, err))
+        {
+            if (reader.failed()) err << "Error: " << path << " is truncated or corrupt" << std::endl;
+            err << "Error: Unable to read FBX file!" << std::endl;
+            return false;
+        }
+    }
+
+    ScopedDisplayWriter display(&out);
+    out << "Imported FBX file: " << path << '\n';
+    BufferPool buffers;
+    StreamInspector inspector(reader, scene, options, buffers, out, err);
+    inspector.collect(0);
+    inspector.write();
+
+    if (reader.failed())
+    {
+        err << "Error: " << path << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,10 @@
+﻿#pragma once
+#include <iosfwd>
+
+class ReportWriter;
+struct ViewerOptions;
+
+// FbxSceneを作らずにFBXバイナリのノードレコードを直接辿って、SDK経由と同じテキストレポートを書き出す。
+// 配列は必要なもの（法線とそのインデックス、ポリゴン頂点）だけを少しずつ展開するので、
+// 使うメモリはオブジェクトの数には比例するが、メッシュの大きさにはよらない
+bool inspect_stream(const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err);
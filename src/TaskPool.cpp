@@ -0,0 +1,85 @@
+﻿#include "Arena.h"
+#include "TaskPool.h"
+
+// 現在のスレッドが担当するキュー。プール外のスレッドはSIZE_MAX
+static thread_local const TaskPool* t_pool = nullptr;
+static thread_local size_t t_queue = SIZE_MAX;
+
+TaskPool::TaskPool(unsigned threads)
+{
+    // プール外から投入されたタスク用に、ワーカーが一つも無くてもキューは一つ持つ
+    size_t queue_count = threads > 0 ? threads : 1;
+    for (size_t i = 0; i < queue_count; ++i) queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threads; ++i) this->threads.emplace_back([this, i](std::stop_token stop) { work(i, stop); });
+}
+
+TaskPool::~TaskPool()
+{
+    for (auto& thread : threads) thread.request_stop();
+    sleep_cv.notify_all();
+    threads.clear();
+}
+
+void TaskPool::submit(Task task)
+{
+    size_t index = t_pool == this ? t_queue : next_queue.fetch_add(1) % queues.size();
+    {
+        std::lock_guard lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    {
+        // ワーカーが寝る直前の確認と行き違わないようにロックを通しておく
+        std::lock_guard lock(sleep_mutex);
+    }
+    sleep_cv.notify_one();
+}
+
+bool TaskPool::pop(size_t index, Task& task)
+{
+    Queue& queue = *queues[index];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(size_t start, Task& task)
+{
+    for (size_t k = 0; k < queues.size(); ++k)
+    {
+        Queue& queue = *queues[(start + k) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool TaskPool::run_one()
+{
+    Task task;
+    bool found = t_pool == this ? pop(t_queue, task) || steal(t_queue + 1, task) : steal(next_queue.load() % queues.size(), task);
+    if (!found) return false;
+    pending.fetch_sub(1);
+    // 待っている間に手伝ったタスクが、そのスレッドのファイル用のアリーナに確保しないようにする
+    ScopedArena heap(nullptr);
+    task();
+    return true;
+}
+
+void TaskPool::work(size_t index, std::stop_token stop)
+{
+    t_pool = this;
+    t_queue = index;
+    while (!stop.stop_requested())
+    {
+        if (run_one()) continue;
+
+        std::unique_lock lock(sleep_mutex);
+        sleep_cv.wait(lock, stop, [this] { return pending.load() > 0; });
+    }
+}
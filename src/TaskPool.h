@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ワークスティーリング方式のスレッドプール。
+// ワーカーは自分のキューの末尾から取り、空なら他のキューの先頭から盗む。
+// 待っているスレッドもrun_one()でタスクを手伝えるので、入れ子で使っても詰まらない。
+class TaskPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskPool(unsigned threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // タスクは例外を投げないこと。ワーカーの外へ出るとterminateになる。
+    // 失敗しうる処理はTaskSlot::run()で包み、待つ側で投げ直す
+    void submit(Task task);
+
+    // キューにあるタスクを一つ実行する。何も無ければfalse
+    bool run_one();
+
+    unsigned thread_count() const { return static_cast<unsigned>(threads.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(size_t index, Task& task);
+    bool steal(size_t start, Task& task);
+    void work(size_t index, std::stop_token stop);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::jthread> threads;
+    std::atomic<size_t> next_queue = 0;
+    std::atomic<size_t> pending = 0;
+    std::mutex sleep_mutex;
+    std::condition_variable_any sleep_cv;
+};
+
+// 結果を順番どおりに受け取るための完了フラグ
+class TaskSlot
+{
+public:
+    // fを実行して完了にする。fが投げた例外は取っておき、rethrow()で待つ側に渡す
+    template <typename F> void run(F&& f)
+    {
+        try
+        {
+            f();
+        } catch (...)
+        {
+            error = std::current_exception();
+        }
+        finish();
+    }
+
+    void finish()
+    {
+        done.store(true, std::memory_order_release);
+        done.notify_all();
+    }
+
+    // 終わるまでプールのタスクを手伝いながら待つ
+    void wait(TaskPool& pool)
+    {
+        while (!done.load(std::memory_order_acquire))
+        {
+            if (!pool.run_one()) done.wait(false, std::memory_order_acquire);
+        }
+    }
+
+    // wait()の後で呼ぶ。タスクが例外で終わっていれば投げ直す
+    void rethrow() const
+    {
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    std::atomic<bool> done = false;
+    std::exception_ptr error;
+};
@@ -0,0 +1,282 @@
+﻿#include "DisplayCommon.h"
+#include "ReportWriter.h"
+#include "TextReport.h"
+
+void TextReport::begin_file(const char* path)
+{
+    out << "Imported FBX file: " << path << '\n';
+}
+
+void TextReport::node(FbxNode* node, int, std::string_view)
+{
+    out << "Child node: " << node->GetName() << '\n';
+}
+
+void TextReport::attribute(FbxNode*, FbxNodeAttribute* attr)
+{
+    out << "Node attribute: " << attr->GetAttributeType() << '\n';
+}
+
+void TextReport::begin_mesh(FbxNode*, FbxMesh* mesh)
+{
+    out << "Mesh: " << mesh->GetName() << '\n';
+}
+
+void TextReport::begin_normals(FbxMesh*, FbxGeometryElementNormal* element)
+{
+    out << "Element normal: " << element->GetName() << '\n';
+}
+
+void TextReport::control_point_normal(int vi, const FbxVector4& normal)
+{
+    out << "Normal for vertex " << vi << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << '\n';
+}
+
+void TextReport::polygon_vertex_normal(int pi, int i, const FbxVector4& normal)
+{
+    out << "Normal for polygon " << pi << " vertex " << i << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << '\n';
+}
+
+void TextReport::normal_validation(FbxMesh*, FbxGeometryElementNormal* element, const NormalCheckResult& result)
+{
+    write_normal_validation(out, element->GetName(), result);
+}
+
+void TextReport::write_normal_validation(ReportWriter& out, std::string_view element, const NormalCheckResult& result)
+{
+    out << "Normal validation: " << element << '\n';
+    out << "    Checked: " << result.checked << " normals, " << result.facing_checked << " polygon vertices" << '\n';
+    for (int i = 0; i < normal_issue_count; ++i)
+    {
+        out << "    " << normal_issue_name(static_cast<NormalIssue>(i)) << ": " << result.counts[i];
+        const char* separator = " (first: ";
+        for (int index : result.offenders[i])
+        {
+            out << separator << index;
+            separator = ", ";
+        }
+        if (!result.offenders[i].empty()) out << ')';
+        out << '\n';
+    }
+}
+
+void TextReport::normal_comparison(FbxMesh*, FbxGeometryElementNormal* element, const NormalComparison& comparison)
+{
+    out << "Normal comparison: " << element->GetName() << " (" << normal_weighting_name(comparison.weighting) << " weighted, by " << mapping_mode_name(comparison.domain) << ")" << '\n';
+    out << "    Compared: " << comparison.compared << ", skipped: " << comparison.skipped << '\n';
+    out << "    Deviation: mean " << comparison.mean_degrees << ", max " << comparison.max_degrees << " degrees" << '\n';
+    out << "    Histogram:";
+    const char* separator = " ";
+    for (int i = 0; i < normal_deviation_buckets; ++i)
+    {
+        out << separator << (i + 1 < normal_deviation_buckets ? "<" : "<=") << normal_deviation_limits[i] << ": " << comparison.histogram[i];
+        separator = ", ";
+    }
+    out << '\n';
+    out << "    Worst:";
+    separator = " ";
+    for (const auto& worst : comparison.worst)
+    {
+        out << separator << worst.index << " (point " << worst.control_point << ") " << worst.degrees;
+        separator = ", ";
+    }
+    if (comparison.worst.empty()) out << " none";
+    out << '\n';
+}
+
+void TextReport::mesh_statistics(FbxMesh* mesh, const MeshStatistics& statistics)
+{
+    out << "Mesh statistics: " << mesh->GetName() << '\n';
+    write_statistics(statistics);
+}
+
+void TextReport::scene_statistics(const MeshStatistics& statistics)
+{
+    out << "Scene statistics: " << statistics.meshes << " meshes" << '\n';
+    write_statistics(statistics);
+}
+
+void TextReport::write_statistics(const MeshStatistics& statistics)
+{
+    out << "    Control points: " << statistics.control_points << ", polygons: " << statistics.polygons << ", polygon vertices: " << statistics.polygon_vertices
+        << ", triangles: " << statistics.triangles << '\n';
+
+    out << "    Polygon sizes:";
+    const char* separator = " ";
+    for (int size = 0; size <= polygon_size_limit; ++size)
+    {
+        if (statistics.polygon_sizes[size] == 0) continue;
+        out << separator << size << (size == polygon_size_limit ? "+" : "") << ": " << statistics.polygon_sizes[size];
+        separator = ", ";
+    }
+    out << '\n';
+
+    if (statistics.has_bounds)
+    {
+        out << "    Bounds: " << statistics.min[0] << ", " << statistics.min[1] << ", " << statistics.min[2] << " to " << statistics.max[0] << ", " << statistics.max[1] << ", "
+            << statistics.max[2] << '\n';
+    } else
+    {
+        out << "    Bounds: none" << '\n';
+    }
+    out << "    Surface area: " << statistics.area << '\n';
+
+    out << "    Faces per material:";
+    separator = " ";
+    for (size_t i = 0; i < statistics.material_faces.size(); ++i)
+    {
+        out << separator << i << ": " << statistics.material_faces[i];
+        separator = ", ";
+    }
+    out << separator << "unassigned: " << statistics.unassigned_faces << '\n';
+}
+
+void TextReport::begin_materials(FbxNode* node, int count)
+{
+    out << "DisplayMaterial" << '\n';
+    out << "Node: " << (node ? node->GetName() : "") << '\n';
+    out << "Material count: " << count << '\n';
+}
+
+void TextReport::begin_material(int index, FbxSurfaceMaterial* material)
+{
+    DisplayInt("        Material ", index);
+    DisplayString("            Name: \"", (char*)material->GetName(), "\"");
+}
+
+void TextReport::material_id(int id)
+{
+    DisplayInt("            Id: ", id);
+}
+
+void TextReport::material_reference(int index, FbxSurfaceMaterial* material, int id, FbxSurfaceMaterial* original)
+{
+    begin_material(index, material);
+    out << "            Same as: " << id << " \"" << original->GetName() << "\"" << '\n';
+    DisplayString("");
+}
+
+void TextReport::implementation(const FbxImplementation* implementation)
+{
+    DisplayString("            Language: ", implementation->Language.Get().Buffer());
+    DisplayString("            LanguageVersion: ", implementation->LanguageVersion.Get().Buffer());
+    DisplayString("            RenderName: ", implementation->RenderName.Buffer());
+    DisplayString("            RenderAPI: ", implementation->RenderAPI.Get().Buffer());
+    DisplayString("            RenderAPIVersion: ", implementation->RenderAPIVersion.Get().Buffer());
+}
+
+void TextReport::binding_entry(const char* source)
+{
+    DisplayString("            Entry: ", source);
+}
+
+void TextReport::binding_texture(TextureKind kind, const char* name)
+{
+    switch (kind)
+    {
+    case TextureKind::File: DisplayString("           File Texture: ", name); break;
+    case TextureKind::Layered: DisplayString("        Layered Texture: ", name); break;
+    case TextureKind::Procedural: DisplayString("     Procedural Texture: ", name); break;
+    }
+}
+
+void TextReport::binding_bool(bool value)
+{
+    DisplayBool("                Bool: ", value);
+}
+
+void TextReport::binding_int(int value)
+{
+    DisplayInt("                Int: ", value);
+}
+
+void TextReport::binding_float(double value)
+{
+    DisplayDouble("                Float: ", value);
+}
+
+void TextReport::binding_double(double value)
+{
+    DisplayDouble("                Double: ", value);
+}
+
+void TextReport::binding_string(const char* value)
+{
+    DisplayString("                String: ", value);
+}
+
+void TextReport::binding_vector(const FbxVector4& value, int size)
+{
+    switch (size)
+    {
+    case 2: Display2DVector("                2D vector: ", FbxVector2(value[0], value[1])); break;
+    case 3: Display3DVector("                3D vector: ", value); break;
+    default: Display4DVector("                4D vector: ", value); break;
+    }
+}
+
+void TextReport::binding_matrix(const FbxDouble4x4& value)
+{
+    for (int j = 0; j < 4; ++j)
+    {
+        FbxVector4 lVect;
+        lVect[0] = value[j][0];
+        lVect[1] = value[j][1];
+        lVect[2] = value[j][2];
+        lVect[3] = value[j][3];
+        Display4DVector("                4x4D vector: ", lVect);
+    }
+}
+
+void TextReport::binding_int64(long long value)
+{
+    out << "                Int64: " << value << '\n';
+}
+
+void TextReport::binding_time(const FbxTime& value)
+{
+    DisplayDouble("                Time: ", value.GetSecondDouble(), " s");
+}
+
+void TextReport::binding_reference(FbxObject* object)
+{
+    DisplayString("                Reference: ", object ? object->GetName() : "(none)");
+}
+
+void TextReport::binding_blob(size_t size)
+{
+    out << "                Blob: " << size << " bytes" << '\n';
+}
+
+void TextReport::binding_distance(double value, const char* unit)
+{
+    out << "                Distance: " << value << ' ' << unit << '\n';
+}
+
+void TextReport::binding_unsupported(const char* type_name)
+{
+    DisplayString("                Unsupported type: ", type_name);
+}
+
+void TextReport::material_color(const char* name, const FbxColor& value)
+{
+    out << "            " << name << ": ";
+    DisplayColor("", value);
+}
+
+void TextReport::material_scalar(const char* name, double value)
+{
+    out << "            " << name << ": ";
+    DisplayDouble("", value);
+}
+
+void TextReport::unknown_material()
+{
+    DisplayString("Unknown type of Material");
+}
+
+void TextReport::end_material(const char* shading_model)
+{
+    DisplayString("            Shading Model: ", shading_model);
+    DisplayString("");
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "Report.h"
+
+// 従来どおりの人間向けテキストレポート
+class TextReport : public Report
+{
+public:
+    explicit TextReport(ReportWriter& out) : Report(out) {}
+
+    std::unique_ptr<Report> fork(ReportWriter& part) const override { return std::make_unique<TextReport>(part); }
+
+    void begin_file(const char* path) override;
+    void end_file() override {}
+
+    void node(FbxNode* node, int depth, std::string_view path) override;
+    void attribute(FbxNode* node, FbxNodeAttribute* attr) override;
+
+    void begin_mesh(FbxNode* node, FbxMesh* mesh) override;
+    void end_mesh() override {}
+
+    void begin_normals(FbxMesh* mesh, FbxGeometryElementNormal* element) override;
+    void control_point_normal(int vi, const FbxVector4& normal) override;
+    void polygon_vertex_normal(int pi, int i, const FbxVector4& normal) override;
+    void end_normals() override {}
+    void normal_validation(FbxMesh* mesh, FbxGeometryElementNormal* element, const NormalCheckResult& result) override;
+    void normal_comparison(FbxMesh* mesh, FbxGeometryElementNormal* element, const NormalComparison& comparison) override;
+
+    void mesh_statistics(FbxMesh* mesh, const MeshStatistics& statistics) override;
+    void scene_statistics(const MeshStatistics& statistics) override;
+
+    void begin_materials(FbxNode* node, int count) override;
+    void begin_material(int index, FbxSurfaceMaterial* material) override;
+    void material_id(int id) override;
+    void material_reference(int index, FbxSurfaceMaterial* material, int id, FbxSurfaceMaterial* original) override;
+    void implementation(const FbxImplementation* implementation) override;
+    void binding_entry(const char* source) override;
+    void binding_texture(TextureKind kind, const char* name) override;
+    void binding_bool(bool value) override;
+    void binding_int(int value) override;
+    void binding_float(double value) override;
+    void binding_double(double value) override;
+    void binding_string(const char* value) override;
+    void binding_vector(const FbxVector4& value, int size) override;
+    void binding_matrix(const FbxDouble4x4& value) override;
+    void binding_int64(long long value) override;
+    void binding_time(const FbxTime& value) override;
+    void binding_reference(FbxObject* object) override;
+    void binding_blob(size_t size) override;
+    void binding_distance(double value, const char* unit) override;
+    void binding_unsupported(const char* type_name) override;
+    void material_color(const char* name, const FbxColor& value) override;
+    void material_scalar(const char* name, double value) override;
+    void unknown_material() override;
+    void end_material(const char* shading_model) override;
+    void end_materials() override {}
+
+    // normal_validation()の本体。SDKのオブジェクトを持たないストリーミングからも使う
+    static void write_normal_validation(ReportWriter& out, std::string_view element, const NormalCheckResult& result);
+
+private:
+    void write_statistics(const MeshStatistics& statistics);
+};
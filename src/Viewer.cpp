@@ -0,0 +1,559 @@
+﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "DisplayCommon.h"
+#include "LayerElement.h"
+#include "MaterialIndex.h"
+#include "MemoryStream.h"
+#include "MeshStatistics.h"
+#include "PropertyDispatch.h"
+#include "Report.h"
+#include "ReportCache.h"
+#include "ReportWriter.h"
+#include "Stats.h"
+#include "StreamInspect.h"
+#include "TaskPool.h"
+#include "Viewer.h"
+
+static bool inspect_scene(const FbxPtr<FbxManager>& manager, const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err)
+{
+    if (options.stream) return inspect_stream(path, options, out, err);
+
+    ScopedDisplayWriter display(&out);
+    auto report = create_report(options.format, out);
+
+    // ワークスペースがあればそのシーンを使い回し、無ければこのファイル専用に作る
+    FbxPtr<FbxScene> owned;
+    auto& slot = options.workspace ? options.workspace->scene : owned;
+    FbxScene* scene = options.scene;
+    if (scene == nullptr)
+    {
+        if (!import(manager, path, select_import_profile(options), slot, err, options.contents))
+        {
+            err << "Error: Unable to import FBX file!" << std::endl;
+            return false;
+        }
+        scene = slot.get();
+    }
+
+    // 索引はマテリアルごとに一度だけ中身を辿るので、メッシュの解析より先に作っておく
+    MaterialIndex materials;
+    bool indexed = options.materials && (options.dedup_materials || options.textures);
+    if (indexed)
+    {
+        FBXAV_STATS_SCOPE(Materials);
+        materials.build(scene, options.query);
+        if (options.textures) options.textures->add(materials);
+    }
+
+    report->begin_file(path);
+    read(scene, *report, options, err, indexed && options.dedup_materials ? &materials : nullptr);
+    report->end_file();
+
+    if (!options.dump_normals.empty())
+    {
+        FBXAV_STATS_SCOPE(Dump);
+        return dump_normals(scene, options.dump_normals.c_str(), options.dump, err);
+    }
+
+    return true;
+}
+
+// レポートの中身を左右するオプションだけを並べる。SIMDの種類やスレッド数は結果を変えない
+static std::string cache_options(const ViewerOptions& options)
+{
+    char text[256];
+    std::snprintf(text, sizeof(text), "format=%d normals=%d materials=%d dedup=%d validate=%d tolerance=%.9g zero=%.9g offenders=%d stream=%d stats_mesh=%d names=%d compare=%d weighting=%d",
+                  static_cast<int>(options.format), options.normals, options.materials, options.dedup_materials, options.validate, options.check.tolerance, options.check.zero_length,
+                  options.check.max_offenders, options.stream, options.mesh_statistics, options.names, options.compare_normals, static_cast<int>(options.weighting));
+    std::string key = text;
+    if (options.query) key += " where=" + options.query->text();
+    return key;
+}
+
+// SDK経由とストリーミングの両方でレポートを作って突き合わせる。出力はSDK経由の方を使う
+static bool verify_streaming(const FbxPtr<FbxManager>& manager, const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err)
+{
+    ViewerOptions sdk_options = options;
+    sdk_options.stream = false;
+    ReportWriter expected(nullptr, 64 * 1024, analysis_memory());
+    bool ok = inspect_scene(manager, path, sdk_options, expected, err);
+
+    ViewerOptions stream_options = options;
+    stream_options.stream = true;
+    ReportWriter actual(nullptr, 64 * 1024, analysis_memory());
+    std::ostringstream messages;
+    bool streamed = inspect_stream(path, stream_options, actual, messages);
+
+    out << expected.view();
+    if (!ok) return false;
+    if (!streamed)
+    {
+        err << messages.str() << "Error: Streaming mode could not read " << path << std::endl;
+        return false;
+    }
+
+    auto a = expected.view();
+    auto b = actual.view();
+    if (a == b) return true;
+
+    // 最初に食い違った行を示す
+    size_t line = 1, begin = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()) && a[i] == b[i]; ++i)
+    {
+        if (a[i] != '\n') continue;
+        ++line;
+        begin = i + 1;
+    }
+    auto line_at = [begin](std::string_view text) { return text.substr(std::min(begin, text.size()), text.find('\n', begin) - std::min(begin, text.size())); };
+    err << "Error: Streaming report of " << path << " differs from the SDK at line " << line << std::endl;
+    err << "    sdk:    " << line_at(a) << std::endl;
+    err << "    stream: " << line_at(b) << std::endl;
+    return false;
+}
+
+bool inspect(const FbxPtr<FbxManager>& manager, const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err)
+{
+    // ワークスペースがあれば、このファイルの一時的な確保はそのアリーナから取る
+    ScopedArena arena(options.workspace ? &options.workspace->arena : current_arena());
+    if (options.verify_streaming) return verify_streaming(manager, path, options, out, err);
+
+    // 法線のダンプとテクスチャの集計はシーンが要るので、キャッシュでは済ませられない
+    uint64_t key = 0;
+    auto cache = options.dump_normals.empty() && options.textures == nullptr ? options.cache : nullptr;
+    if (cache == nullptr || !cache->key(path, cache_options(options), key)) return inspect_scene(manager, path, options, out, err);
+
+    std::string cached;
+    if (cache->load(key, cached))
+    {
+        out << cached;
+        return true;
+    }
+
+    // 警告が出たレポートは次回も同じ警告を出せるよう、キャッシュしない
+    ReportWriter part(nullptr, 64 * 1024, analysis_memory());
+    std::ostringstream messages;
+    bool ok = inspect_scene(manager, path, options, part, messages);
+    auto text = std::move(messages).str();
+    if (ok && text.empty()) cache->store(key, part.view());
+
+    out << part.view();
+    err << text;
+    return ok;
+}
+
+namespace
+{
+// 並列に解析するメッシュ一つ分。結果は専用のライタに溜めてから順番どおりに差し込む
+struct MeshJob
+{
+    MeshJob(FbxNode* node, FbxMesh* mesh) : node(node), mesh(mesh) {}
+
+    FbxNode* node;
+    FbxMesh* mesh;
+    std::unique_ptr<ReportWriter> out;
+    TaskSlot slot;
+    // シーン全体の合計には階層順に足す
+    MeshStatistics statistics;
+    // マテリアルごとに--whereを評価するときのノードの位置
+    std::string path;
+    int depth = 0;
+};
+
+// 階層順に並べたシーンの要素。attrがnullptrならノード自体を表す
+struct SceneItem
+{
+    FbxNode* node;
+    FbxNodeAttribute* attr;
+    int depth;
+    std::string path;
+    MeshJob* job;
+};
+} // namespace
+
+// ノードを深さ優先で辿り、ノードとその全アトリビュートを階層順に並べる。
+// queryがあれば合うアトリビュート（アトリビュートの無いノードはノード自体）だけを残し、
+// 一つも残らなかったノードは子だけを辿る
+static void collect(FbxNode* node, int depth, std::string& path, const Query* query, std::vector<SceneItem>& items, std::deque<MeshJob>& jobs, std::ostream& err)
+{
+    for (int i = 0; i < node->GetChildCount(); ++i)
+    {
+        auto child = node->GetChild(i);
+        if (child == nullptr)
+        {
+            err << "Error: Child node is null!" << std::endl;
+            continue;
+        }
+
+        size_t length = path.size();
+        path += '/';
+        path += child->GetName();
+        items.push_back({child, nullptr, depth, path, nullptr});
+        size_t node_items = items.size();
+
+        int count = child->GetNodeAttributeCount();
+        if (count == 0) err << "Error: Node attribute is null!" << std::endl;
+        bool matched = count == 0 && (query == nullptr || query->matches({child, nullptr, path, depth}));
+        for (int a = 0; a < count; ++a)
+        {
+            auto attr = child->GetNodeAttributeByIndex(a);
+            if (attr == nullptr)
+            {
+                err << "Error: Node attribute is null!" << std::endl;
+                continue;
+            }
+            // 合わないアトリビュートはメッシュの解析も含めてここで落とす
+            if (query && !query->matches({child, attr, path, depth})) continue;
+
+            MeshJob* job = nullptr;
+            if (attr->GetAttributeType() == FbxNodeAttribute::eMesh)
+            {
+                job = &jobs.emplace_back(child, static_cast<FbxMesh*>(attr));
+                if (query)
+                {
+                    job->path = path;
+                    job->depth = depth;
+                }
+            }
+            items.push_back({child, attr, depth, {}, job});
+        }
+        if (!matched && items.size() == node_items) items.pop_back();
+
+        collect(child, depth + 1, path, query, items, jobs, err);
+        path.resize(length);
+    }
+}
+
+// メッシュ一つ分の法線・マテリアルを解析してレポートに流す
+static void analyze_mesh(const MeshJob& job, Report& report, const ViewerOptions& options, const MaterialIndex* materials, BindingCache& bindings, MeshStatistics& statistics)
+{
+    FbxNode* node = job.node;
+    FbxMesh* mesh = job.mesh;
+    report.begin_mesh(node, mesh);
+    if (options.mesh_statistics)
+    {
+        FBXAV_STATS_SCOPE(Geometry);
+        compute_mesh_statistics(mesh, statistics);
+        report.mesh_statistics(mesh, statistics);
+    }
+    if (options.normals)
+    {
+        FBXAV_STATS_SCOPE(Normals);
+        if (options.validate)
+        {
+            NormalCheckResult result;
+            if (validate_mesh_normals(mesh, options.check, result)) report.normal_validation(mesh, mesh->GetElementNormal(), result);
+            FBXAV_STATS_COUNT(Normals, result.checked);
+        }
+        if (options.compare_normals)
+        {
+            // 大きなメッシュ一つでも速く終わるよう、メッシュの中もプールで分けて計算する
+            NormalComparison comparison;
+            if (compare_mesh_normals(mesh, options.weighting, options.check.max_offenders, options.pool, comparison))
+                report.normal_comparison(mesh, mesh->GetElementNormal(), comparison);
+            FBXAV_STATS_COUNT(Normals, comparison.compared);
+        }
+        if (!options.validate && !options.compare_normals) read_normal(mesh, report);
+    }
+    if (options.materials)
+    {
+        FBXAV_STATS_SCOPE(Materials);
+        QueryItem item{node, mesh, job.path, job.depth};
+        DisplayMaterial(mesh, report, materials, &bindings, options.query, &item);
+    }
+    report.end_mesh();
+}
+
+// 階層順にレポートを書く。並列に解析したメッシュは終わるのを待って差し込む
+static void write_items(std::vector<SceneItem>& items, Report& report, const ViewerOptions& options, const MaterialIndex* materials, BindingCache& bindings, TaskPool* pool)
+{
+    MeshStatistics scene_statistics;
+    for (auto& item : items)
+    {
+        if (item.attr == nullptr)
+        {
+            if (options.names) report.node(item.node, item.depth, item.path);
+            continue;
+        }
+
+        if (options.names) report.attribute(item.node, item.attr);
+        if (item.job == nullptr) continue;
+
+        if (pool)
+        {
+            item.job->slot.wait(*pool);
+            item.job->slot.rethrow();
+            report.splice(*item.job->out);
+            item.job->out.reset();
+        } else
+        {
+            analyze_mesh(*item.job, report, options, materials, bindings, item.job->statistics);
+        }
+        if (options.mesh_statistics) scene_statistics.add(item.job->statistics);
+    }
+    if (options.mesh_statistics) report.scene_statistics(scene_statistics);
+}
+
+void read(FbxScene* scene, Report& report, const ViewerOptions& options, std::ostream& err, const MaterialIndex* materials)
+{
+    auto root = scene->GetRootNode();
+    if (root == nullptr)
+    {
+        err << "Error: Root node is null!" << std::endl;
+        return;
+    }
+
+    // 先にシーン全体を辿ってメッシュを集めておく
+    std::vector<SceneItem> items;
+    std::deque<MeshJob> jobs;
+    {
+        FBXAV_STATS_SCOPE(Traversal);
+        std::string path;
+        collect(root, 0, path, options.query, items, jobs, err);
+        FBXAV_STATS_COUNT(Nodes, items.size() - std::count_if(items.begin(), items.end(), [](const SceneItem& item) { return item.attr != nullptr; }));
+        FBXAV_STATS_COUNT(Meshes, jobs.size());
+    }
+
+    // 同じマテリアルを使うメッシュが多くても、バインディングの解決は一度で済ませる
+    BindingCache bindings;
+
+    // メッシュはプールで並列に解析し、出力は階層順に差し込む
+    TaskPool* pool = jobs.size() > 1 ? options.pool : nullptr;
+    size_t submitted = 0;
+    try
+    {
+        if (pool)
+        {
+            for (auto& job : jobs)
+            {
+                pool->submit([&job, &report, &options, materials, &bindings, stats = current_stats()] {
+                    job.slot.run([&] {
+                        job.out = std::make_unique<ReportWriter>(nullptr, 64 * 1024);
+                        ScopedDisplayWriter display(job.out.get());
+                        ScopedStats scoped(stats);
+                        auto part = report.fork(*job.out);
+                        analyze_mesh(job, *part, options, materials, bindings, job.statistics);
+                    });
+                });
+                ++submitted;
+            }
+        }
+        write_items(items, report, options, materials, bindings, pool);
+    } catch (...)
+    {
+        // 投げたタスクはこの関数の変数を参照しているので、全部終わるまで抜けない
+        for (size_t i = 0; i < submitted; ++i) jobs[i].slot.wait(*pool);
+        throw;
+    }
+}
+
+ImportProfile select_import_profile(const ViewerOptions& options)
+{
+    if (options.profile != ImportProfile::Auto) return options.profile;
+    // --whereがマテリアルを見るときと、--stats-meshがマテリアルごとの面の数を数えるときは、出さなくても読み込んでおく
+    bool query_materials = options.query && (options.query->uses(QueryField::Materials) || options.query->uses(QueryField::MaterialCount));
+    return options.materials || query_materials || options.mesh_statistics ? ImportProfile::Materials : ImportProfile::Normals;
+}
+
+FbxPtr<FbxScene> import(const FbxPtr<FbxManager>& manager, const char* path, ImportProfile profile, std::ostream& err)
+{
+    FbxPtr<FbxScene> scene;
+    if (!import(manager, path, profile, scene, err)) return nullptr;
+    return scene;
+}
+
+bool import(const FbxPtr<FbxManager>& manager, const char* path, ImportProfile profile, FbxPtr<FbxScene>& scene, std::ostream& err, std::string_view contents)
+{
+    if (manager == nullptr)
+    {
+        err << "Error: Unable to create FBX Manager!" << std::endl;
+        return false;
+    }
+
+    // バッチ処理ではマネージャを使い回すので、IOSettingsは最初の一回だけ作る
+    if (manager->GetIOSettings() == nullptr)
+    {
+        auto ios = FbxIOSettings::Create(manager.get(), IOSROOT);
+        manager->SetIOSettings(ios);
+    }
+    apply_import_profile(manager->GetIOSettings(), profile);
+
+    FbxPtr<FbxImporter> importer(FbxImporter::Create(manager.get(), ""));
+    // ストリームはImport()が終わるまで生かしておく
+    MemoryStream stream(contents, manager->GetIOPluginRegistry()->FindReaderIDByExtension("fbx"));
+    bool initialized;
+    {
+        FBXAV_STATS_SCOPE(Initialize);
+        if (contents.empty()) initialized = importer->Initialize(path, -1, manager->GetIOSettings());
+        else initialized = importer->Initialize(&stream, nullptr, stream.GetReaderID(), manager->GetIOSettings());
+    }
+    if (!initialized)
+    {
+        err << "Error: Unable to initialize FBX importer!" << std::endl;
+        return false;
+    }
+
+    // 前のファイルのノードやジオメトリを消して、シーンのオブジェクト自体は残す
+    if (scene) scene->Clear();
+    else scene.reset(FbxScene::Create(manager.get(), ""));
+    bool imported;
+    {
+        FBXAV_STATS_SCOPE(Import);
+        imported = importer->Import(scene.get());
+    }
+    if (!imported)
+    {
+        err << "Error: " << importer->GetStatus().GetErrorString() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void read_normal(FbxMesh* mesh, Report& report)
+{
+    auto elnrm = mesh->GetElementNormal();
+    if (elnrm != nullptr)
+    {
+        report.begin_normals(mesh, elnrm);
+
+        // 直接配列とインデックス配列は一度だけロックして取り出し、マッピングの単位に展開しておく
+        ResolvedElement<FbxVector4> normals;
+        resolve_element(mesh, elnrm, normals);
+        FBXAV_STATS_COUNT(Normals, normals.values.size());
+
+        // mapping mode is by control points. The mesh should be smooth and soft.
+        // we can get normals by retrieving each control point
+        if (normals.mapping == FbxGeometryElement::eByControlPoint)
+        {
+            for (int vi = 0; vi < (int)normals.values.size(); vi++) report.control_point_normal(vi, normals.values[vi]);
+        }
+        // mapping mode is by polygon-vertex.
+        // we can get normals by retrieving polygon-vertex.
+        else if (normals.mapping == FbxGeometryElement::eByPolygonVertex)
+        {
+            std::pmr::vector<int> starts(analysis_memory());
+            polygon_starts(mesh, starts);
+            for (int pi = 0; pi + 1 < (int)starts.size(); pi++)
+            {
+                for (int pvi = starts[pi]; pvi < starts[pi + 1]; pvi++) report.polygon_vertex_normal(pi, pvi - starts[pi], normals.values[pvi]);
+            }
+        }
+        report.end_normals();
+    }
+}
+
+void DisplayMaterial(FbxGeometry* pGeometry, Report& report, const MaterialIndex* pIndex, BindingCache* pBindings, const Query* pQuery, const QueryItem* pItem)
+{
+    int lMaterialCount = 0;
+    FbxNode* lNode = NULL;
+    if (pGeometry)
+    {
+        lNode = pGeometry->GetNode();
+        if (lNode) lMaterialCount = lNode->GetMaterialCount();
+    }
+    report.begin_materials(lNode, lMaterialCount);
+    FBXAV_STATS_COUNT(Materials, lMaterialCount);
+    // 索引があれば、同じ内容のマテリアルは最初の1回だけ詳しく出し、あとは参照で済ませる
+    const MaterialUse* lUses = pIndex ? pIndex->uses(pGeometry) : nullptr;
+    // マテリアルを参照しない条件はノードの段階で評価済みなので、ここでは見直さない
+    bool lFilter = pQuery && pItem && pQuery->uses(QueryField::Materials);
+    for (int lCount = 0; lCount < lMaterialCount; lCount++)
+    {
+        FbxSurfaceMaterial* lMaterial = lNode->GetMaterial(lCount);
+        if (lFilter)
+        {
+            QueryItem lItem = *pItem;
+            lItem.material = lMaterial;
+            if (!lMaterial || !pQuery->matches(lItem)) continue;
+        }
+        if (lUses && !lUses[lCount].first)
+        {
+            report.material_reference(lCount, lMaterial, lUses[lCount].id, lUses[lCount].original);
+            continue;
+        }
+        report.begin_material(lCount, lMaterial);
+        if (lUses) report.material_id(lUses[lCount].id);
+        read_material(lMaterial, report, pBindings);
+    }
+    report.end_materials();
+}
+
+void read_material(FbxSurfaceMaterial* lMaterial, Report& report, BindingCache* pBindings)
+{
+    FbxPropertyT<FbxDouble3> lKFbxDouble3;
+    FbxPropertyT<FbxDouble> lKFbxDouble1;
+    FbxColor theColor;
+    // Get the implementation to see if it's a hardware shader.
+    // 実装の検索とエントリごとのプロパティ検索はマテリアルごとに一度だけ行い、値はデータ型の表から読む
+    ResolvedMaterial lLocal;
+    if (!pBindings) resolve_material(lMaterial, lLocal);
+    const ResolvedMaterial& lResolved = pBindings ? pBindings->resolve(lMaterial) : lLocal;
+    if (lResolved.implementation)
+    {
+        // Now we have a hardware shader, let's read it
+        report.implementation(lResolved.implementation);
+        for (const auto& lBinding : lResolved.bindings)
+        {
+            report.binding_entry(lBinding.source.Buffer());
+            for (const auto& [lKind, lName] : lBinding.textures) report.binding_texture(lKind, lName);
+            if (lBinding.handler) lBinding.handler(lBinding.property, report);
+        }
+    } else if (lMaterial->GetClassId().Is(FbxSurfacePhong::ClassId))
+    {
+        // We found a Phong material.  Display its properties.
+        // Display the Ambient Color
+        lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Ambient;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Ambient", theColor);
+        // Display the Diffuse Color
+        lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Diffuse;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Diffuse", theColor);
+        // Display the Specular Color (unique to Phong materials)
+        lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Specular;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Specular", theColor);
+        // Display the Emissive Color
+        lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Emissive;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Emissive", theColor);
+        // Opacity is Transparency factor now
+        lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->TransparencyFactor;
+        report.material_scalar("Opacity", 1.0 - lKFbxDouble1.Get());
+        // Display the Shininess
+        lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->Shininess;
+        report.material_scalar("Shininess", lKFbxDouble1.Get());
+        // Display the Reflectivity
+        lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->ReflectionFactor;
+        report.material_scalar("Reflectivity", lKFbxDouble1.Get());
+    } else if (lMaterial->GetClassId().Is(FbxSurfaceLambert::ClassId))
+    {
+        // We found a Lambert material. Display its properties.
+        // Display the Ambient Color
+        lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Ambient;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Ambient", theColor);
+        // Display the Diffuse Color
+        lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Diffuse;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Diffuse", theColor);
+        // Display the Emissive
+        lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Emissive;
+        theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
+        report.material_color("Emissive", theColor);
+        // Display the Opacity
+        lKFbxDouble1 = ((FbxSurfaceLambert*)lMaterial)->TransparencyFactor;
+        report.material_scalar("Opacity", 1.0 - lKFbxDouble1.Get());
+    } else
+        report.unknown_material();
+    FbxPropertyT<FbxString> lString;
+    lString = lMaterial->ShadingModel;
+    report.end_material(lString.Get().Buffer());
+}
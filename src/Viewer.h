@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <fbxsdk.h>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include "Arena.h"
+#include "FbxPtr.h"
+#include "ImportProfile.h"
+#include "NormalDump.h"
+#include "NormalValidation.h"
+#include "Query.h"
+#include "Report.h"
+
+class BindingCache;
+class MaterialIndex;
+class ReportCache;
+class ReportWriter;
+class TaskPool;
+class TextureUsage;
+
+// バッチのワーカーがファイルをまたいで使い回す作業領域。
+// ワーカーのFbxManagerより先に破棄すること
+struct Workspace
+{
+    // 読み込み先のシーン。ファイルごとに作り直さず、空にしてから読み込む
+    FbxPtr<FbxScene> scene;
+    // 1ファイル分の解析の一時的な配列とレポートの途中経過。ファイルが終わるたびにreset()する
+    Arena arena;
+};
+
+// レポートの内容や書式に関する設定
+struct ViewerOptions
+{
+    ReportFormat format = ReportFormat::Text;
+    // レポートに含める内容。falseにした部分は読み込みも省く
+    bool normals = true;
+    bool materials = true;
+    // ノードとアトリビュートの行を出す
+    bool names = true;
+    // 設定されていれば条件に合うノードとアトリビュート、マテリアルだけを辿って出す
+    const Query* query = nullptr;
+    // Autoなら上の内容から必要最小限のプロファイルを選ぶ
+    ImportProfile profile = ImportProfile::Auto;
+    // 空でなければ法線をこのパスへバイナリで書き出す
+    std::string dump_normals;
+    NormalDumpOptions dump;
+    // 法線を列挙する代わりに検査結果だけを出す
+    bool validate = false;
+    NormalCheckOptions check;
+    // 法線を列挙する代わりに、計算し直したスムーズ法線とのずれを出す。最大の違反はcheck.max_offenders個
+    bool compare_normals = false;
+    NormalWeighting weighting = NormalWeighting::Area;
+    // メッシュごとと、シーン全体の形の集計を出す
+    bool mesh_statistics = false;
+    // メッシュを並列に解析するプール。nullptrなら1スレッドで順に処理する
+    TaskPool* pool = nullptr;
+    // 設定されていれば変わっていないファイルはキャッシュからレポートを出す
+    ReportCache* cache = nullptr;
+    // 内容が同じマテリアルは2回目以降を参照だけにする
+    bool dedup_materials = false;
+    // 設定されていれば、使われているテクスチャをファイルをまたいで数える
+    TextureUsage* textures = nullptr;
+    // FbxSceneを作らずにバイナリのノードレコードを直接読む（テキスト書式のみ）
+    bool stream = false;
+    // SDKでの読み込みとストリーミングの両方でレポートを作り、一致するかを確かめる
+    bool verify_streaming = false;
+    // 設定されていればシーンとアリーナをここから借りる
+    Workspace* workspace = nullptr;
+    // 空でなければ、パスのファイルの代わりにメモリに先読みしたこの中身から読み込む。
+    // パスはレポートとエラーの表示にだけ使う
+    std::string_view contents;
+    // 設定されていれば読み込まずにこの読み込み済みのシーンを使う。
+    // シーンのプロファイルはselect_import_profile()の結果を含んでいること
+    FbxScene* scene = nullptr;
+};
+
+// 1ファイルを読み込んでレポートを書き出す。読み込めなかったらfalseを返す
+bool inspect(const FbxPtr<FbxManager>& manager, const char* path, const ViewerOptions& options, ReportWriter& out, std::ostream& err);
+
+// レポートの内容に合うプロファイルを返す。明示されていればそれを使う
+ImportProfile select_import_profile(const ViewerOptions& options);
+
+FbxPtr<FbxScene> import(const FbxPtr<FbxManager>& manager, const char* path, ImportProfile profile, std::ostream& err);
+// sceneが空なら作り、あれば中身を消してから読み込む。contentsが空でなければパスの代わりにそれを読む
+bool import(const FbxPtr<FbxManager>& manager, const char* path, ImportProfile profile, FbxPtr<FbxScene>& scene, std::ostream& err, std::string_view contents = {});
+// materialsがあれば、同じ内容のマテリアルは最初に使われた場所だけ詳しく出す
+void read(FbxScene* scene, Report& report, const ViewerOptions& options, std::ostream& err, const MaterialIndex* materials = nullptr);
+void read_normal(FbxMesh* mesh, Report& report);
+// pQueryがマテリアルを参照していれば、pItemにマテリアルを加えて評価し、合うものだけを出す
+void DisplayMaterial(FbxGeometry* pGeometry, Report& report, const MaterialIndex* pIndex = nullptr, BindingCache* pBindings = nullptr, const Query* pQuery = nullptr,
+                     const QueryItem* pItem = nullptr);
+// マテリアル一つ分の中身(実装とバインディング、またはPhong/Lambertのプロパティ)を流す
+void read_material(FbxSurfaceMaterial* pMaterial, Report& report, BindingCache* pBindings = nullptr);
@@ -1,384 +1,407 @@
 ﻿#include <fbxsdk.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <memory>
-#include "DisplayCommon.h"
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Batch.h"
+#include "ImportProfile.h"
+#include "MaterialIndex.h"
+#include "Query.h"
+#include "ReportCache.h"
+#include "ReportWriter.h"
+#include "SceneDiff.h"
+#include "Server.h"
+#include "Stats.h"
+#include "TaskPool.h"
+#include "Viewer.h"
 
-// Destroyメソッドを持つクラスかどうかをチェックするコンセプト
-template <typename T>
-concept HasDestroy = requires(T* t) {
+static void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options] <input.fbx | directory | ->..." << std::endl;
+    std::cerr << "       " << program << " diff <a.fbx> <b.fbx>" << std::endl;
+    std::cerr << "  diff                  list nodes, attribute types, materials and normals that differ" << std::endl;
+    std::cerr << "                        between two files; exits with 1 if any differ" << std::endl;
+    std::cerr << "  -j, --jobs=N          number of worker threads for batch mode (default: all cores)" << std::endl;
+    std::cerr << "  --prefetch=N          files read into memory ahead of the batch workers (default: 8, 0 reads" << std::endl;
+    std::cerr << "                        each file from its path while importing; off with --cache-dir)" << std::endl;
+    std::cerr << "  --prefetch-bytes=N    hold at most N bytes of read-ahead file contents; larger files are read" << std::endl;
+    std::cerr << "                        from their path (default: 512 MiB)" << std::endl;
+    std::cerr << "  --queue-depth=N       finished batch reports held for ordered output (default: 4 per job)" << std::endl;
+    std::cerr << "  --mesh-jobs=N         threads analysing meshes of one scene (default: all cores for" << std::endl;
+    std::cerr << "                        a single file, 1 in batch mode; 1 streams output directly)" << std::endl;
+    std::cerr << "  --format=FORMAT       report format: text (default), json (one file) or ndjson" << std::endl;
+    std::cerr << "  --only=SECTION        report only normals or materials (imports less)" << std::endl;
+    std::cerr << "  --where=EXPR          report only nodes, attributes and materials matching EXPR, e.g." << std::endl;
+    std::cerr << "                        'type==mesh && normals.mapping==polygon_vertex'. Fields: name, path," << std::endl;
+    std::cerr << "                        depth, type, control_points, polygons, polygon_vertices," << std::endl;
+    std::cerr << "                        normals.mapping, normals.reference, materials, materials.count" << std::endl;
+    std::cerr << "  --select=LIST         comma-separated sections to report: name, normals, materials," << std::endl;
+    std::cerr << "                        statistics (default: name,normals,materials)" << std::endl;
+    std::cerr << "  --import-profile=P    what the SDK imports: auto (default), full, materials or normals" << std::endl;
+    std::cerr << "  --compare-profiles    import each file with every profile and report time and memory" << std::endl;
+    std::cerr << "  --cache-dir=DIR       reuse reports of unchanged files from an on-disk cache" << std::endl;
+    std::cerr << "  --cache-max-bytes=N   evict least recently used cache entries above N bytes (default: 1 GiB)" << std::endl;
+    std::cerr << "  --cache-rehash        hash every file instead of trusting unchanged size and mtime" << std::endl;
+    std::cerr << "  --dedup-materials     report each distinct material once and refer back to it afterwards" << std::endl;
+    std::cerr << "  --texture-usage       list texture files by how many input files and materials use them" << std::endl;
+    std::cerr << "  --stats               print time per phase, counters and peak memory to stderr" << std::endl;
+    std::cerr << "  --stream              read binary FBX records directly without building a scene" << std::endl;
+    std::cerr << "                        (text format only). Arrays of the next meshes are inflated" << std::endl;
+    std::cerr << "                        in parallel; with --mesh-jobs=1 memory does not grow with mesh size" << std::endl;
+    std::cerr << "  --verify-streaming    build each report both with the SDK and by streaming, and" << std::endl;
+    std::cerr << "                        report the first line where they differ" << std::endl;
+    std::cerr << "  --dump-normals=PATH   write normals as a binary SoA file (a directory in batch mode)" << std::endl;
+    std::cerr << "  --dump-points         also write control points to the normal dump" << std::endl;
+    std::cerr << "  --dump-indices        also write polygon-vertex indices to the normal dump" << std::endl;
+    std::cerr << "  --stats-mesh          report counts, polygon sizes, bounds, surface area and faces per" << std::endl;
+    std::cerr << "                        material for each mesh and the whole scene" << std::endl;
+    std::cerr << "  --validate            check normals for NaN/Inf, zero length, non-unit length and" << std::endl;
+    std::cerr << "                        facing away from the polygon instead of listing them" << std::endl;
+    std::cerr << "  --compare-normals=W   recompute smooth normals weighted by polygon area or angle and" << std::endl;
+    std::cerr << "                        report how far the stored normals deviate, instead of listing them" << std::endl;
+    std::cerr << "  --tolerance=T         allowed |length - 1| for --validate (default: 0.001)" << std::endl;
+    std::cerr << "  --max-offenders=N     offending indices listed per check or comparison (default: 16)" << std::endl;
+    std::cerr << "  --simd=LEVEL          validation and --stats-mesh kernels: auto (default), avx2 or scalar" << std::endl;
+    std::cerr << "  --serve=SOCKET        keep -j warm workers and answer requests on a Unix domain socket" << std::endl;
+    std::cerr << "                        (one line per connection: tab-separated options, then the path)" << std::endl;
+    std::cerr << "  --scene-cache=N       imported scenes --serve keeps for repeated requests (default: 8)" << std::endl;
+    std::cerr << "  -                     read a newline-separated list of paths from stdin" << std::endl;
+}
+
+template <typename T> static bool parse_number(std::string_view text, T& value)
+{
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+// "--name=value" と "--name value" の両方の形を受け付ける。
+// argがnameのオプションならtrueを返し、値が無ければvalueをnullptrにする
+static bool match_option(std::string_view arg, std::string_view name, int& i, int argc, char** argv, const char*& value)
+{
+    if (!arg.starts_with(name)) return false;
+    if (arg.size() == name.size())
     {
-        t->Destroy()
-    } -> std::same_as<void>;
-};
+        value = i + 1 < argc ? argv[++i] : nullptr;
+        return true;
+    }
+    if (arg[name.size()] != '=') return false;
+    value = arg.data() + name.size() + 1;
+    return true;
+}
 
-// カスタムデリータ
-template <typename T> struct FbxDeleter
+int main(int argc, char** argv)
 {
-    void operator()(T* p) const
+    // 差分はレポートとは別の使い方なので、他のオプションは受け付けない
+    if (argc >= 2 && std::string_view(argv[1]) == "diff")
     {
-        if constexpr (HasDestroy<T>)
+        if (argc != 4)
         {
-            if (p) p->Destroy();
-        } else
-        {
-            delete p;
+            usage(argv[0]);
+            return 2;
         }
+        ReportWriter out(stdout);
+        return diff_scenes(argv[2], argv[3], out, std::cerr);
     }
-};
-
-// スマートポインタの型を定義
-template <typename T> using FbxPtr = std::unique_ptr<T, FbxDeleter<T>>;
 
-FbxPtr<FbxScene> import(const FbxPtr<FbxManager>& manager, const char* path);
-void read(const FbxPtr<FbxScene>& scene);
-void read_normal(FbxMesh* mesh);
-void DisplayMaterial(FbxGeometry* pGeometry);
-static const FbxImplementation* LookForImplementation(FbxSurfaceMaterial* pMaterial);
+    BatchOptions options;
+    std::vector<std::string> args;
+    bool batch = false;
+    unsigned mesh_jobs = 0;
+    bool compare_profiles = false;
+    bool texture_usage = false;
+    std::string cache_dir;
+    uint64_t cache_max_bytes = uint64_t(1) << 30;
+    bool cache_rehash = false;
+    Query query;
+    ServerOptions server;
 
-int main(int argc, char** argv)
-{
-    FbxPtr<FbxManager> manager(FbxManager::Create());
-    if (manager.get() == nullptr)
+    for (int i = 1; i < argc; ++i)
     {
-        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
-        return 1;
+        std::string_view arg = argv[i];
+        const char* value = nullptr;
+        bool valid = true;
+
+        if (arg == "--")
+        {
+            for (++i; i < argc; ++i) args.emplace_back(argv[i]);
+            break;
+        }
+        if (match_option(arg, "-j", i, argc, argv, value) || match_option(arg, "--jobs", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.jobs);
+            batch = true;
+        } else if (match_option(arg, "--prefetch", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.prefetch);
+        } else if (match_option(arg, "--prefetch-bytes", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.prefetch_bytes);
+        } else if (match_option(arg, "--queue-depth", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.queue_depth) && options.queue_depth > 0;
+        } else if (match_option(arg, "--mesh-jobs", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, mesh_jobs) && mesh_jobs > 0;
+        } else if (match_option(arg, "--format", i, argc, argv, value))
+        {
+            valid = value && parse_report_format(value, options.viewer.format);
+        } else if (match_option(arg, "--only", i, argc, argv, value))
+        {
+            std::string_view section = value ? value : "";
+            valid = section == "normals" || section == "materials";
+            options.viewer.normals = section == "normals";
+            options.viewer.materials = section == "materials";
+        } else if (match_option(arg, "--where", i, argc, argv, value))
+        {
+            std::string error;
+            valid = value != nullptr;
+            if (valid && !query.parse(value, error))
+            {
+                std::cerr << "Error: Invalid --where expression: " << error << std::endl;
+                return 1;
+            }
+        } else if (match_option(arg, "--select", i, argc, argv, value))
+        {
+            QuerySelection selection;
+            valid = value && parse_query_selection(value, selection);
+            options.viewer.names = selection.names;
+            options.viewer.normals = selection.normals;
+            options.viewer.materials = selection.materials;
+            options.viewer.mesh_statistics = selection.statistics;
+        } else if (match_option(arg, "--import-profile", i, argc, argv, value))
+        {
+            valid = value && parse_import_profile(value, options.viewer.profile);
+        } else if (arg == "--dedup-materials")
+        {
+            options.viewer.dedup_materials = true;
+        } else if (arg == "--texture-usage")
+        {
+            texture_usage = true;
+        } else if (arg == "--stats")
+        {
+            if (!FBXAV_STATS)
+            {
+                std::cerr << "Error: --stats is not available in this build (FBXAV_STATS=0)" << std::endl;
+                return 1;
+            }
+            options.stats = true;
+        } else if (arg == "--stream")
+        {
+            options.viewer.stream = true;
+        } else if (arg == "--verify-streaming")
+        {
+            options.viewer.verify_streaming = true;
+        } else if (arg == "--compare-profiles")
+        {
+            compare_profiles = true;
+        } else if (match_option(arg, "--cache-dir", i, argc, argv, value))
+        {
+            valid = value && *value;
+            if (valid) cache_dir = value;
+        } else if (match_option(arg, "--cache-max-bytes", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, cache_max_bytes);
+        } else if (arg == "--cache-rehash")
+        {
+            cache_rehash = true;
+        } else if (match_option(arg, "--dump-normals", i, argc, argv, value))
+        {
+            valid = value && *value;
+            if (valid) options.viewer.dump_normals = value;
+        } else if (arg == "--dump-points")
+        {
+            options.viewer.dump.points = true;
+        } else if (arg == "--dump-indices")
+        {
+            options.viewer.dump.indices = true;
+        } else if (arg == "--stats-mesh")
+        {
+            options.viewer.mesh_statistics = true;
+        } else if (arg == "--validate")
+        {
+            options.viewer.validate = true;
+        } else if (match_option(arg, "--compare-normals", i, argc, argv, value))
+        {
+            valid = value && parse_normal_weighting(value, options.viewer.weighting);
+            options.viewer.compare_normals = true;
+        } else if (match_option(arg, "--tolerance", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.viewer.check.tolerance) && options.viewer.check.tolerance >= 0;
+        } else if (match_option(arg, "--max-offenders", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, options.viewer.check.max_offenders) && options.viewer.check.max_offenders >= 0;
+        } else if (match_option(arg, "--serve", i, argc, argv, value))
+        {
+            valid = value && *value;
+            if (valid) server.socket_path = value;
+        } else if (match_option(arg, "--scene-cache", i, argc, argv, value))
+        {
+            valid = value && parse_number(value, server.scene_cache);
+        } else if (match_option(arg, "--simd", i, argc, argv, value))
+        {
+            SimdLevel level;
+            valid = value && parse_simd_level(value, level);
+            if (valid && !set_simd_level(level))
+            {
+                std::cerr << "Error: " << value << " kernels are not available on this machine" << std::endl;
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-')
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            valid = false;
+        } else
+        {
+            args.emplace_back(arg);
+        }
+
+        if (!valid)
+        {
+            usage(argv[0]);
+            return 1;
+        }
     }
 
-    if (argc < 2)
+    // サーバーのレポートの内容は要求ごとに決まるので、ここではワーカー数だけを渡す
+    if (!server.socket_path.empty())
     {
-        std::cerr << "Usage: " << argv[0] << " <input.fbx>" << std::endl;
-        return 1;
+        if (!args.empty())
+        {
+            std::cerr << "Error: --serve takes its inputs from requests, not from the command line" << std::endl;
+            return 1;
+        }
+        server.jobs = options.jobs;
+        return run_server(server, std::cerr);
     }
 
-    const char* path = argv[1];
-    auto scene = import(manager, path);
-    if (scene == nullptr)
+    if (args.empty())
     {
-        std::cerr << "Error: Unable to import FBX file!" << std::endl;
+        usage(argv[0]);
         return 1;
     }
 
-    std::cout << "Imported FBX file: " << path << std::endl;
-
-    read(scene);
+    std::vector<std::string> inputs;
+    bool collected = collect_inputs(args, inputs, std::cerr);
 
-    return 0;
-}
-
-void read(const FbxPtr<FbxScene>& scene)
-{
-    auto root = scene->GetRootNode();
-    if (root == nullptr)
+    if ((options.viewer.dump.points || options.viewer.dump.indices) && options.viewer.dump_normals.empty())
     {
-        std::cerr << "Error: Root node is null!" << std::endl;
-        return;
+        std::cerr << "Error: --dump-points and --dump-indices require --dump-normals" << std::endl;
+        return 1;
     }
 
-    for (int i = 0; i < root->GetChildCount(); ++i)
+    if (options.viewer.profile == ImportProfile::Normals && (options.viewer.materials || options.viewer.mesh_statistics))
     {
-        auto child = root->GetChild(i);
-        if (child == nullptr)
-        {
-            std::cerr << "Error: Child node is null!" << std::endl;
-            continue;
-        }
+        std::cerr << "Error: --import-profile=normals drops materials; use it with --only=normals and without --stats-mesh" << std::endl;
+        return 1;
+    }
 
-        std::cout << "Child node: " << child->GetName() << std::endl;
+    if (!query.empty()) options.viewer.query = &query;
 
-        auto attr = child->GetNodeAttribute();
-        if (attr == nullptr)
+    // ストリーミングはテキストのレポートだけを、シーンを作らずに書く
+    if (options.viewer.stream || options.viewer.verify_streaming)
+    {
+        if (options.viewer.format != ReportFormat::Text || options.viewer.dedup_materials || texture_usage || !options.viewer.dump_normals.empty() || options.viewer.mesh_statistics ||
+            options.viewer.query || !options.viewer.names || options.viewer.compare_normals)
         {
-            std::cerr << "Error: Node attribute is null!" << std::endl;
-            continue;
+            std::cerr << "Error: --stream and --verify-streaming only support the plain text report" << std::endl;
+            std::cerr << "       (no --format, --dedup-materials, --texture-usage, --dump-normals, --stats-mesh," << std::endl;
+            std::cerr << "       --compare-normals, --where or --select)" << std::endl;
+            return 1;
         }
+    }
 
-        std::cout << "Node attribute: " << attr->GetAttributeType() << std::endl;
-
-        if (attr->GetAttributeType() == FbxNodeAttribute::eMesh)
-        {
-            auto mesh = static_cast<FbxMesh*>(attr);
-            std::cout << "Mesh: " << mesh->GetName() << std::endl;
-
-            read_normal(mesh);
-            DisplayMaterial(mesh);
-        }
+    // 時間とメモリの計測が互いに干渉しないよう、比較は1スレッドで順に行う
+    if (compare_profiles)
+    {
+        ReportWriter out(stdout);
+        bool compared = compare_import_profiles(inputs, out, std::cerr);
+        return collected && compared ? 0 : 1;
     }
-}
 
-FbxPtr<FbxScene> import(const FbxPtr<FbxManager>& manager, const char* path)
-{
-    if (manager == nullptr)
+    // JSONはファイルごとに一つの配列を書くので、複数の配列が並ぶと全体がJSONにならない
+    if (options.viewer.format == ReportFormat::Json && (inputs.size() > 1 || texture_usage))
     {
-        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
-        return nullptr;
+        std::cerr << "Error: --format=json reports a single file; use --format=ndjson for several files or --texture-usage" << std::endl;
+        return 1;
     }
 
-    auto ios = FbxIOSettings::Create(manager.get(), IOSROOT);
-    manager->SetIOSettings(ios);
+    TextureUsage textures;
+    if (texture_usage) options.viewer.textures = &textures;
 
-    FbxPtr<FbxImporter> importer(FbxImporter::Create(manager.get(), ""));
-    if (!importer->Initialize(path, -1, manager->GetIOSettings()))
+    std::unique_ptr<ReportCache> cache;
+    if (!cache_dir.empty())
     {
-        std::cerr << "Error: Unable to initialize FBX importer!" << std::endl;
-        return nullptr;
+        cache = std::make_unique<ReportCache>(cache_dir, cache_max_bytes, !cache_rehash);
+        if (!cache->open(std::cerr)) return 1;
+        options.viewer.cache = cache.get();
     }
 
-    FbxPtr<FbxScene> scene(FbxScene::Create(manager.get(), ""));
-    importer->Import(scene.get());
+    // 単一ファイルが直接指定された場合は従来どおりその場で処理する
+    bool single = !batch && args.size() == 1 && inputs.size() == 1 && inputs[0] == args[0];
 
-    return scene;
-}
+    // バッチではファイル単位で並列になるので、メッシュ単位の並列化は指定されたときだけにする
+    if (mesh_jobs == 0) mesh_jobs = single ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    std::unique_ptr<TaskPool> pool;
+    if (mesh_jobs > 1)
+    {
+        // 呼び出し元のスレッドも待つ間に手伝うので、ワーカーは一つ少なくてよい
+        pool = std::make_unique<TaskPool>(mesh_jobs - 1);
+        options.viewer.pool = pool.get();
+    }
 
-void read_normal(FbxMesh* mesh)
-{
-    auto elnrm = mesh->GetElementNormal();
-    if (elnrm != nullptr)
+    if (single)
     {
-        std::cout << "Element normal: " << elnrm->GetName() << std::endl;
+        FbxPtr<FbxManager> manager(FbxManager::Create());
+        if (manager.get() == nullptr)
+        {
+            std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+            return 1;
+        }
 
-        // mapping mode is by control points. The mesh should be smooth and soft.
-        // we can get normals by retrieving each control point
-        if (elnrm->GetMappingMode() == FbxGeometryElement::eByControlPoint)
+        Stats stats;
+        ScopedStats scoped(options.stats ? &stats : nullptr);
+        bool ok;
         {
-            // Let's get normals of each vertex, since the mapping mode of normal element is by control point
-            for (int vi = 0; vi < mesh->GetControlPointsCount(); vi++)
+            FBXAV_STATS_SCOPE(Total);
+            ReportWriter out(stdout);
+            try
             {
-                int ni = 0;
-                // reference mode is direct, the normal index is same as vertex index.
-                // get normals by the index of control vertex
-                if (elnrm->GetReferenceMode() == FbxGeometryElement::eDirect) ni = vi;
-                // reference mode is index-to-direct, get normals by the index-to-direct
-                if (elnrm->GetReferenceMode() == FbxGeometryElement::eIndexToDirect) ni = elnrm->GetIndexArray().GetAt(vi);
-                // Got normals of each vertex.
-                FbxVector4 normal = elnrm->GetDirectArray().GetAt(ni);
-                // add your custom code here, to output normals or get them into a list, such as KArrayTemplate<FbxVector4>
-                std::cout << "Normal for vertex " << vi << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << std::endl;
-            } // end for lVertexIndex
-        }     // end eByControlPoint
-        // mapping mode is by polygon-vertex.
-        // we can get normals by retrieving polygon-vertex.
-        else if (elnrm->GetMappingMode() == FbxGeometryElement::eByPolygonVertex)
-        {
-            int pvi = 0;
-            // Let's get normals of each polygon, since the mapping mode of normal element is by polygon-vertex.
-            for (int pi = 0; pi < mesh->GetPolygonCount(); pi++)
+                ok = inspect(manager, inputs[0].c_str(), options.viewer, out, std::cerr);
+            } catch (const std::exception& e)
             {
-                // get polygon size, you know how many vertices in current polygon.
-                int ps = mesh->GetPolygonSize(pi);
-                // retrieve each vertex of current polygon.
-                for (int i = 0; i < ps; i++)
-                {
-                    int ni = 0;
-                    // reference mode is direct, the normal index is same as lIndexByPolygonVertex.
-                    if (elnrm->GetReferenceMode() == FbxGeometryElement::eDirect) ni = pvi;
-                    // reference mode is index-to-direct, get normals by the index-to-direct
-                    if (elnrm->GetReferenceMode() == FbxGeometryElement::eIndexToDirect) ni = elnrm->GetIndexArray().GetAt(pvi);
-                    // Got normals of each polygon-vertex.
-                    FbxVector4 normal = elnrm->GetDirectArray().GetAt(ni);
-                    // add your custom code here, to output normals or get them into a list, such as KArrayTemplate<FbxVector4>
-                    std::cout << "Normal for polygon " << pi << " vertex " << i << ": " << normal[0] << ", " << normal[1] << ", " << normal[2] << std::endl;
-                    pvi++;
-                } // end for i //lPolygonSize
-            }     // end for lPolygonIndex //PolygonCount
-        }         // end eByPolygonVertex
+                // メッシュの並列解析で出た例外もここまで戻ってくる
+                std::cerr << "Error: " << e.what() << std::endl;
+                ok = false;
+            }
+            if (texture_usage) textures.write(options.viewer.format, out);
+        }
+        if (options.stats) write_stats(std::cerr, inputs[0].c_str(), stats.totals());
+        return ok ? 0 : 1;
     }
-}
 
-void DisplayMaterial(FbxGeometry* pGeometry)
-{
-    std::cout << "DisplayMaterial" << std::endl;
+    if (!options.viewer.dump_normals.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(options.viewer.dump_normals, ec);
+    }
 
-    int lMaterialCount = 0;
-    FbxNode* lNode = NULL;
-    if (pGeometry)
+    ReportWriter out(stdout);
+    int result = run_batch(inputs, options, out, std::cerr);
+    if (texture_usage)
     {
-        lNode = pGeometry->GetNode();
-        std::cout << "Node: " << lNode->GetName() << std::endl;
-        if (lNode) lMaterialCount = lNode->GetMaterialCount();
-        std::cout << "Material count: " << lMaterialCount << std::endl;
+        textures.write(options.viewer.format, out);
+        out.flush();
     }
-    if (lMaterialCount > 0)
+    if (cache)
     {
-        FbxPropertyT<FbxDouble3> lKFbxDouble3;
-        FbxPropertyT<FbxDouble> lKFbxDouble1;
-        FbxColor theColor;
-        for (int lCount = 0; lCount < lMaterialCount; lCount++)
-        {
-            DisplayInt("        Material ", lCount);
-            FbxSurfaceMaterial* lMaterial = lNode->GetMaterial(lCount);
-            DisplayString("            Name: \"", (char*)lMaterial->GetName(), "\"");
-            // Get the implementation to see if it's a hardware shader.
-            const FbxImplementation* lImplementation = LookForImplementation(lMaterial);
-            if (lImplementation)
-            {
-                // Now we have a hardware shader, let's read it
-                DisplayString("            Language: ", lImplementation->Language.Get().Buffer());
-                DisplayString("            LanguageVersion: ", lImplementation->LanguageVersion.Get().Buffer());
-                DisplayString("            RenderName: ", lImplementation->RenderName.Buffer());
-                DisplayString("            RenderAPI: ", lImplementation->RenderAPI.Get().Buffer());
-                DisplayString("            RenderAPIVersion: ", lImplementation->RenderAPIVersion.Get().Buffer());
-                const FbxBindingTable* lRootTable = lImplementation->GetRootTable();
-                FbxString lFileName = lRootTable->DescAbsoluteURL.Get();
-                FbxString lTechniqueName = lRootTable->DescTAG.Get();
-                const FbxBindingTable* lTable = lImplementation->GetRootTable();
-                size_t lEntryNum = lTable->GetEntryCount();
-                for (int i = 0; i < (int)lEntryNum; ++i)
-                {
-                    const FbxBindingTableEntry& lEntry = lTable->GetEntry(i);
-                    const char* lEntrySrcType = lEntry.GetEntryType(true);
-                    FbxProperty lFbxProp;
-                    FbxString lTest = lEntry.GetSource();
-                    DisplayString("            Entry: ", lTest.Buffer());
-                    if (strcmp(FbxPropertyEntryView::sEntryType, lEntrySrcType) == 0)
-                    {
-                        lFbxProp = lMaterial->FindPropertyHierarchical(lEntry.GetSource());
-                        if (!lFbxProp.IsValid()) { lFbxProp = lMaterial->RootProperty.FindHierarchical(lEntry.GetSource()); }
-                    } else if (strcmp(FbxConstantEntryView::sEntryType, lEntrySrcType) == 0)
-                    {
-                        lFbxProp = lImplementation->GetConstants().FindHierarchical(lEntry.GetSource());
-                    }
-                    if (lFbxProp.IsValid())
-                    {
-                        if (lFbxProp.GetSrcObjectCount<FbxTexture>() > 0)
-                        {
-                            // do what you want with the textures
-                            for (int j = 0; j < lFbxProp.GetSrcObjectCount<FbxFileTexture>(); ++j)
-                            {
-                                FbxFileTexture* lTex = lFbxProp.GetSrcObject<FbxFileTexture>(j);
-                                DisplayString("           File Texture: ", lTex->GetFileName());
-                            }
-                            for (int j = 0; j < lFbxProp.GetSrcObjectCount<FbxLayeredTexture>(); ++j)
-                            {
-                                FbxLayeredTexture* lTex = lFbxProp.GetSrcObject<FbxLayeredTexture>(j);
-                                DisplayString("        Layered Texture: ", lTex->GetName());
-                            }
-                            for (int j = 0; j < lFbxProp.GetSrcObjectCount<FbxProceduralTexture>(); ++j)
-                            {
-                                FbxProceduralTexture* lTex = lFbxProp.GetSrcObject<FbxProceduralTexture>(j);
-                                DisplayString("     Procedural Texture: ", lTex->GetName());
-                            }
-                        } else
-                        {
-                            FbxDataType lFbxType = lFbxProp.GetPropertyDataType();
-                            FbxString blah = lFbxType.GetName();
-                            if (FbxBoolDT == lFbxType)
-                            {
-                                DisplayBool("                Bool: ", lFbxProp.Get<FbxBool>());
-                            } else if (FbxIntDT == lFbxType || FbxEnumDT == lFbxType)
-                            {
-                                DisplayInt("                Int: ", lFbxProp.Get<FbxInt>());
-                            } else if (FbxFloatDT == lFbxType)
-                            {
-                                DisplayDouble("                Float: ", lFbxProp.Get<FbxFloat>());
-                            } else if (FbxDoubleDT == lFbxType)
-                            {
-                                DisplayDouble("                Double: ", lFbxProp.Get<FbxDouble>());
-                            } else if (FbxStringDT == lFbxType || FbxUrlDT == lFbxType || FbxXRefUrlDT == lFbxType)
-                            {
-                                DisplayString("                String: ", lFbxProp.Get<FbxString>().Buffer());
-                            } else if (FbxDouble2DT == lFbxType)
-                            {
-                                FbxDouble2 lDouble2 = lFbxProp.Get<FbxDouble2>();
-                                FbxVector2 lVect;
-                                lVect[0] = lDouble2[0];
-                                lVect[1] = lDouble2[1];
-                                Display2DVector("                2D vector: ", lVect);
-                            } else if (FbxDouble3DT == lFbxType || FbxColor3DT == lFbxType)
-                            {
-                                FbxDouble3 lDouble3 = lFbxProp.Get<FbxDouble3>();
-                                FbxVector4 lVect;
-                                lVect[0] = lDouble3[0];
-                                lVect[1] = lDouble3[1];
-                                lVect[2] = lDouble3[2];
-                                Display3DVector("                3D vector: ", lVect);
-                            } else if (FbxDouble4DT == lFbxType || FbxColor4DT == lFbxType)
-                            {
-                                FbxDouble4 lDouble4 = lFbxProp.Get<FbxDouble4>();
-                                FbxVector4 lVect;
-                                lVect[0] = lDouble4[0];
-                                lVect[1] = lDouble4[1];
-                                lVect[2] = lDouble4[2];
-                                lVect[3] = lDouble4[3];
-                                Display4DVector("                4D vector: ", lVect);
-                            } else if (FbxDouble4x4DT == lFbxType)
-                            {
-                                FbxDouble4x4 lDouble44 = lFbxProp.Get<FbxDouble4x4>();
-                                for (int j = 0; j < 4; ++j)
-                                {
-                                    FbxVector4 lVect;
-                                    lVect[0] = lDouble44[j][0];
-                                    lVect[1] = lDouble44[j][1];
-                                    lVect[2] = lDouble44[j][2];
-                                    lVect[3] = lDouble44[j][3];
-                                    Display4DVector("                4x4D vector: ", lVect);
-                                }
-                            }
-                        }
-                    }
-                }
-            } else if (lMaterial->GetClassId().Is(FbxSurfacePhong::ClassId))
-            {
-                // We found a Phong material.  Display its properties.
-                // Display the Ambient Color
-                lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Ambient;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Ambient: ", theColor);
-                // Display the Diffuse Color
-                lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Diffuse;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Diffuse: ", theColor);
-                // Display the Specular Color (unique to Phong materials)
-                lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Specular;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Specular: ", theColor);
-                // Display the Emissive Color
-                lKFbxDouble3 = ((FbxSurfacePhong*)lMaterial)->Emissive;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Emissive: ", theColor);
-                // Opacity is Transparency factor now
-                lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->TransparencyFactor;
-                DisplayDouble("            Opacity: ", 1.0 - lKFbxDouble1.Get());
-                // Display the Shininess
-                lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->Shininess;
-                DisplayDouble("            Shininess: ", lKFbxDouble1.Get());
-                // Display the Reflectivity
-                lKFbxDouble1 = ((FbxSurfacePhong*)lMaterial)->ReflectionFactor;
-                DisplayDouble("            Reflectivity: ", lKFbxDouble1.Get());
-            } else if (lMaterial->GetClassId().Is(FbxSurfaceLambert::ClassId))
-            {
-                // We found a Lambert material. Display its properties.
-                // Display the Ambient Color
-                lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Ambient;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Ambient: ", theColor);
-                // Display the Diffuse Color
-                lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Diffuse;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Diffuse: ", theColor);
-                // Display the Emissive
-                lKFbxDouble3 = ((FbxSurfaceLambert*)lMaterial)->Emissive;
-                theColor.Set(lKFbxDouble3.Get()[0], lKFbxDouble3.Get()[1], lKFbxDouble3.Get()[2]);
-                DisplayColor("            Emissive: ", theColor);
-                // Display the Opacity
-                lKFbxDouble1 = ((FbxSurfaceLambert*)lMaterial)->TransparencyFactor;
-                DisplayDouble("            Opacity: ", 1.0 - lKFbxDouble1.Get());
-            } else
-                DisplayString("Unknown type of Material");
-            FbxPropertyT<FbxString> lString;
-            lString = lMaterial->ShadingModel;
-            DisplayString("            Shading Model: ", lString.Get().Buffer());
-            DisplayString("");
-        }
+        cache->close();
+        std::cerr << "Cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
     }
-}
-
-static const FbxImplementation* LookForImplementation(FbxSurfaceMaterial* pMaterial)
-{
-    const FbxImplementation* lImplementation = nullptr;
-    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_CGFX);
-    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_HLSL);
-    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_SFX);
-    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_OGS);
-    if (!lImplementation) lImplementation = GetImplementation(pMaterial, FBXSDK_IMPLEMENTATION_SSSL);
-    return lImplementation;
+    return collected ? result : 1;
 }
@@ -0,0 +1,407 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "MeshKernels.h"
+#include "NormalKernels.h"
+
+// スカラー版とAVX2版のカーネルを合成した配列で突き合わせる。
+// 乱数の種は固定なので、失敗したときはいつも同じ入力で再現する。
+// AVX2を使えないCPUやビルドでは、スカラー版の期待値だけを確かめてスキップ(77)を返す
+
+constexpr int skipped = 77;
+constexpr float nan_f = std::numeric_limits<float>::quiet_NaN();
+constexpr float inf_f = std::numeric_limits<float>::infinity();
+constexpr double nan_d = std::numeric_limits<double>::quiet_NaN();
+constexpr double inf_d = std::numeric_limits<double>::infinity();
+
+// 8レーンの端数が0から7まで全部出るように選んだ要素数
+constexpr size_t counts[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 15, 16, 17, 23, 31, 64, 1000, 1003};
+
+static int failures = 0;
+
+static void fail(const std::string& what)
+{
+    std::cerr << "Error: " << what << std::endl;
+    ++failures;
+}
+
+// 分布の実装によって値が変わらないよう、生の乱数から[-1, 1]を作る
+static double random_unit(std::mt19937& rng)
+{
+    return static_cast<double>(static_cast<int>(rng() % 20001) - 10000) / 10000.0;
+}
+
+static bool use_avx2()
+{
+#if FBXAV_HAVE_AVX2
+    return get_simd_level() == SimdLevel::Avx2;
+#else
+    return false;
+#endif
+}
+
+// x/y/zを別々に持つ法線の配列
+struct Normals
+{
+    std::vector<float> x, y, z;
+
+    void add(float a, float b, float c)
+    {
+        x.push_back(a);
+        y.push_back(b);
+        z.push_back(c);
+    }
+
+    NormalArrays arrays() const { return {x.data(), y.data(), z.data(), x.size()}; }
+};
+
+// 長さがほぼ1のランダムな法線
+static Normals random_normals(std::mt19937& rng, size_t count)
+{
+    Normals normals;
+    for (size_t i = 0; i < count; ++i)
+    {
+        double a = random_unit(rng), b = random_unit(rng), c = random_unit(rng);
+        double length = std::sqrt(a * a + b * b + c * c);
+        if (length == 0) a = length = 1;
+        normals.add(static_cast<float>(a / length), static_cast<float>(b / length), static_cast<float>(c / length));
+    }
+    return normals;
+}
+
+static std::string describe(const char* kernel, const char* label, size_t count)
+{
+    return std::string(kernel) + " (" + label + ", " + std::to_string(count) + " normals)";
+}
+
+static bool same_result(const NormalCheckResult& a, const NormalCheckResult& b)
+{
+    for (int i = 0; i < normal_issue_count; ++i)
+    {
+        if (a.counts[i] != b.counts[i] || a.offenders[i] != b.offenders[i]) return false;
+    }
+    return true;
+}
+
+static void compare_check(const Normals& normals, const NormalCheckOptions& options, const char* label)
+{
+    auto t = normal_kernels::make_thresholds(options);
+    NormalCheckResult expected;
+    normal_kernels::check_scalar(normals.arrays(), t, expected);
+#if FBXAV_HAVE_AVX2
+    if (!use_avx2()) return;
+    NormalCheckResult actual;
+    normal_kernels::check_avx2(normals.arrays(), t, actual);
+    if (!same_result(expected, actual)) fail(describe("check_avx2 differs from check_scalar", label, normals.x.size()));
+#endif
+}
+
+static void compare_facing(const Normals& normals, const Normals& faces, const NormalCheckOptions& options, const char* label)
+{
+    auto t = normal_kernels::make_thresholds(options);
+    NormalCheckResult expected;
+    normal_kernels::facing_scalar(normals.arrays(), faces.arrays(), t, expected);
+#if FBXAV_HAVE_AVX2
+    if (!use_avx2()) return;
+    NormalCheckResult actual;
+    normal_kernels::facing_avx2(normals.arrays(), faces.arrays(), t, actual);
+    if (!same_result(expected, actual)) fail(describe("facing_avx2 differs from facing_scalar", label, normals.x.size()));
+#endif
+}
+
+// 1要素の検査でどの異常になるか。異常なしならNormalIssue::Count
+static NormalIssue classify(float x, float y, float z, const NormalCheckOptions& options)
+{
+    Normals normals;
+    normals.add(x, y, z);
+    NormalCheckResult result;
+    normal_kernels::check_scalar(normals.arrays(), normal_kernels::make_thresholds(options), result);
+    for (int i = 0; i < normal_issue_count; ++i)
+    {
+        if (result.counts[i] != 0) return static_cast<NormalIssue>(i);
+    }
+    return NormalIssue::Count;
+}
+
+static void expect_issue(float x, float y, float z, const NormalCheckOptions& options, NormalIssue expected, const char* label)
+{
+    if (classify(x, y, z, options) != expected) fail(std::string("check_scalar misclassifies ") + label);
+}
+
+// 境界ちょうどの値と非有限値の分類。AVX2版はこれと一致することを下で確かめる
+static void test_scalar_boundaries()
+{
+    NormalCheckOptions options;
+    float hi = 1.0f + options.tolerance;
+    float lo = 1.0f - options.tolerance;
+    expect_issue(1, 0, 0, options, NormalIssue::Count, "a unit normal");
+    expect_issue(hi, 0, 0, options, NormalIssue::Count, "a length exactly at 1 + tolerance");
+    expect_issue(lo, 0, 0, options, NormalIssue::Count, "a length exactly at 1 - tolerance");
+    expect_issue(std::nextafter(hi, 2.0f), 0, 0, options, NormalIssue::NonUnit, "a length just above 1 + tolerance");
+    expect_issue(std::nextafter(lo, 0.0f), 0, 0, options, NormalIssue::NonUnit, "a length just below 1 - tolerance");
+    expect_issue(0, 0, 0, options, NormalIssue::ZeroLength, "a zero normal");
+    expect_issue(options.zero_length, 0, 0, options, NormalIssue::ZeroLength, "a length exactly at the zero threshold");
+    expect_issue(0, 0, options.zero_length * 2, options, NormalIssue::NonUnit, "a length above the zero threshold");
+    expect_issue(nan_f, 0, 0, options, NormalIssue::NonFinite, "NaN in x");
+    expect_issue(0, nan_f, 1, options, NormalIssue::NonFinite, "NaN in y");
+    expect_issue(1, 0, nan_f, options, NormalIssue::NonFinite, "NaN in z");
+    expect_issue(inf_f, 0, 0, options, NormalIssue::NonFinite, "+Inf");
+    expect_issue(0, -inf_f, 0, options, NormalIssue::NonFinite, "-Inf");
+    expect_issue(0, 0, 0, {0.5f, 0.0f, 16}, NormalIssue::ZeroLength, "a zero normal with zero_length 0");
+}
+
+// ベクトルの本体と端数の両方に来るよう、特殊な値を先頭・中ほど・末尾に散らす
+static void test_special_values(std::mt19937& rng)
+{
+    NormalCheckOptions options;
+    float hi = 1.0f + options.tolerance;
+    float lo = 1.0f - options.tolerance;
+    const float specials[][3] = {
+        {nan_f, 0, 0}, {0, nan_f, 0}, {0, 0, nan_f}, {inf_f, 0, 0}, {0, -inf_f, 0}, {inf_f, -inf_f, 0}, {nan_f, inf_f, 0}, {0, 0, 0},
+        {-0.0f, 0, 0}, {options.zero_length, 0, 0}, {hi, 0, 0}, {lo, 0, 0}, {0, hi, 0}, {0, 0, -lo}, {std::nextafter(hi, 2.0f), 0, 0},
+        {std::nextafter(lo, 0.0f), 0, 0}, {3, 4, 0}, {1e-20f, 0, 0}, {1e20f, 0, 0},
+    };
+    for (size_t count : counts)
+    {
+        if (count == 0) continue;
+        auto normals = random_normals(rng, count);
+        for (size_t s = 0; s < std::size(specials); ++s)
+        {
+            size_t i = (s * 7 + count / 2) % count;
+            if (s % 3 == 0) i = count - 1 - (s % count);
+            normals.x[i] = specials[s][0];
+            normals.y[i] = specials[s][1];
+            normals.z[i] = specials[s][2];
+        }
+        compare_check(normals, options, "special values");
+    }
+
+    // 全部が特殊な値の配列
+    Normals all;
+    for (size_t k = 0; k < 5; ++k)
+    {
+        for (const auto& s : specials) all.add(s[0], s[1], s[2]);
+    }
+    compare_check(all, options, "only special values");
+}
+
+static void test_random(std::mt19937& rng)
+{
+    NormalCheckOptions options;
+    for (size_t count : counts)
+    {
+        auto normals = random_normals(rng, count);
+        compare_check(normals, options, "unit normals");
+
+        // 長さを崩したものも混ぜる
+        for (size_t i = 0; i < count; i += 3)
+        {
+            float scale = static_cast<float>(1.0 + random_unit(rng) * 0.01);
+            normals.x[i] *= scale;
+            normals.y[i] *= scale;
+            normals.z[i] *= scale;
+        }
+        compare_check(normals, options, "scaled normals");
+        compare_check(normals, {0.05f, 1e-3f, 4}, "scaled normals with a loose tolerance");
+    }
+}
+
+// 記録するインデックスの数の上限。件数は上限によらず全部数える
+static void test_max_offenders(std::mt19937& rng)
+{
+    for (size_t count : {size_t(7), size_t(8), size_t(100), size_t(1003)})
+    {
+        auto normals = random_normals(rng, count);
+        for (size_t i = 0; i < count; i += 2) normals.x[i] = normals.y[i] = normals.z[i] = 0;
+        size_t zeros = (count + 1) / 2;
+        for (int max_offenders : {0, 1, 3, 8, 16, 1000})
+        {
+            NormalCheckOptions options;
+            options.max_offenders = max_offenders;
+            compare_check(normals, options, "many offenders");
+
+            NormalCheckResult result;
+            normal_kernels::check_scalar(normals.arrays(), normal_kernels::make_thresholds(options), result);
+            auto zero = static_cast<int>(NormalIssue::ZeroLength);
+            size_t recorded = std::min(zeros, static_cast<size_t>(max_offenders));
+            if (result.counts[zero] != zeros || result.offenders[zero].size() != recorded)
+            {
+                fail("check_scalar does not stop recording at max_offenders " + std::to_string(max_offenders));
+            }
+            // 記録されるのは先頭から順に見つかったもの
+            for (size_t k = 0; k < result.offenders[zero].size(); ++k)
+            {
+                if (result.offenders[zero][k] != static_cast<int>(k * 2)) fail("check_scalar records offenders out of order");
+            }
+        }
+    }
+}
+
+static void test_facing(std::mt19937& rng)
+{
+    NormalCheckOptions options;
+    for (size_t count : counts)
+    {
+        auto normals = random_normals(rng, count);
+        Normals faces;
+        for (size_t i = 0; i < count; ++i) faces.add(static_cast<float>(random_unit(rng)), static_cast<float>(random_unit(rng)), static_cast<float>(random_unit(rng)));
+        compare_facing(normals, faces, options, "random faces");
+
+        // 直交してちょうど0になるもの、NaN、Infを混ぜる
+        for (size_t i = 0; i < count; i += 5)
+        {
+            faces.x[i] = -normals.y[i];
+            faces.y[i] = normals.x[i];
+            faces.z[i] = 0;
+        }
+        if (count > 1) faces.x[1] = nan_f;
+        if (count > 2) normals.z[count - 1] = -inf_f;
+        compare_facing(normals, faces, options, "faces with special values");
+        options.max_offenders = 2;
+        compare_facing(normals, faces, options, "faces with max_offenders 2");
+    }
+}
+
+// 点はFbxVector4と同じくx, y, z, wの並び
+static std::vector<double> random_points(std::mt19937& rng, size_t count)
+{
+    std::vector<double> points(count * 4);
+    for (double& v : points) v = random_unit(rng) * 100.0;
+    return points;
+}
+
+static bool same_double(double a, double b)
+{
+    return a == b || (a != a && b != b);
+}
+
+static void compare_bounds(const std::vector<double>& points, const char* label)
+{
+    size_t count = points.size() / 4;
+    double expected_min[4], expected_max[4];
+    std::fill(expected_min, expected_min + 4, inf_d);
+    std::fill(expected_max, expected_max + 4, -inf_d);
+    mesh_kernels::bounds_scalar(points.data(), count, expected_min, expected_max);
+#if FBXAV_HAVE_AVX2
+    if (!use_avx2()) return;
+    double min[4], max[4];
+    std::fill(min, min + 4, inf_d);
+    std::fill(max, max + 4, -inf_d);
+    mesh_kernels::bounds_avx2(points.data(), count, min, max);
+    for (int k = 0; k < 4; ++k)
+    {
+        if (!same_double(min[k], expected_min[k]) || !same_double(max[k], expected_max[k]))
+        {
+            fail(std::string("bounds_avx2 differs from bounds_scalar (") + label + ", " + std::to_string(count) + " points)");
+            return;
+        }
+    }
+#endif
+}
+
+static void compare_area(const std::vector<double>& points, const mesh_kernels::Triangles& triangles, const char* label)
+{
+    double expected = mesh_kernels::area_scalar(points.data(), triangles);
+#if FBXAV_HAVE_AVX2
+    if (!use_avx2()) return;
+    double actual = mesh_kernels::area_avx2(points.data(), triangles);
+    if (!same_double(actual, expected)) fail(std::string("area_avx2 differs from area_scalar (") + label + ", " + std::to_string(triangles.count) + " triangles)");
+#else
+    (void)expected;
+#endif
+}
+
+static void test_bounds(std::mt19937& rng)
+{
+    for (size_t count : counts)
+    {
+        auto points = random_points(rng, count);
+        compare_bounds(points, "random points");
+        if (count == 0) continue;
+
+        // NaNは無視され、Infはそのまま端になる
+        points[(count / 2) * 4] = nan_d;
+        points[(count - 1) * 4 + 1] = inf_d;
+        points[2] = -inf_d;
+        compare_bounds(points, "points with NaN and Inf");
+    }
+
+    // 端の値が既知の配列でスカラー版そのものも確かめる
+    std::vector<double> points = {1, 2, 3, 1, -1, nan_d, 5, 1, 4, -2, nan_d, 1};
+    double min[4] = {inf_d, inf_d, inf_d, inf_d}, max[4] = {-inf_d, -inf_d, -inf_d, -inf_d};
+    mesh_kernels::bounds_scalar(points.data(), 3, min, max);
+    if (min[0] != -1 || max[0] != 4 || min[1] != -2 || max[1] != 2 || min[2] != 3 || max[2] != 5) fail("bounds_scalar gives wrong bounds for a known array");
+}
+
+static void test_area(std::mt19937& rng)
+{
+    const size_t point_count = 1000;
+    auto points = random_points(rng, point_count);
+    mesh_kernels::Triangles triangles;
+    for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(4), size_t(5), size_t(7), size_t(8), size_t(9), size_t(100), size_t(1023), mesh_kernels::triangle_batch})
+    {
+        triangles.count = count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            triangles.a[i] = static_cast<int>(rng() % point_count);
+            triangles.b[i] = static_cast<int>(rng() % point_count);
+            triangles.c[i] = static_cast<int>(rng() % point_count);
+        }
+        compare_area(points, triangles, "random triangles");
+
+        // 潰れた三角形は面積0
+        for (size_t i = 0; i < count; i += 4) triangles.c[i] = triangles.b[i] = triangles.a[i];
+        compare_area(points, triangles, "degenerate triangles");
+    }
+
+    // NaNやInfを含む点を使う三角形
+    points[0] = nan_d;
+    points[4 + 1] = inf_d;
+    triangles.count = 37;
+    for (size_t i = 0; i < triangles.count; ++i)
+    {
+        triangles.a[i] = static_cast<int>(i % 3);
+        triangles.b[i] = static_cast<int>(rng() % point_count);
+        triangles.c[i] = static_cast<int>(rng() % point_count);
+    }
+    compare_area(points, triangles, "triangles with NaN and Inf");
+
+    // 単位正方形を2つの三角形に分けると面積1
+    std::vector<double> square = {0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 1, 0, 1, 0, 1};
+    triangles.count = 2;
+    triangles.a[0] = 0, triangles.b[0] = 1, triangles.c[0] = 2;
+    triangles.a[1] = 0, triangles.b[1] = 2, triangles.c[1] = 3;
+    if (mesh_kernels::area_scalar(square.data(), triangles) != 1.0) fail("area_scalar gives the wrong area for a unit square");
+    compare_area(square, triangles, "unit square");
+}
+
+int main()
+{
+    std::mt19937 rng(20231);
+    test_scalar_boundaries();
+    test_special_values(rng);
+    test_random(rng);
+    test_max_offenders(rng);
+    test_facing(rng);
+    test_bounds(rng);
+    test_area(rng);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " kernel checks failed" << std::endl;
+        return 1;
+    }
+    if (!use_avx2())
+    {
+        std::cerr << "AVX2 kernels are not available; only the scalar kernels were checked" << std::endl;
+        return skipped;
+    }
+    std::cerr << "Scalar and AVX2 kernels agree" << std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+﻿#include <fbxsdk.h>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include "FbxPtr.h"
+#include "ImportProfile.h"
+#include "MeshStatistics.h"
+#include "SceneGenerator.h"
+#include "Viewer.h"
+
+// --only=normals --stats-meshでも、マテリアルごとの面の数が読み込みのプロファイルで消えないことを確かめる。
+// 生成したシーンはすべての面にマテリアルを割り当てているので、unassigned_facesは0になるはず
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void fail(const std::string& what)
+{
+    std::cerr << "Error: " << what << std::endl;
+    ++failures;
+}
+
+static void add_meshes(FbxNode* node, MeshStatistics& total)
+{
+    for (int i = 0; i < node->GetNodeAttributeCount(); ++i)
+    {
+        auto attr = node->GetNodeAttributeByIndex(i);
+        if (attr == nullptr || attr->GetAttributeType() != FbxNodeAttribute::eMesh) continue;
+        MeshStatistics statistics;
+        compute_mesh_statistics(static_cast<FbxMesh*>(attr), statistics);
+        total.add(statistics);
+    }
+    for (int i = 0; i < node->GetChildCount(); ++i) add_meshes(node->GetChild(i), total);
+}
+
+int main(int argc, char** argv)
+{
+    fs::path dir = argc > 1 ? fs::path(argv[1]) : fs::temp_directory_path() / "fbxav-mesh-statistics-test";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    FbxPtr<FbxManager> manager(FbxManager::Create());
+    if (manager.get() == nullptr)
+    {
+        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+        return 1;
+    }
+
+    SceneParameters parameters;
+    parameters.meshes = 2;
+    parameters.vertices = 100;
+    parameters.materials = 4;
+    std::string path = (dir / "materials.fbx").string();
+    if (!generate_scene(manager, path.c_str(), parameters, std::cerr)) return 1;
+
+    // --only=normals --stats-mesh と --select=statistics
+    ViewerOptions only_normals;
+    only_normals.materials = false;
+    only_normals.mesh_statistics = true;
+    ViewerOptions select_statistics;
+    select_statistics.normals = false;
+    select_statistics.materials = false;
+    select_statistics.names = false;
+    select_statistics.mesh_statistics = true;
+
+    for (const ViewerOptions* options : {&only_normals, &select_statistics})
+    {
+        ImportProfile profile = select_import_profile(*options);
+        if (profile != ImportProfile::Materials) fail(std::string("--stats-mesh imports with the ") + import_profile_name(profile) + " profile");
+
+        auto scene = import(manager, path.c_str(), profile, std::cerr);
+        if (scene == nullptr)
+        {
+            fail("Unable to import " + path);
+            continue;
+        }
+        MeshStatistics total;
+        add_meshes(scene->GetRootNode(), total);
+        int64_t assigned = std::accumulate(total.material_faces.begin(), total.material_faces.end(), int64_t(0));
+        if (total.polygons == 0 || total.unassigned_faces != 0 || assigned != total.polygons)
+        {
+            fail(std::to_string(total.unassigned_faces) + " of " + std::to_string(total.polygons) + " faces lost their material under the " + import_profile_name(profile) + " profile");
+        }
+    }
+    fs::remove(path, ec);
+
+    if (failures > 0) return 1;
+    std::cerr << "Faces per material survive --only=normals --stats-mesh" << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+﻿#include <fbxsdk.h>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "FbxBinaryReader.h"
+#include "FbxPtr.h"
+#include "ReportWriter.h"
+#include "SceneGenerator.h"
+#include "Viewer.h"
+
+// SceneGeneratorで作ったバイナリのシーンを--verify-streamingと同じ経路で読み、
+// SDK経由とストリーミングのレポートが一致することを確かめる。
+// 法線の持ち方、配列の圧縮の有無、検査の有無の組み合わせを全部通し、
+// マテリアルはPhong、Lambert、どちらでもないシェーディングを混ぜる
+
+namespace fs = std::filesystem;
+
+// 書き出した配列の圧縮が指定どおりか。効いていなければ組み合わせを試したことにならない
+static bool arrays_compressed(const std::string& path, bool& compressed, std::ostream& err)
+{
+    FbxBinaryReader reader;
+    if (!reader.open(path.c_str(), err)) return false;
+    FbxRecord objects, geometry, vertices;
+    if (!reader.find(nullptr, "Objects", objects) || !reader.find(&objects, "Geometry", geometry) || !reader.find(&geometry, "Vertices", vertices)) return false;
+    FbxRecordValue value;
+    if (reader.values(vertices, &value, 1) != 1 || !value.is_array()) return false;
+    compressed = value.compressed;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    fs::path dir = argc > 1 ? fs::path(argv[1]) : fs::temp_directory_path() / "fbxav-streaming-test";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    FbxPtr<FbxManager> manager(FbxManager::Create());
+    if (manager.get() == nullptr)
+    {
+        std::cerr << "Error: Unable to create FBX Manager!" << std::endl;
+        return 1;
+    }
+
+    // zlibが無いビルドのストリーミングは圧縮された配列を読めない
+    std::vector<bool> compressions = {false};
+#if FBXAV_HAVE_ZLIB
+    compressions.push_back(true);
+#endif
+
+    int failures = 0;
+    int runs = 0;
+    for (auto layout : {NormalLayout::ControlPoint, NormalLayout::PolygonVertex, NormalLayout::PolygonVertexIndexed})
+    {
+        for (bool compress : compressions)
+        {
+            SceneParameters parameters;
+            parameters.meshes = 3;
+            // 配列がSDKの圧縮する最小の大きさを超えるようにする
+            parameters.vertices = 400;
+            parameters.normals = layout;
+            parameters.materials = 3;
+            parameters.depth = 2;
+            parameters.mixed_shading = true;
+            parameters.compress_arrays = compress;
+
+            std::string name = std::string(normal_layout_name(layout)) + (compress ? "-compressed" : "-uncompressed");
+            std::string path = (dir / (name + ".fbx")).string();
+            if (!generate_scene(manager, path.c_str(), parameters, std::cerr))
+            {
+                std::cerr << "Error: Unable to generate " << path << std::endl;
+                ++failures;
+                continue;
+            }
+
+            bool compressed = false;
+            if (!arrays_compressed(path, compressed, std::cerr) || compressed != compress)
+            {
+                std::cerr << "Error: " << path << " was not written as a binary file with " << (compress ? "compressed" : "uncompressed") << " arrays" << std::endl;
+                ++failures;
+            }
+
+            for (bool validate : {false, true})
+            {
+                ViewerOptions options;
+                options.verify_streaming = true;
+                options.validate = validate;
+                ReportWriter out(nullptr, 64 * 1024);
+                std::ostringstream err;
+                ++runs;
+                if (!inspect(manager, path.c_str(), options, out, err))
+                {
+                    std::cerr << "Error: --verify-streaming failed for " << name << (validate ? " with --validate" : "") << std::endl << err.str();
+                    ++failures;
+                }
+            }
+            fs::remove(path, ec);
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << runs << " streaming checks failed" << std::endl;
+        return 1;
+    }
+    std::cerr << "Streaming and SDK reports agree for " << runs << " scenes" << std::endl;
+    return 0;
+}